@@ -106,6 +106,10 @@ public:
     static auto Get12HourTimeEnable() -> bool;
     static auto GetLanguage() -> long;
     static auto GetTextScrollSpeed() -> long;
+    static auto GetDownloadSegmentCount() -> long;
+    static auto GetDownloadMinSegmentSize() -> s64;
+    static auto GetTransferAdaptiveEnable() -> bool;
+    static auto GetTransferStatsEnable() -> bool;
 
     static void SetMtpEnable(bool enable);
     static void SetFtpEnable(bool enable);
@@ -122,6 +126,7 @@ public:
     static void Set12HourTimeEnable(bool enable);
     static void SetLanguage(long index);
     static void SetTextScrollSpeed(long index);
+    static void SetDownloadSegmentCount(long count);
 
     static auto Install(OwoConfig& config) -> Result;
     static auto Install(ui::ProgressBox* pbox, OwoConfig& config) -> Result;
@@ -296,6 +301,8 @@ public:
     option::OptionString m_left_menu{INI_SECTION, "left_side_menu", "FileBrowser"};
     option::OptionString m_right_menu{INI_SECTION, "right_side_menu", "Appstore"};
     option::OptionBool m_progress_boost_mode{INI_SECTION, "progress_boost_mode", true};
+    option::OptionBool m_transfer_adaptive{INI_SECTION, "transfer_adaptive", true};
+    option::OptionBool m_transfer_stats{INI_SECTION, "transfer_stats", false};
 
     // install options
     option::OptionBool m_install_sysmmc{INI_SECTION, "install_sysmmc", false};
@@ -317,6 +324,8 @@ public:
     option::OptionBool m_convert_to_standard_crypto{INI_SECTION, "convert_to_standard_crypto", false};
     option::OptionBool m_lower_master_key{INI_SECTION, "lower_master_key", false};
     option::OptionBool m_lower_system_version{INI_SECTION, "lower_system_version", true};
+    option::OptionLong m_install_parallel_ncas{INI_SECTION, "install_parallel_ncas", 2};
+    option::OptionLong m_install_memory_budget{INI_SECTION, "install_memory_budget_mb", 96};
 
     // dump options
     option::OptionBool m_dump_app_folder{"dump", "app_folder", true};
@@ -326,6 +335,10 @@ public:
     option::OptionBool m_dump_usb_transfer_stream{"dump", "usb_transfer_stream", true, false};
     option::OptionBool m_dump_convert_to_common_ticket{"dump", "convert_to_common_ticket", true};
 
+    // download options
+    option::OptionLong m_download_segment_count{"download", "segment_count", 4};
+    option::OptionLong m_download_min_segment_size{"download", "min_segment_size_mb", 8};
+
     // todo: move this into it's own menu
     option::OptionLong m_text_scroll_speed{"accessibility", "text_scroll_speed", 1}; // normal
 
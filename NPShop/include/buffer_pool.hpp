@@ -0,0 +1,92 @@
+#pragma once
+
+#include "defines.hpp"
+#include "log.hpp"
+#include <switch.h>
+#include <vector>
+#include <algorithm>
+
+namespace npshop {
+
+// set of equally sized buffers shared by the stages of a transfer pipeline.
+// stages take their buffers from the pool when they start and return them when done.
+// whilst running, buffers are swapped between stages, so nothing is allocated
+// and the same buffers are re-used for each transfer that shares the pool.
+struct BufferPool {
+    BufferPool(const char* name, u64 buffer_size) : m_name{name}, m_buffer_size{buffer_size} {
+        mutexInit(std::addressof(m_mutex));
+    }
+
+    ~BufferPool() {
+        LogStats();
+    }
+
+    // moves a buffer from the pool into buf, only allocating if the pool is empty.
+    void Acquire(std::vector<u8>& buf) {
+        SCOPED_MUTEX(std::addressof(m_mutex));
+
+        if (!m_free.empty()) {
+            buf = std::move(m_free.back());
+            m_free.pop_back();
+            m_reused++;
+        } else {
+            buf = {};
+            buf.reserve(m_buffer_size);
+            m_allocated++;
+        }
+
+        buf.clear();
+        m_in_use++;
+        m_high_water = std::max(m_high_water, m_in_use);
+    }
+
+    // same as above, but only if buf doesn't already own a buffer.
+    // used after swapping with an empty slot.
+    void AcquireIfEmpty(std::vector<u8>& buf) {
+        if (!buf.capacity()) {
+            Acquire(buf);
+        }
+    }
+
+    // returns the buffer to the pool so that it can be re-used.
+    void Release(std::vector<u8>& buf) {
+        if (!buf.capacity()) {
+            return;
+        }
+
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        if (m_in_use) {
+            m_in_use--;
+        }
+
+        if (buf.capacity() >= m_buffer_size) {
+            buf.clear();
+            m_free.emplace_back(std::move(buf));
+        }
+
+        buf = {};
+    }
+
+    auto GetBufferSize() const -> u64 {
+        return m_buffer_size;
+    }
+
+    void LogStats() {
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        log_write("[POOL] %s: buffer size: %zu high water: %u (%zu KiB) allocated: %u reused (allocations avoided): %u\n",
+            m_name, m_buffer_size, m_high_water, (m_high_water * m_buffer_size) / 1024, m_allocated, m_reused);
+    }
+
+private:
+    Mutex m_mutex{};
+    std::vector<std::vector<u8>> m_free{};
+    const char* m_name{};
+    const u64 m_buffer_size{};
+
+    u32 m_in_use{};
+    u32 m_high_water{};
+    u32 m_allocated{};
+    u32 m_reused{};
+};
+
+} // namespace npshop
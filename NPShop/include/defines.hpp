@@ -648,6 +648,18 @@ enum class SphairaResult : Result {
     YatiNcmDbCorruptHeader,
     // unable to total infos from ncm database.
     YatiNcmDbCorruptInfos,
+
+    // curl failed to perform the request.
+    HttpFailedRequest,
+    // server does not support range requests.
+    HttpRangeNotSupported,
+    // Content-Range was missing or invalid.
+    HttpBadContentLength,
+    // server returned less data than requested.
+    HttpBadReadSize,
+
+    // file size changed between listing the folder and copying.
+    FsFileSizeChanged,
 };
 
 #define MAKE_SPHAIRA_RESULT_ENUM(x) Result_##x =  MAKERESULT(Module_Sphaira, (Result)SphairaResult::x)
@@ -765,6 +777,11 @@ enum : Result {
     MAKE_SPHAIRA_RESULT_ENUM(YatiCertNotFound),
     MAKE_SPHAIRA_RESULT_ENUM(YatiNcmDbCorruptHeader),
     MAKE_SPHAIRA_RESULT_ENUM(YatiNcmDbCorruptInfos),
+    MAKE_SPHAIRA_RESULT_ENUM(HttpFailedRequest),
+    MAKE_SPHAIRA_RESULT_ENUM(HttpRangeNotSupported),
+    MAKE_SPHAIRA_RESULT_ENUM(HttpBadContentLength),
+    MAKE_SPHAIRA_RESULT_ENUM(HttpBadReadSize),
+    MAKE_SPHAIRA_RESULT_ENUM(FsFileSizeChanged),
 };
 
 #undef MAKE_SPHAIRA_RESULT_ENUM
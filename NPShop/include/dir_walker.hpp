@@ -0,0 +1,44 @@
+#pragma once
+
+#include "fs.hpp"
+#include <switch.h>
+#include <vector>
+#include <functional>
+
+namespace npshop::fs {
+
+struct WalkEntry {
+    FsPath path{};
+    // name of the folder, empty for the root.
+    FsPath name{};
+    // index of the parent folder in the output, -1 for the root.
+    s64 parent{-1};
+    // 0 for the root.
+    u32 depth{};
+    std::vector<FsDirectoryEntry> files{};
+    std::vector<FsDirectoryEntry> dirs{};
+};
+
+struct WalkConfig {
+    // open mode of each folder, FsDirOpenMode_ReadDirs is added for folders
+    // that are above max_depth.
+    u32 mode{FsDirOpenMode_ReadFiles | FsDirOpenMode_NoFileSize};
+    // folders at this depth are listed, but not walked into.
+    u32 max_depth{UINT32_MAX};
+    // return false to skip walking into the folder, it is still added to dirs.
+    // called from the worker threads.
+    std::function<bool(const FsDirectoryEntry&)> filter{};
+    // if set, sub folders that fail to be listed are left empty rather than failing the walk.
+    bool ignore_errors{};
+};
+
+// lists the folder and every folder within it, spreading the folders across a few
+// threads that steal from each other once they run out, so that the latency of
+// each directory read is overlapped. this is mostly a win on sd cards and usb drives,
+// where most of the time is spent waiting on each read.
+// stdio fs are walked on the calling thread only.
+// the output is in the same order as a serial pre-order walk, the folder always
+// comes before its sub folders, which are in the order that they were listed.
+Result WalkDirs(Fs* fs, const FsPath& path, std::vector<WalkEntry>& out, const WalkConfig& config = {});
+
+} // namespace npshop::fs
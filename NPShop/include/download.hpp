@@ -16,6 +16,11 @@ enum {
     Flag_Cache = 1 << 0,
     Flag_NoBody = 1 << 1,
     Flag_AllowErrorBody = 1 << 2,
+    // splits the download into multiple range requests which are downloaded
+    // in parallel. progress is journaled so that the download can be resumed.
+    // only applies to file downloads, falls back to a single request if the
+    // server does not support range requests.
+    Flag_Segmented = 1 << 3,
 };
 
 enum class Priority {
@@ -112,6 +117,16 @@ struct PrivKey {
     std::string m_str;
 };
 
+// used with Flag_Segmented.
+struct Segments {
+    Segments() = default;
+    Segments(u32 count, s64 min_size) : m_count{count}, m_min_size{min_size} {}
+    // max number of segments (connections) to download in parallel.
+    u32 m_count{4};
+    // files are not split into segments smaller than this.
+    s64 m_min_size{1024 * 1024 * 8};
+};
+
 struct ApiResult {
     bool success;
     long code;
@@ -153,6 +168,13 @@ auto FromFileAsync(const Api& e) -> bool;
 // uses curl to convert string to their %XX
 auto EscapeString(const std::string& str) -> std::string;
 
+// sets the options used by every request (user agent, tls, shared connections,
+// stop token), for callers that perform their own requests with the handle.
+// the api is read by the progress callback, so it must outlive the request.
+void SetupHandle(void* curl, const Api& e);
+// stores the response headers in the Header passed as the userdata.
+auto HeaderCallback(char* b, size_t size, size_t nitems, void* userdata) -> size_t;
+
 struct Api {
     Api() = default;
 
@@ -297,6 +319,7 @@ struct Api {
     auto& GetOnUploadSeek() const { return m_on_upload_seek; }
     auto& GetPriority() const { return m_prio; }
     auto& GetToken() const { return m_stoken; }
+    auto& GetSegments() const { return m_segments; }
 
     void SetOption(Url&& v) { m_url = v; }
     void SetOption(Fields&& v) { m_fields = v; }
@@ -315,6 +338,7 @@ struct Api {
     void SetOption(OnUploadSeek&& v) { m_on_upload_seek = v; }
     void SetOption(Priority&& v) { m_prio = v; }
     void SetOption(StopToken&& v) { m_stoken = v; }
+    void SetOption(Segments&& v) { m_segments = v; }
 
     bool post_json_with_headers_curl(const char* url,
         const std::string& json,
@@ -352,6 +376,7 @@ private:
     Priority m_prio{Priority::High};
     std::stop_source m_stop_source{};
     StopToken m_stoken{m_stop_source.get_token()};
+    Segments m_segments{};
     bool m_is_upload{};
 };
 
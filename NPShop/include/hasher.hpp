@@ -3,6 +3,7 @@
 #include "fs.hpp"
 #include "ui/progress_box.hpp"
 #include <string>
+#include <vector>
 #include <memory>
 #include <span>
 #include <switch.h>
@@ -16,6 +17,13 @@ enum class Type {
     Sha256,
 };
 
+constexpr Type ALL_TYPES[]{
+    Type::Crc32,
+    Type::Md5,
+    Type::Sha1,
+    Type::Sha256,
+};
+
 struct BaseSource {
     virtual ~BaseSource() = default;
     virtual Result Size(s64* out) = 0;
@@ -29,4 +37,14 @@ Result Hash(ui::ProgressBox* pbox, Type type, BaseSource* source, std::string& o
 Result Hash(ui::ProgressBox* pbox, Type type, fs::Fs* fs, const fs::FsPath& path, std::string& out);
 Result Hash(ui::ProgressBox* pbox, Type type, std::span<const u8> data, std::string& out);
 
+// calculates every type with a single read of the data, out is in the same order as types.
+// each extra type is updated on its own thread, so hashing several types costs little more than one.
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, BaseSource* source, std::vector<std::string>& out);
+// same as above, if cache_key is set, results are cached by the key, file size and timestamp.
+// the key should identify the file across filesystems, such as the fs root + path.
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, fs::Fs* fs, const fs::FsPath& path, std::vector<std::string>& out, const std::string& cache_key = {});
+
+// writes the hash cache if it changed, called on exit.
+void SaveCache();
+
 } // namespace npshop::hash
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "defines.hpp"
+#include "buffer_pool.hpp"
+#include <switch.h>
+#include <vector>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+
+namespace npshop {
+
+// single-producer single-consumer ring of buffers, used to pass data between threads.
+// pushing and popping is lock-free, the mutex / condvar are only used to sleep
+// when the ring is full (producer) or empty (consumer).
+// buffers are swapped in and out of the ring rather than copied. Reserve() fills
+// the slots from the pool up front, the producer should still take a buffer from
+// the pool if it gets back an empty one.
+// Size is the max depth, the depth in use can be lowered at runtime with SetDepth().
+template<u32 Size>
+struct SpscRing {
+    static_assert(Size && (Size & (Size - 1)) == 0, "Must be power of 2!");
+
+    SpscRing() {
+        mutexInit(std::addressof(m_mutex));
+        condvarInit(std::addressof(m_can_push));
+        condvarInit(std::addressof(m_can_pop));
+    }
+
+    // swaps buf into the ring, the caller gets back a previously used buffer.
+    // blocks whilst the ring is full, returns false if the ring has been closed.
+    auto Push(std::vector<u8>& buf, s64 off) -> bool {
+        const auto w_index = m_w_index.load();
+        const auto can_push = [this, w_index]() {
+            return w_index - m_r_index.load() < m_depth.load();
+        };
+
+        if (!Wait(m_can_push, m_push_waiting, m_push_waits, can_push, true)) {
+            return false;
+        }
+
+        auto& e = m_entries[w_index % Size];
+        std::swap(e.buf, buf);
+        e.off = off;
+
+        m_w_index = w_index + 1;
+        Notify(m_can_pop, m_pop_waiting);
+        return true;
+    }
+
+    // swaps the oldest buffer out of the ring.
+    // blocks whilst the ring is empty, returns false if the ring is empty and has been closed.
+    auto Pop(std::vector<u8>& buf, s64& off) -> bool {
+        const auto r_index = m_r_index.load();
+        const auto can_pop = [this, r_index]() {
+            return m_w_index.load() != r_index;
+        };
+
+        if (!Wait(m_can_pop, m_pop_waiting, m_pop_waits, can_pop, false)) {
+            return false;
+        }
+
+        auto& e = m_entries[r_index % Size];
+        std::swap(e.buf, buf);
+        off = e.off;
+
+        m_r_index = r_index + 1;
+        Notify(m_can_push, m_push_waiting);
+        return true;
+    }
+
+    // wakes up both sides. after closing, Push() fails and Pop() returns
+    // the remaining data before failing.
+    void Close() {
+        m_closed = true;
+
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        condvarWakeAll(std::addressof(m_can_push));
+        condvarWakeAll(std::addressof(m_can_pop));
+    }
+
+    // fills every slot with a buffer from the pool, so that neither side allocates
+    // once the transfer has started. every slot ends up holding a buffer after
+    // the first lap anyway, so this doesn't use any more memory.
+    // only call before the producer and consumer have started.
+    void Reserve(BufferPool& pool) {
+        for (auto& e : m_entries) {
+            pool.AcquireIfEmpty(e.buf);
+        }
+    }
+
+    // returns the buffers held in the ring to the pool.
+    // only call once both the producer and consumer have exited.
+    void Release(BufferPool& pool) {
+        for (auto& e : m_entries) {
+            pool.Release(e.buf);
+        }
+    }
+
+    // sets how many buffers can be queued, clamped to 1..Size.
+    // should only be called by the producer.
+    void SetDepth(u32 depth) {
+        m_depth = std::clamp<u32>(depth, 1, Size);
+    }
+
+    auto GetDepth() const -> u32 {
+        return m_depth;
+    }
+
+    // number of times the producer had to sleep as the ring was full.
+    auto GetPushWaits() const -> u32 {
+        return m_push_waits;
+    }
+
+    // number of times the consumer had to sleep as the ring was empty.
+    auto GetPopWaits() const -> u32 {
+        return m_pop_waits;
+    }
+
+    auto IsClosed() const -> bool {
+        return m_closed;
+    }
+
+    auto GetSize() const -> u32 {
+        return m_w_index.load() - m_r_index.load();
+    }
+
+private:
+    template<typename F>
+    auto Wait(CondVar& cond, std::atomic_bool& waiting, std::atomic<u32>& waits, const F& ready, bool fail_on_close) -> bool {
+        if (fail_on_close && m_closed) {
+            return false;
+        }
+
+        // fast path, no locking.
+        if (ready()) {
+            return true;
+        }
+
+        waits++;
+        SCOPED_MUTEX(std::addressof(m_mutex));
+
+        // the other side checks the waiting flag after updating its index,
+        // so either it sees the flag or ready() sees the new index.
+        waiting = true;
+        ON_SCOPE_EXIT(waiting = false);
+
+        while (!ready()) {
+            if (m_closed) {
+                return false;
+            }
+            condvarWait(std::addressof(cond), std::addressof(m_mutex));
+        }
+
+        return !fail_on_close || !m_closed;
+    }
+
+    void Notify(CondVar& cond, const std::atomic_bool& waiting) {
+        if (waiting) {
+            SCOPED_MUTEX(std::addressof(m_mutex));
+            condvarWakeOne(std::addressof(cond));
+        }
+    }
+
+private:
+    struct Entry {
+        std::vector<u8> buf{};
+        s64 off{};
+    };
+
+    Entry m_entries[Size]{};
+
+    // kept on separate cache lines as they are written by different threads.
+    // indices are ever increasing, the slot is the index modulo Size.
+    alignas(64) std::atomic<u32> m_w_index{};
+    alignas(64) std::atomic<u32> m_r_index{};
+
+    std::atomic<u32> m_depth{Size};
+    std::atomic<u32> m_push_waits{};
+    std::atomic<u32> m_pop_waits{};
+
+    std::atomic_bool m_push_waiting{};
+    std::atomic_bool m_pop_waiting{};
+    std::atomic_bool m_closed{};
+
+    Mutex m_mutex{};
+    CondVar m_can_push{};
+    CondVar m_can_pop{};
+};
+
+} // namespace npshop
@@ -2,6 +2,7 @@
 
 #include "ui/progress_box.hpp"
 #include <functional>
+#include <span>
 #include <switch.h>
 
 namespace npshop::thread {
@@ -31,6 +32,35 @@ using StartCallback = std::function<Result(PullCallback pull)>;
 // trying to read from the pull callback before it is set.
 using StartCallback2 = std::function<Result(StartThreadCallback start, PullCallback pull)>;
 
+// throttles io on file based emummc, as the system needs to access the sd card
+// at the same time. the sleep after each io grows when the io is slower than the
+// fastest seen (the sd card is busy) and shrinks when it isn't.
+// does nothing if not using file based emummc.
+struct Throttle {
+    Throttle();
+    Throttle(bool enabled);
+
+    template<typename F>
+    auto Run(s64 size, const F& func) -> Result {
+        if (!m_enabled) {
+            return func();
+        }
+
+        const auto start = armGetSystemTick();
+        const auto rc = func();
+        Update(armTicksToNs(armGetSystemTick() - start), size);
+        return rc;
+    }
+
+private:
+    void Update(u64 elapsed_ns, s64 size);
+
+private:
+    bool m_enabled{};
+    double m_best_ns_per_kib{};
+    u64 m_sleep_ns{};
+};
+
 // reads data from rfunc into wfunc.
 Result Transfer(ui::ProgressBox* pbox, s64 size, ReadCallback rfunc, WriteCallback wfunc, Mode mode = Mode::MultiThreaded);
 
@@ -38,6 +68,23 @@ Result Transfer(ui::ProgressBox* pbox, s64 size, ReadCallback rfunc, WriteCallba
 Result TransferPull(ui::ProgressBox* pbox, s64 size, ReadCallback rfunc, StartCallback sfunc, Mode mode = Mode::MultiThreaded);
 Result TransferPull(ui::ProgressBox* pbox, s64 size, ReadCallback rfunc, StartCallback2 sfunc, Mode mode = Mode::MultiThreaded);
 
+struct CopyEntry {
+    fs::FsPath src{};
+    fs::FsPath dst{};
+    // size from the folder listing, the copy fails if the file has since changed size.
+    // ignored for non-native fs, as their listings don't include the size.
+    s64 size{};
+};
+
+// called for each file that was copied, in order, once all copying has finished.
+using CopyDoneCallback = std::function<Result(const CopyEntry& entry)>;
+
+// copies many files using the same read / write threads for all of them.
+// the next file is opened whilst the current one is being written,
+// which is much faster than calling Transfer() per file when copying lots of small files.
+// the parent folders of the dst files must already exist.
+Result TransferCopyBatch(ui::ProgressBox* pbox, fs::Fs* fs_src, fs::Fs* fs_dst, std::span<const CopyEntry> entries, CopyDoneCallback on_done = nullptr, Mode mode = Mode::MultiThreaded);
+
 // helper for extract zips.
 // this will multi-thread unzip if size >= 512KiB, otherwise it'll single pass.
 Result TransferUnzip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& path, s64 size, u32 crc32 = 0, Mode mode = Mode::SingleThreadedIfSmaller);
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "fs.hpp"
+#include "image.hpp"
+#include "ui/types.hpp"
+#include <switch.h>
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include <string_view>
+#include <optional>
+
+namespace npshop::thumb {
+
+// size of each thumbnail, the grid layouts draw icons at 174 or smaller.
+constexpr int THUMB_SIZE = 128;
+// size of each atlas page, which is uploaded as a single texture.
+constexpr int PAGE_SIZE = 1024;
+constexpr int THUMBS_PER_ROW = PAGE_SIZE / THUMB_SIZE;
+constexpr int THUMBS_PER_PAGE = THUMBS_PER_ROW * THUMBS_PER_ROW;
+
+struct Thumb {
+    int image{}; // nvg image of the page
+    Vec4 src{}; // region of the page
+};
+
+// on-disk cache of decoded icons, resized to THUMB_SIZE and packed into atlas pages.
+// pages are stored as raw rgba, so opening a menu reads and uploads one texture
+// per page rather than decoding a jpeg per entry.
+// entries are keyed by app id or path hash, the stamp (e.g. mtime) invalidates
+// the entry once it changes.
+// pages are read, thumbnails are resized and stored, and changed pages are written
+// by a thread, the main thread only uploads the pages once they're read.
+// Get() should only be called from the main thread, Set() can be called from any thread.
+struct Cache {
+    // stored in /switch/npshop/cache/thumbs/<name>/
+    explicit Cache(const char* name, u32 max_pages = 16);
+    // stores and saves any changes that haven't been written yet and frees the textures.
+    ~Cache();
+
+    // returns true if key is cached with a matching stamp and its page is uploaded.
+    // if the page hasn't been read yet, it's read by the thread and uploaded by
+    // a later call, Contains() can be used to know if it's worth waiting for.
+    // thumbnails set since the page was uploaded aren't returned until the next time
+    // the cache is opened, so the caller should keep its own image for those.
+    auto Get(u64 key, u64 stamp, Thumb& out) -> bool;
+
+    // returns true if Get() will return the thumbnail once its page is uploaded.
+    auto Contains(u64 key, u64 stamp) -> bool;
+
+    // queues the decoded icon to be resized and stored by the thread.
+    void Set(u64 key, u64 stamp, ImageResult image);
+
+private:
+    struct Entry {
+        u64 stamp;
+        u32 slot;
+        // order in which the thumbnails were set, 0 if loaded from the index.
+        u32 seq;
+        // set until the page holding the thumbnail has been uploaded.
+        bool pending;
+        // set if the entry was used since opening, unused entries are
+        // replaced once the cache is full.
+        bool used;
+        // set once the page holding the thumbnail has been written,
+        // only these entries are written to the index.
+        bool saved;
+    };
+
+    struct Page {
+        std::vector<u8> data{};
+        int image{};
+        bool dirty{};
+        // set whilst the page is queued to be read for Get().
+        bool requested{};
+    };
+
+    struct Job {
+        u64 key;
+        u64 stamp;
+        ImageResult image;
+    };
+
+    // resizes and stores the thumbnail.
+    void Store(const Job& job);
+    // writes changed pages and the index.
+    void Save();
+
+    void LoadIndex(const char* name);
+    void LoadRequestedPage(u32 page);
+    auto ReadPage(u32 page) const -> std::vector<u8>;
+    auto SetPageData(u32 page, std::vector<u8>&& data) -> bool;
+    auto FindSlot(u64 key) const -> std::optional<u32>;
+    auto GetPagePath(u32 page) const -> fs::FsPath;
+
+    static void ThreadFunc(void* p);
+
+private:
+    fs::FsPath m_path{};
+    const u32 m_max_pages;
+    Mutex m_mutex{};
+    std::unordered_map<u64, Entry> m_entries{};
+    std::vector<Page> m_pages{};
+    u32 m_next_slot{};
+    u32 m_seq{};
+    bool m_index_dirty{};
+
+    Thread m_thread{};
+    CondVar m_can_work{};
+    std::deque<Job> m_jobs{};
+    std::deque<u32> m_page_requests{};
+    // tick of the last stored thumbnail, pages are only written once it's idle.
+    u64 m_last_set{};
+    bool m_running{};
+    bool m_thread_created{};
+};
+
+// resizes the decoded icon to THUMB_SIZE.
+auto Resize(const ImageResult& image) -> ImageResult;
+
+// key for entries that are cached by path or url.
+auto GetKey(std::string_view str) -> u64;
+
+// stamp for installed applications, the icon is read from the control data
+// of the latest patch, so it only changes along with the installed versions.
+auto GetAppStamp(u64 app_id) -> u64;
+
+} // namespace npshop::thumb
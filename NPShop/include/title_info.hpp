@@ -57,8 +57,11 @@ void Exit();
 // clears cache and empties the result array.
 void Clear();
 
-// adds new entry to queue.
+// adds new entry to the front of the queue.
 void PushAsync(u64 app_id);
+// adds every entry to the back of the queue, entries found in the title cache
+// are loaded before the rest. the time taken to load the list is logged.
+void PushAsync(std::span<const u64> app_ids);
 // gets entry without removing it from the queue.
 auto GetAsync(u64 app_id) -> ThreadResultData*;
 // single threaded title info fetch.
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ui/types.hpp"
+#include <switch.h>
+#include <atomic>
+#include <string>
+
+namespace npshop {
+
+// per-stage counters for the threaded transfers (installs and file transfers).
+// counters are only ever added to, so stages update them from their own thread
+// whilst the progress box reads them for the overlay.
+struct TransferStats {
+    enum Stage {
+        Stage_Read,
+        Stage_Decompress,
+        Stage_Write,
+        Stage_Max,
+    };
+
+    struct StageCounters {
+        std::atomic<u64> bytes{};
+        // total time spent in the stage loop, including waiting.
+        std::atomic<u64> running_ns{};
+        // time spent waiting for the previous stage (queue empty).
+        std::atomic<u64> empty_ns{};
+        // time spent waiting for the next stage (queue full).
+        std::atomic<u64> full_ns{};
+
+        auto GetBusyNs() const -> u64 {
+            const auto waited = empty_ns.load() + full_ns.load();
+            const auto running = running_ns.load();
+            return running > waited ? running - waited : 0;
+        }
+    };
+
+    explicit TransferStats(const char* name) : m_name{name} {
+    }
+
+    auto GetStage(Stage stage) -> StageCounters& {
+        return m_stages[stage];
+    }
+
+    auto GetStage(Stage stage) const -> const StageCounters& {
+        return m_stages[stage];
+    }
+
+    auto GetElapsedNs() const -> u64 {
+        return m_timestamp.GetNs();
+    }
+
+    // one line per stage that has run, plus one for the zstd / aes / sha time.
+    auto Format() const -> std::string;
+    // writes a summary to /config/npshop/stats/<name>.json, overwriting the last one.
+    void Save() const;
+
+    std::atomic<u64> zstd_ns{};
+    std::atomic<u64> aes_ns{};
+    std::atomic<u64> sha_ns{};
+
+private:
+    const char* m_name{};
+    StageCounters m_stages[Stage_Max]{};
+    TimeStamp m_timestamp{};
+};
+
+// adds the time spent in the scope to the counter.
+struct ScopedStatsTimer {
+    explicit ScopedStatsTimer(std::atomic<u64>& counter) : m_counter{counter}, m_start{armGetSystemTick()} {
+    }
+
+    ~ScopedStatsTimer() {
+        m_counter += armTicksToNs(armGetSystemTick() - m_start);
+    }
+
+private:
+    std::atomic<u64>& m_counter;
+    const u64 m_start;
+};
+
+} // namespace npshop
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "ui/list.hpp"
+#include "image.hpp"
+#include <switch.h>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+
+namespace npshop::ui {
+
+// loads the images of the list menus (homebrew, appstore, themezer).
+// images are decoded on a background thread, nearest to the visible entries first,
+// whilst requests that are more than a page away from the visible entries are dropped.
+// decoded images are uploaded on the main thread, a few per frame, and the least
+// recently drawn images are freed once there are more than max_images.
+// all functions should only be called from the main thread.
+struct ImageLoader {
+    struct Image {
+        int image{}; // nvg image, 0 if not loaded
+        int w{}, h{};
+        u8 first_pixel[4]{};
+    };
+
+    // runs on the loader thread, reads and decodes the image.
+    using LoadFunc = std::function<ImageResult()>;
+
+    explicit ImageLoader(u32 max_images = 128);
+    ~ImageLoader();
+
+    // call before drawing the list, updates the range of visible entries.
+    void BeginFrame(const List& list, s64 count);
+
+    // range of entries that should be requested before the list is drawn, this is
+    // the visible entries plus a page ahead and behind, so scrolling doesn't show blank icons.
+    auto GetPrefetchStart() const -> s64 { return m_prefetch_start; }
+    auto GetPrefetchEnd() const -> s64 { return m_prefetch_end; }
+
+    // returns the image for key, which is empty until it has been loaded.
+    // if it's not loaded yet, make_func() is called to create the load for the thread.
+    template<typename F>
+    auto Get(u64 key, s64 index, const F& make_func) -> const Image& {
+        auto& e = m_images[key];
+        e.last_used = m_frame;
+        if (e.state == State::None && index >= m_prefetch_start && index < m_prefetch_end) {
+            Queue(key, e, index, make_func());
+        }
+        return e.image;
+    }
+
+    // returns the image for key if it's loaded, without queueing it.
+    auto Find(u64 key) const -> int {
+        const auto it = m_images.find(key);
+        return it != m_images.end() ? it->second.image.image : 0;
+    }
+
+    // uploads the decoded images and frees unused ones, call after drawing the list.
+    void EndFrame(NVGcontext* vg);
+
+    // frees the image so that it's loaded again next time, e.g. when the file changed.
+    void Remove(u64 key);
+
+    // frees all images and drops all requests, call when the list entries change.
+    void Clear();
+
+private:
+    enum class State {
+        None,
+        Queued,
+        Loaded,
+        Failed,
+    };
+
+    struct Entry {
+        Image image{};
+        State state{State::None};
+        u64 last_used{};
+        // used to drop results of requests that were removed whilst loading.
+        u32 request_id{};
+    };
+
+    struct Job {
+        u64 key;
+        u32 request_id;
+        s64 index;
+        LoadFunc func;
+    };
+
+    struct LoadResult {
+        u64 key;
+        u32 request_id;
+        ImageResult image;
+    };
+
+    void Queue(u64 key, Entry& e, s64 index, LoadFunc&& func);
+    void FreeImage(Entry& e);
+    static void ThreadFunc(void* p);
+
+private:
+    const u32 m_max_images;
+    std::unordered_map<u64, Entry> m_images{};
+    u64 m_frame{};
+    u32 m_next_request_id{};
+    u32 m_loaded_count{};
+    s64 m_prefetch_start{};
+    s64 m_prefetch_end{};
+
+    // shared with the thread.
+    Mutex m_mutex{};
+    CondVar m_can_pop{};
+    std::vector<Job> m_jobs{};
+    std::vector<LoadResult> m_results{};
+    s64 m_visible_start{};
+    s64 m_visible_end{};
+    std::atomic_bool m_running{};
+    Thread m_thread{};
+    bool m_thread_created{};
+};
+
+} // namespace npshop::ui
@@ -32,6 +32,9 @@ struct List final : Object {
         return m_yoff;
     }
 
+    // index of the first entry in view, the visible entries are from here to + GetPage().
+    auto GetVisibleStart(s64 count) const -> s64;
+
     void SetYoff(float y = 0) {
         m_yoff = y;
     }
@@ -4,6 +4,7 @@
 #include "ui/scrollable_text.hpp"
 #include "ui/scrolling_text.hpp"
 #include "ui/list.hpp"
+#include "ui/image_loader.hpp"
 #include "fs.hpp"
 #include "option.hpp"
 #include <span>
@@ -200,6 +201,7 @@ private:
     LazyImage m_installed{};
     ImageDownloadState m_repo_download_state{ImageDownloadState::None};
     std::unique_ptr<List> m_list{};
+    ImageLoader m_image_loader{};
 
     std::string m_search_term{};
     std::string m_author_term{};
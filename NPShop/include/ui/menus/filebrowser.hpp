@@ -270,7 +270,7 @@ namespace npshop::ui::menu::filebrowser {
             return (fs::FsNative*)m_fs.get();
         }
 
-        void DisplayHash(hash::Type type);
+        void DisplayHash(std::span<const hash::Type> types);
 
         void DisplayOptions();
         void DisplayAdvancedOptions();
@@ -18,6 +18,8 @@ struct Entry {
     int image{};
     bool selected{};
     title::NacpLoadStatus status{title::NacpLoadStatus::None};
+    // installed versions, the thumbnail is replaced once they change.
+    u64 thumb_stamp{};
 
     auto GetName() const -> const char* {
         return lang.name;
@@ -99,6 +101,8 @@ private:
     option::OptionLong m_layout{INI_SECTION, "layout", LayoutType::LayoutType_Grid};
     option::OptionBool m_hide_forwarders{INI_SECTION, "hide_forwarders", false};
     option::OptionBool m_title_cache{INI_SECTION, "title_cache", true};
+
+    thumb::Cache m_thumbs{"games"};
 };
 
 } // namespace npshop::ui::menu::game
@@ -3,6 +3,7 @@
 #include "ui/menus/menu_base.hpp"
 #include "ui/scrolling_text.hpp"
 #include "ui/list.hpp"
+#include "thumb_cache.hpp"
 #include <string>
 #include <memory>
 
@@ -20,6 +21,8 @@ struct Menu : MenuBase {
 protected:
     void OnLayoutChange(std::unique_ptr<List>& list, int layout);
     void DrawEntry(NVGcontext* vg, Theme* theme, int layout, const Vec4& v, bool selected, int image, const char* name, const char* author, const char* version);
+    // same as above but draws the image from the thumbnail cache.
+    void DrawEntry(NVGcontext* vg, Theme* theme, int layout, const Vec4& v, bool selected, const thumb::Thumb& thumb, const char* name, const char* author, const char* version);
     // same as above but doesn't draw image and returns image dimension.
     Vec4 DrawEntryNoImage(NVGcontext* vg, Theme* theme, int layout, const Vec4& v, bool selected, const char* name, const char* author, const char* version);
 
@@ -2,6 +2,7 @@
 
 #include "ui/menus/grid_menu_base.hpp"
 #include "ui/list.hpp"
+#include "ui/image_loader.hpp"
 #include "nro.hpp"
 #include "fs.hpp"
 #include "option.hpp"
@@ -75,6 +76,9 @@ private:
 
     s64 m_index{}; // where i am in the array
     std::unique_ptr<List> m_list{};
+    // declared before the loader as its thread stores the thumbnails.
+    thumb::Cache m_thumbs{"homebrew"};
+    ImageLoader m_image_loader{};
     bool m_dirty{};
 
     option::OptionLong m_sort{INI_SECTION, "sort", SortType::SortType_AlphabeticalStar};
@@ -30,10 +30,20 @@ struct Stream final : yati::source::Stream {
     void Disable();
     auto& GetPath() const { return m_path; }
 
+protected:
+    Result Skip(s64 size, u64* bytes_skipped) override;
+
+private:
+    // reads from the buffer, or drops the data if buf is null.
+    Result Pop(u8* buf, s64 size, u64* bytes_read);
+
 private:
     fs::FsPath m_path{};
     std::stop_token m_token{};
+    // ring buffer of fixed size, written by Push() and read by ReadChunk().
     std::vector<u8> m_buffer{};
+    u64 m_read_offset{};
+    u64 m_size{};
     CondVar m_can_read{};
     CondVar m_can_write{};
 
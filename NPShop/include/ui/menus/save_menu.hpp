@@ -17,6 +17,8 @@ struct Entry final : FsSaveDataInfo {
     int image{};
     bool selected{};
     title::NacpLoadStatus status{title::NacpLoadStatus::None};
+    // installed versions, the thumbnail is replaced once they change.
+    u64 thumb_stamp{};
 
     auto GetName() const -> const char* {
         return lang.name;
@@ -106,6 +108,8 @@ private:
     option::OptionLong m_layout{INI_SECTION, "layout", LayoutType::LayoutType_Grid};
     option::OptionBool m_auto_backup_on_restore{INI_SECTION, "auto_backup_on_restore", true};
     option::OptionBool m_compress_save_backup{INI_SECTION, "compress_save_backup", true};
+
+    thumb::Cache m_thumbs{"saves"};
 };
 
 } // namespace npshop::ui::menu::save
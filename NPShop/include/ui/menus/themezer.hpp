@@ -4,6 +4,7 @@
 #include "ui/scrollable_text.hpp"
 #include "ui/scrolling_text.hpp"
 #include "ui/list.hpp"
+#include "ui/image_loader.hpp"
 #include "option.hpp"
 #include <span>
 
@@ -162,6 +163,7 @@ private:
 
     s64 m_index{}; // where i am in the array
     std::unique_ptr<List> m_list{};
+    ImageLoader m_image_loader{};
 
     ScrollingText m_scroll_name{};
     ScrollingText m_scroll_author{};
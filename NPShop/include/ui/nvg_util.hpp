@@ -8,6 +8,8 @@ namespace npshop::ui::gfx {
 
 void drawImage(NVGcontext*, float x, float y, float w, float h, int texture, float rounded = 0.F, float alpha = 1.0F);
 void drawImage(NVGcontext*, const Vec4& v, int texture, float rounded = 0.F, float alpha = 1.0F);
+// draws the src region of a texture that is texture_w x texture_h, e.g. an atlas page.
+void drawImageRegion(NVGcontext*, const Vec4& v, int texture, float texture_w, float texture_h, const Vec4& src, float rounded = 0.F, float alpha = 1.0F);
 
 void dimBackground(NVGcontext*);
 
@@ -6,6 +6,10 @@
 #include <functional>
 #include <span>
 
+namespace npshop {
+struct TransferStats;
+} // namespace npshop
+
 namespace npshop::ui {
 
 struct ProgressBox;
@@ -33,6 +37,9 @@ struct ProgressBox final : Widget {
     auto SetImage(int image) -> ProgressBox&;
     auto SetImageData(std::vector<u8>& data) -> ProgressBox&;
     auto SetImageDataConst(std::span<const u8> data) -> ProgressBox&;
+    // shown as an overlay if enabled in the options, must be cleared before stats is freed.
+    auto SetStats(const TransferStats* stats) -> ProgressBox&;
+    auto GetStats() -> const TransferStats*;
 
     void RequestExit();
     auto ShouldExit() -> bool;
@@ -98,6 +105,7 @@ private:
     std::vector<u8> m_image_data{};
     int m_image_pending{};
     bool m_is_image_pending{};
+    const TransferStats* m_stats{};
     // shared data end.
 
     ScrollingText m_scroll_title{};
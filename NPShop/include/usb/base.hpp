@@ -7,6 +7,9 @@
 
 namespace npshop::usb {
 
+// max transfers that are posted to an endpoint at once.
+constexpr u32 TRANSFER_QUEUE_DEPTH = 3;
+
 struct Base {
     Base(u64 transfer_timeout);
     virtual ~Base();
@@ -23,7 +26,7 @@ struct Base {
         return TransferPacketImpl(read, page, remaining, size, out_size_transferred, m_transfer_timeout);
     }
 
-    // transfers all data.
+    // transfers all data, large transfers are split and queued.
     Result TransferAll(bool read, void *data, u32 size, u64 timeout);
     Result TransferAll(bool read, void *data, u32 size) {
         return TransferAll(read, data, size, m_transfer_timeout);
@@ -52,12 +55,21 @@ protected:
     virtual Event *GetCompletionEvent(UsbSessionEndpoint ep) = 0;
     virtual Result WaitTransferCompletion(UsbSessionEndpoint ep, u64 timeout) = 0;
     virtual Result TransferAsync(UsbSessionEndpoint ep, void *buffer, u32 remaining, u32 size, u32 *out_xfer_id) = 0;
+    // returns LibnxError_NotFound if the transfer hasn't completed yet.
     virtual Result GetTransferResult(UsbSessionEndpoint ep, u32 xfer_id, u32 *out_requested_size, u32 *out_transferred_size) = 0;
 
+private:
+    Result WaitForTransfer(UsbSessionEndpoint ep, u32 xfer_id, u32 *out_size_transferred, u64 timeout);
+    Result TransferQueued(bool read, u8* buf, u32 size, u64 timeout);
+
 private:
     u64 m_transfer_timeout{};
     UEvent m_uevent{};
     std::unique_ptr<u8*> m_aligned{};
+
+    // speed of queued transfers, logged every few seconds.
+    u64 m_stats_bytes{};
+    u64 m_stats_ns{};
 };
 
 } // namespace npshop::usb
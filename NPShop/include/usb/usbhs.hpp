@@ -1,6 +1,7 @@
 #pragma once
 
 #include "base.hpp"
+#include <vector>
 
 namespace npshop::usb {
 
@@ -26,6 +27,8 @@ private:
     UsbHsInterface m_interface{};
     UsbHsClientIfSession m_s{};
     UsbHsClientEpSession m_endpoints[2]{};
+    // reports of completed transfers that haven't been asked for yet.
+    std::vector<UsbHsXferReport> m_reports[2]{};
     Event m_event{};
     bool m_connected{};
 };
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <switch.h>
+#include <cstring>
+#include <bit>
 
 namespace npshop::crypto {
 
@@ -46,6 +48,56 @@ private:
     bool m_is_encryptor;
 };
 
+// aes-ctr as used by nca sections. the counter is the 8 byte section nonce followed by
+// the big endian block number (offset / 0x10), so any offset can be seeked to
+// without building the counter by hand.
+struct Aes128Ctr {
+    Aes128Ctr() = default;
+    Aes128Ctr(const void* key, const void* nonce, u64 offset = 0) {
+        std::memcpy(m_nonce, nonce, sizeof(m_nonce));
+
+        u8 ctr[0x10]{};
+        aes128CtrContextCreate(&m_ctx, key, ctr);
+        Seek(offset);
+    }
+
+    // offset does not need to be block aligned.
+    void Seek(u64 offset) {
+        u8 ctr[0x10];
+        const auto block = std::byteswap(offset >> 4);
+        std::memcpy(ctr + 0x0, m_nonce, sizeof(m_nonce));
+        std::memcpy(ctr + 0x8, &block, sizeof(block));
+        aes128CtrContextResetCtr(&m_ctx, ctr);
+
+        // for mid-block offsets, skip over the start of the block's keystream.
+        if (const auto partial = offset & 0xF) {
+            u8 dummy[0x10]{};
+            aes128CtrCrypt(&m_ctx, dummy, dummy, partial);
+        }
+
+        m_offset = offset;
+    }
+
+    // encrypt and decrypt are the same, carries on from the current offset.
+    void Run(void* dst, const void* src, u64 size) {
+        aes128CtrCrypt(&m_ctx, dst, src, size);
+        m_offset += size;
+    }
+
+    auto GetOffset() const -> u64 {
+        return m_offset;
+    }
+
+private:
+    Aes128CtrContext m_ctx{};
+    u8 m_nonce[0x8]{};
+    u64 m_offset{};
+};
+
+// known-answer test of Aes128Ctr, including non block aligned seeks.
+// returns false and logs the failing range on mismatch.
+auto Aes128CtrSelfTest() -> bool;
+
 static inline void cryptoAes128(const void *in, void *out, const void* key, bool is_encryptor) {
     Aes128(key, is_encryptor).Run(out, in);
 }
@@ -14,10 +14,28 @@ struct Base {
         return false;
     }
 
+    // set if reads at different offsets can be interleaved without a large cost,
+    // which allows for several ncas to be installed at once.
+    // reads are still serialised by the caller.
+    virtual bool SupportsParallelReads() const {
+        return false;
+    }
+
     virtual void SignalCancel() {
 
     }
 
+    // hint that [off, off + size) is about to be read in order, sources
+    // that have a high latency per read can use this to read ahead.
+    virtual void HintSequentialRead(s64 off, s64 size) {
+
+    }
+
+    // max memory held for data that was read ahead, for reads of up to read_size.
+    virtual u64 GetReadAheadMemory(s64 read_size) const {
+        return 0;
+    }
+
     Result GetOpenResult() const {
         return m_open_result;
     }
@@ -11,6 +11,10 @@ struct File final : Base {
     File(fs::Fs* fs, const fs::FsPath& path);
     Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
 
+    bool SupportsParallelReads() const override {
+        return true;
+    }
+
 private:
     fs::Fs* m_fs{};
     fs::File m_file{};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "base.hpp"
+#include "download.hpp"
+#include <string>
+#include <vector>
+#include <stop_token>
+#include <switch.h>
+
+namespace npshop::yati::source {
+
+// random access source over http(s) using range requests.
+// this allows for installing directly from a url without having
+// to first download the file to the sd card.
+struct Http final : Base {
+    Http(const std::string& url);
+    ~Http();
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
+
+    void SignalCancel() override {
+        m_stop_source.request_stop();
+    }
+
+    auto GetSize() const -> s64 {
+        return m_size;
+    }
+
+private:
+    Result GetContentLength();
+    Result Fill(s64 off, s64 size, bool sequential);
+    Result RangeRequest(void* buf, s64 off, s64 size, s64* content_length = nullptr);
+
+private:
+    // CURL handle, re-used for every request so that the connection is kept alive.
+    void* m_curl{};
+    std::string m_url{};
+    s64 m_size{};
+
+    // read-ahead window.
+    std::vector<u8> m_buffer{};
+    s64 m_buffer_off{};
+    // end offset of the last read, used to detect sequential reads.
+    s64 m_last_read_end{};
+
+    std::stop_source m_stop_source{};
+    // options shared with the rest of the downloads, stopped by SignalCancel().
+    curl::Api m_api{};
+};
+
+} // namespace npshop::yati::source
@@ -22,11 +22,18 @@ struct Stream : Base {
         m_offset = 0;
     }
 
+protected:
+    // skips up to size bytes forward, returning the amount skipped.
+    // by default this reads into a small scratch buffer and discards it,
+    // override if the transport can seek or drop the data without copying.
+    virtual Result Skip(s64 size, u64* bytes_skipped);
+
 protected:
     Result m_open_result{};
 
 private:
     s64 m_offset{};
+    std::vector<u8> m_skip_buf{};
 };
 
 } // namespace npshop::yati::source
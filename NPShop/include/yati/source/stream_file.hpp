@@ -13,10 +13,14 @@ struct StreamFile final : Stream {
     StreamFile(fs::Fs* fs, const fs::FsPath& path);
     Result ReadChunk(void* buf, s64 size, u64* bytes_read) override;
 
+protected:
+    Result Skip(s64 size, u64* bytes_skipped) override;
+
 private:
     fs::Fs* m_fs{};
     fs::File m_file{};
     s64 m_offset{};
+    s64 m_size{};
 };
 
 } // namespace npshop::yati::source
@@ -6,6 +6,8 @@
 
 #include <string>
 #include <memory>
+#include <deque>
+#include <atomic>
 #include <switch.h>
 
 namespace npshop::yati::source {
@@ -15,7 +17,14 @@ struct Usb final : Base {
     ~Usb();
 
     bool IsStream() const override;
+
+    // each read is a separate file range request.
+    bool SupportsParallelReads() const override {
+        return !IsStream();
+    }
     Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
+    void HintSequentialRead(s64 off, s64 size) override;
+    u64 GetReadAheadMemory(s64 read_size) const override;
     Result Finished(u64 timeout);
 
     Result IsUsbConnected(u64 timeout) {
@@ -30,13 +39,61 @@ struct Usb final : Base {
     }
 
 private:
+    struct Request {
+        s64 off;
+        s64 size;
+    };
+
+    // data of a request that was received before it was read.
+    struct Chunk {
+        s64 off;
+        std::vector<u8> data;
+    };
+
     Result SendCmdHeader(u32 cmdId, size_t dataSize, u64 timeout);
-    Result SendFileRangeCmd(u64 offset, u64 size, u64 timeout);
+    Result SendFileRangeCmd(const std::string& name, u64 offset, u64 size, u64 timeout);
+    Result SendPacket(const void* data, u32 size, u64 timeout);
+    Result ReceiveFileRange(void* buf, s64 size, u64 timeout);
+
+    // pipelined reads, used in random access mode.
+    Result ReadPipelined(u8* buf, s64 off, s64 size);
+    auto TakeChunk(u8* buf, s64 off, s64 size) -> s64;
+    void Queue(s64 off, s64 size);
+    void QueueReadAhead(s64 off, s64 size);
+    auto IsQueued(s64 off) const -> bool;
+    Result Drain();
+
+    void StartSender();
+    void StopSender();
+    static void SenderThreadFunc(void* p);
+    void SenderLoop();
 
 private:
     std::unique_ptr<usb::UsbDs> m_usb;
     std::string m_transfer_file_name{};
     u8 m_flags{};
+
+    // requests are sent from a separate thread, so that the host can read the
+    // next request whilst this thread is still reading the previous data.
+    // the host replies to requests in order, so m_inflight is in reply order.
+    Thread m_thread{};
+    bool m_thread_started{};
+    Mutex m_mutex{};
+    CondVar m_can_send{};
+    std::deque<Request> m_send_queue{};
+    std::atomic<Result> m_send_result{};
+    bool m_running{};
+    bool m_sending{};
+
+    std::deque<Request> m_inflight{};
+    std::vector<Chunk> m_chunks{};
+    // ranges that are being read in order, read ahead is limited to these
+    // so that a request is never sent past the end of the file.
+    std::vector<Request> m_hints{};
+
+    // requests are sent from this page rather than the shared transfer buffer,
+    // as they are sent whilst data is being received.
+    alignas(0x1000) u8 m_page[0x1000]{};
 };
 
 } // namespace npshop::yati::source
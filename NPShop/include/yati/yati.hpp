@@ -63,6 +63,13 @@ struct Config {
     // if mkey is higher than fw version, the game still won't launch
     // as the fw won't have the key to decrypt keak.
     bool lower_system_version{};
+
+    // max number of ncas installed at once, only used if the source supports parallel reads.
+    u32 max_parallel_ncas{};
+
+    // ncas are only installed alongside another if their estimated
+    // buffer usage fits within this budget (in bytes).
+    u64 parallel_memory_budget{};
 };
 
 // overridable options, set to avoid
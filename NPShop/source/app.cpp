@@ -20,6 +20,8 @@
 #include "i18n.hpp"
 #include "web.hpp"
 #include "swkbd.hpp"
+#include "hasher.hpp"
+#include "yati/nx/crypto.hpp"
 
 #include <nanovg_dk.h>
 #include <minIni.h>
@@ -611,6 +613,22 @@ auto App::GetTextScrollSpeed() -> long {
     return g_app->m_text_scroll_speed.Get();
 }
 
+auto App::GetDownloadSegmentCount() -> long {
+    return std::clamp(g_app->m_download_segment_count.Get(), 1L, 16L);
+}
+
+auto App::GetDownloadMinSegmentSize() -> s64 {
+    return std::max(g_app->m_download_min_segment_size.Get(), 1L) * 1024 * 1024;
+}
+
+auto App::GetTransferAdaptiveEnable() -> bool {
+    return g_app->m_transfer_adaptive.Get();
+}
+
+auto App::GetTransferStatsEnable() -> bool {
+    return g_app->m_transfer_stats.Get();
+}
+
 auto App::Get12HourTimeEnable() -> bool {
     return g_app->m_12hour_time.Get();
 }
@@ -673,6 +691,10 @@ void App::SetTextScrollSpeed(long index) {
     g_app->m_text_scroll_speed.Set(index);
 }
 
+void App::SetDownloadSegmentCount(long count) {
+    g_app->m_download_segment_count.Set(count);
+}
+
 auto App::IsEmummc() -> bool {
     const auto& paths = g_app->m_emummc_paths;
     return (paths.file_based_path[0] != '\0') || (paths.nintendo[0] != '\0');
@@ -1003,6 +1025,10 @@ App::App(const char* argv0) {
             else if (app->m_install_emummc.LoadFrom(Key, Value)) {}
             else if (app->m_install_sd.LoadFrom(Key, Value)) {}
             else if (app->m_progress_boost_mode.LoadFrom(Key, Value)) {}
+            else if (app->m_install_parallel_ncas.LoadFrom(Key, Value)) {}
+            else if (app->m_install_memory_budget.LoadFrom(Key, Value)) {}
+            else if (app->m_transfer_adaptive.LoadFrom(Key, Value)) {}
+            else if (app->m_transfer_stats.LoadFrom(Key, Value)) {}
             else if (app->m_allow_downgrade.LoadFrom(Key, Value)) {}
             else if (app->m_skip_if_already_installed.LoadFrom(Key, Value)) {}
             else if (app->m_ticket_only.LoadFrom(Key, Value)) {}
@@ -1063,6 +1089,9 @@ App::App(const char* argv0) {
 
         splGetConfig((SplConfigItem)65010, &out);
         log_write("[ams] usb 3.0 enabled: %lu\n", out);
+
+        // only checked when logging, as the result is only reported in the log.
+        log_write("[crypto] aes-ctr self test: %s\n", crypto::Aes128CtrSelfTest() ? "passed" : "FAILED");
     }
 
     // get emummc config.
@@ -1246,6 +1275,12 @@ void App::DisplayAdvancedOptions(bool left_side) {
     text_scroll_speed_items.push_back("Normal"_i18n);
     text_scroll_speed_items.push_back("Fast"_i18n);
 
+    ui::SidebarEntryArray::Items download_segment_items;
+    download_segment_items.push_back("1");
+    download_segment_items.push_back("2");
+    download_segment_items.push_back("4");
+    download_segment_items.push_back("8");
+
     std::vector<std::string> menu_names;
     ui::SidebarEntryArray::Items menu_items;
     for (auto& e : ui::menu::main::GetMiscMenuEntries()) {
@@ -1265,10 +1300,28 @@ void App::DisplayAdvancedOptions(bool left_side) {
         "Enables boost mode during transfers which can improve transfer speed. "\
         "This sets the CPU to 1785mhz and lowers the GPU 76mhz"_i18n);
 
+    options->Add<ui::SidebarEntryBool>("Adaptive transfers"_i18n, App::GetApp()->m_transfer_adaptive,
+        "Measures transfer speed and adjusts the buffer size and number of queued buffers to match. "\
+        "Disable to always use fixed size buffers."_i18n);
+
+    options->Add<ui::SidebarEntryBool>("Transfer stats"_i18n, App::GetApp()->m_transfer_stats,
+        "Shows how busy each stage of a transfer / install is and how long it waited on the others. "\
+        "A summary is saved to /config/npshop/stats/ after each transfer."_i18n);
+
     options->Add<ui::SidebarEntryArray>("Text scroll speed"_i18n, text_scroll_speed_items, [](s64& index_out){
         App::SetTextScrollSpeed(index_out);
     }, App::GetTextScrollSpeed(), "Change how fast the scrolling text updates"_i18n);
 
+    s64 download_segment_index{};
+    while (download_segment_index < 3 && (1L << (download_segment_index + 1)) <= App::GetDownloadSegmentCount()) {
+        download_segment_index++;
+    }
+
+    options->Add<ui::SidebarEntryArray>("Download connections"_i18n, download_segment_items, [](s64& index_out){
+        App::SetDownloadSegmentCount(1L << index_out);
+    }, download_segment_index, "Number of connections used when downloading large files from the appstore. "\
+        "Interrupted downloads are resumed on the next attempt."_i18n);
+
     options->Add<ui::SidebarEntryArray>("Set left-side menu"_i18n, menu_items, [menu_names](s64& index_out){
         const auto e = menu_names[index_out];
         if (g_app->m_left_menu.Get() != e) {
@@ -1352,6 +1405,17 @@ void App::DisplayInstallOptions(bool left_side) {
         App::SetInstallSdEnable(index_out);
     }, (s64)App::GetInstallSdEnable());
 
+    ui::SidebarEntryArray::Items parallel_nca_items;
+    parallel_nca_items.push_back("1");
+    parallel_nca_items.push_back("2");
+    parallel_nca_items.push_back("3");
+
+    options->Add<ui::SidebarEntryArray>("Parallel NCA installs"_i18n, parallel_nca_items, [](s64& index_out){
+        g_app->m_install_parallel_ncas.Set(index_out + 1);
+    }, std::clamp(g_app->m_install_parallel_ncas.Get(), 1L, 3L) - 1, "Number of NCAs installed at the same time. "\
+        "Small NCAs (such as the icon) are installed whilst the game is installing. "\
+        "Only used when installing from files, gamecards and USB (non-stream)."_i18n);
+
     options->Add<ui::SidebarEntryBool>("Allow downgrade"_i18n, App::GetApp()->m_allow_downgrade,
         "Allows for installing title updates that are lower than the currently installed update."_i18n);
 
@@ -1510,6 +1574,7 @@ App::~App() {
 
     i18n::exit();
     curl::Exit();
+    hash::SaveCache();
 
     ini_puts("config", "theme", m_theme.meta.ini_path, CONFIG_PATH);
     CloseTheme();
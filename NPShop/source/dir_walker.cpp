@@ -0,0 +1,303 @@
+#include "dir_walker.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <cstring>
+
+namespace npshop::fs {
+namespace {
+
+// each worker has a single directory read in flight, so this also bounds
+// the number of reads in flight. the calling thread is one of the workers.
+constexpr u32 MAX_WORKERS = 3;
+
+struct Walker;
+
+struct Worker {
+    Walker* walker{};
+    u32 index{};
+    Thread thread{};
+    bool created{};
+    bool started{};
+
+    // only the owner pushes and pops from the back, others steal from the front.
+    Mutex mutex{};
+    std::deque<u32> queue{};
+};
+
+struct Node {
+    WalkEntry entry{};
+    // in the order they were listed.
+    std::vector<u32> children{};
+};
+
+struct Walker {
+    Walker(Fs* fs, const WalkConfig& config) : m_fs{fs}, m_config{config} {
+        mutexInit(std::addressof(m_nodes_mutex));
+        mutexInit(std::addressof(m_idle_mutex));
+        condvarInit(std::addressof(m_can_work));
+    }
+
+    ~Walker() {
+        Close();
+    }
+
+    Result Run(const FsPath& path, std::vector<WalkEntry>& out) {
+        auto& root = m_nodes.emplace_back();
+        root.entry.path = path;
+
+        // the root is listed first on this thread, small folders don't need any threads.
+        // stdio fs are not safe to access from multiple threads, so they're walked on this thread only.
+        m_workers.resize(m_fs->IsNative() ? MAX_WORKERS : 1);
+        for (u32 i = 0; i < m_workers.size(); i++) {
+            m_workers[i].walker = this;
+            m_workers[i].index = i;
+            mutexInit(std::addressof(m_workers[i].mutex));
+        }
+
+        m_pending = 1;
+        R_TRY(List(m_workers[0], 0));
+
+        if (m_pending) {
+            CreateWorkers();
+            WorkerLoop(m_workers[0]);
+            Close();
+        }
+
+        R_TRY(m_rc.load());
+        Flatten(out);
+        R_SUCCEED();
+    }
+
+private:
+    void CreateWorkers() {
+        m_running = true;
+
+        for (u32 i = 1; i < m_workers.size(); i++) {
+            auto& worker = m_workers[i];
+            if (R_FAILED(threadCreate(&worker.thread, ThreadFunc, std::addressof(worker), nullptr, 1024*32, PRIO_PREEMPTIVE, -2))) {
+                log_write("[WALK] failed to create worker: %u\n", i);
+                break;
+            }
+            worker.created = true;
+
+            if (R_FAILED(threadStart(&worker.thread))) {
+                log_write("[WALK] failed to start worker: %u\n", i);
+                break;
+            }
+            worker.started = true;
+        }
+    }
+
+    void Close() {
+        {
+            SCOPED_MUTEX(std::addressof(m_idle_mutex));
+            m_running = false;
+            condvarWakeAll(std::addressof(m_can_work));
+        }
+
+        for (auto& worker : m_workers) {
+            if (worker.started) {
+                threadWaitForExit(&worker.thread);
+            }
+            if (worker.created) {
+                threadClose(&worker.thread);
+            }
+            worker.started = worker.created = false;
+        }
+    }
+
+    static void ThreadFunc(void* p) {
+        auto worker = static_cast<Worker*>(p);
+        worker->walker->WorkerLoop(*worker);
+    }
+
+    void WorkerLoop(Worker& self) {
+        while (m_pending && R_SUCCEEDED(m_rc.load())) {
+            u32 node;
+            if (!Pop(self, node) && !Steal(self, node)) {
+                // nothing to do, wait for another worker to queue more folders.
+                SCOPED_MUTEX(std::addressof(m_idle_mutex));
+                while (m_running && m_pending && !m_queued && R_SUCCEEDED(m_rc.load())) {
+                    condvarWait(std::addressof(m_can_work), std::addressof(m_idle_mutex));
+                }
+
+                if (!m_running) {
+                    break;
+                }
+                continue;
+            }
+
+            if (const auto rc = List(self, node); R_FAILED(rc)) {
+                if (m_config.ignore_errors) {
+                    log_write("[WALK] skipping folder that failed to list: 0x%X\n", rc);
+                    continue;
+                }
+
+                Result expected = 0;
+                m_rc.compare_exchange_strong(expected, rc);
+                Wake();
+            }
+        }
+    }
+
+    auto Pop(Worker& self, u32& out) -> bool {
+        SCOPED_MUTEX(std::addressof(self.mutex));
+        if (self.queue.empty()) {
+            return false;
+        }
+
+        out = self.queue.back();
+        self.queue.pop_back();
+        m_queued--;
+        return true;
+    }
+
+    auto Steal(Worker& self, u32& out) -> bool {
+        for (u32 i = 1; i < m_workers.size(); i++) {
+            auto& other = m_workers[(self.index + i) % m_workers.size()];
+            SCOPED_MUTEX(std::addressof(other.mutex));
+            if (!other.queue.empty()) {
+                out = other.queue.front();
+                other.queue.pop_front();
+                m_queued--;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Wake() {
+        SCOPED_MUTEX(std::addressof(m_idle_mutex));
+        condvarWakeAll(std::addressof(m_can_work));
+    }
+
+    // lists the folder and queues its sub folders on the worker.
+    Result List(Worker& self, u32 index) {
+        // the walk is done once every folder has been listed.
+        ON_SCOPE_EXIT(if (!--m_pending) { Wake(); });
+
+        Node* node;
+        {
+            SCOPED_MUTEX(std::addressof(m_nodes_mutex));
+            node = std::addressof(m_nodes[index]);
+        }
+
+        auto& entry = node->entry;
+        const auto walk_dirs = entry.depth < m_config.max_depth;
+        auto mode = m_config.mode;
+        if (walk_dirs) {
+            mode |= FsDirOpenMode_ReadDirs;
+        }
+
+        // files and folders are read with the same open, then split.
+        std::vector<FsDirectoryEntry> entries;
+        {
+            Dir d;
+            R_TRY(m_fs->OpenDirectory(entry.path, mode, &d));
+            R_TRY(d.ReadAll(entries));
+        }
+
+        for (const auto& e : entries) {
+            if (e.type == FsDirEntryType_Dir) {
+                if (mode & FsDirOpenMode_ReadDirs) {
+                    entry.dirs.emplace_back(e);
+                }
+            } else if (mode & FsDirOpenMode_ReadFiles) {
+                entry.files.emplace_back(e);
+            }
+        }
+
+        if (!walk_dirs || entry.dirs.empty()) {
+            R_SUCCEED();
+        }
+
+        std::vector<u32> children;
+        {
+            SCOPED_MUTEX(std::addressof(m_nodes_mutex));
+            for (const auto& e : entry.dirs) {
+                if (m_config.filter && !m_config.filter(e)) {
+                    continue;
+                }
+
+                const auto child_index = u32(m_nodes.size());
+                auto& child = m_nodes.emplace_back();
+                child.entry.path = fs::AppendPath(entry.path, e.name);
+                child.entry.name = e.name;
+                child.entry.parent = index;
+                child.entry.depth = entry.depth + 1;
+                children.emplace_back(child_index);
+            }
+        }
+
+        if (children.empty()) {
+            R_SUCCEED();
+        }
+
+        node->children = children;
+        m_pending += children.size();
+
+        {
+            // pushed in reverse so that the owner pops them in listing order.
+            SCOPED_MUTEX(std::addressof(self.mutex));
+            self.queue.insert(self.queue.end(), children.rbegin(), children.rend());
+            m_queued += children.size();
+        }
+
+        Wake();
+        R_SUCCEED();
+    }
+
+    // pre-order walk of the tree, so the output doesn't depend on which thread
+    // listed what, or in which order.
+    void Flatten(std::vector<WalkEntry>& out) {
+        std::vector<s64> out_index(m_nodes.size(), -1);
+        std::vector<u32> stack{0};
+        out.reserve(out.size() + m_nodes.size());
+
+        while (!stack.empty()) {
+            const auto index = stack.back();
+            stack.pop_back();
+
+            auto& node = m_nodes[index];
+            auto& entry = out.emplace_back(std::move(node.entry));
+            out_index[index] = s64(out.size()) - 1;
+            if (entry.parent >= 0) {
+                entry.parent = out_index[entry.parent];
+            }
+
+            stack.insert(stack.end(), node.children.rbegin(), node.children.rend());
+        }
+    }
+
+private:
+    Fs* const m_fs;
+    const WalkConfig& m_config;
+
+    // deque so that nodes aren't moved whilst being listed.
+    Mutex m_nodes_mutex{};
+    std::deque<Node> m_nodes{};
+
+    std::vector<Worker> m_workers{};
+
+    // folders that are queued or being listed, the walk is done once it's 0.
+    std::atomic<u32> m_pending{};
+    // folders that are queued.
+    std::atomic<u32> m_queued{};
+    std::atomic<Result> m_rc{};
+
+    Mutex m_idle_mutex{};
+    CondVar m_can_work{};
+    bool m_running{};
+};
+
+} // namespace
+
+Result WalkDirs(Fs* fs, const FsPath& path, std::vector<WalkEntry>& out, const WalkConfig& config) {
+    return std::make_unique<Walker>(fs, config)->Run(path, out);
+}
+
+} // namespace npshop::fs
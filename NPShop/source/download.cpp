@@ -13,6 +13,9 @@
 #include <mutex>
 #include <algorithm>
 #include <ranges>
+#include <optional>
+#include <functional>
+#include <memory>
 #include <curl/curl.h>
 #include <yyjson.h>
 
@@ -35,6 +38,18 @@ constexpr auto MAX_THREADS = 4;
 constexpr int THREAD_PRIO = PRIO_PREEMPTIVE;
 constexpr int THREAD_CORE = 1;
 
+// max number of transfers in flight on the multi handle.
+constexpr u32 MULTI_MAX_TRANSFERS = 32;
+// http/2 transfers are multiplexed over these, so only a few are needed.
+constexpr long MULTI_MAX_HOST_CONNECTIONS = 4;
+
+// segmented downloads.
+constexpr u32 SEGMENT_MAX = 16;
+// size of the buffer for each segment, the journal is updated after each flush.
+constexpr u64 SEGMENT_BUFFER_SIZE = 1024*1024*2;
+constexpr u32 SEGMENT_JOURNAL_MAGIC = 0x4A474553; // SEGJ
+constexpr u32 SEGMENT_JOURNAL_VERSION = 1;
+
 std::atomic_bool g_running{};
 CURLSH* g_curl_share{};
 // this is used for single threaded blocking installs.
@@ -61,202 +76,405 @@ struct SeekCustomData {
     s64 size{};
 };
 
+// stored in "<path>.journal" alongside the "<path>.part" file.
+// the journal is only updated after the data has been written, so it
+// never claims more data than what is actually on disk.
+struct SegmentJournalHeader {
+    u32 magic;
+    u32 version;
+    u32 url_hash;
+    u32 segment_count;
+    s64 size;
+    // etag or last-modified, used to detect if the file changed on the server.
+    char validator[0x100];
+};
+
+struct SegmentJournalEntry {
+    s64 offset;
+    s64 size;
+    s64 done;
+};
+
+struct SegmentedDownload {
+    SegmentedDownload(const Api& _api) : api{_api} {}
+
+    const Api& api;
+    std::string url{};
+    curl_slist* header_list{};
+    fs::File f{};
+    fs::File journal_f{};
+    SegmentJournalHeader header{};
+    std::vector<SegmentJournalEntry> segments{};
+
+    // protects the journal, next_segment and active_workers.
+    Mutex mutex{};
+    CondVar cond{};
+    u32 next_segment{};
+    u32 active_workers{};
+
+    // serialises calls to the progress callback, which isn't thread safe.
+    Mutex progress_mutex{};
+    std::atomic<s64> downloaded{};
+    std::atomic_bool failed{};
+};
+
+struct SegmentData {
+    SegmentedDownload* dl{};
+    CURL* curl{};
+    u32 index{};
+    std::vector<u8> data{};
+    s64 offset{};
+    // set once the response has been checked to be a 206.
+    bool checked{};
+};
+
 // helper for creating webdav folders as libcurl does not have built-in
 // support for it.
 // only creates the folders if they don't exist.
 auto WebdavCreateFolder(CURL* curl, const Api& e) -> bool;
 
-auto generate_key_from_path(const fs::FsPath& path) -> std::string {
-    const auto key = crc32Calculate(path.s, path.size());
-    return std::to_string(key);
+// 64-bit fnv-1a of the path, used as the key for the etag cache.
+auto generate_key_from_path(const fs::FsPath& path) -> u64 {
+    u64 hash = 0xCBF29CE484222325;
+    for (size_t i = 0; i < path.size(); i++) {
+        hash = (hash ^ u8(path.s[i])) * 0x100000001B3;
+    }
+    return hash;
 }
 
 void Yield() {
     svcSleepThread(YieldType_WithoutCoreMigration);
 }
 
+// etag / last-modified cache for Flag_Cache downloads.
+// stored as a log of fixed size records, a record is appended for each update
+// and the last record for a key wins. the log is compacted on exit once
+// most of it is stale.
+// the size and timestamp of the downloaded file is stored with the tag, so the
+// caller only has to stat the file once to both check that it exists and
+// that it hasn't been changed since it was downloaded.
 struct Cache {
-    using Value = std::pair<std::string, std::string>;
+    struct Value {
+        std::string etag;
+        std::string last_modified;
 
-    bool init() {
+        auto operator==(const Value&) const -> bool = default;
+    };
+
+    void init() {
+        // the log is only read on the first lookup.
+    }
+
+    void exit() {
         mutexLock(&m_mutex);
         ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
 
-        if (m_json) {
-            return true;
-        }
+        close_log();
 
-        auto json_in = yyjson_read_file(JSON_PATH, YYJSON_READ_NOFLAG, nullptr, nullptr);
-        if (json_in) {
-            log_write("loading old json doc\n");
-            m_json = yyjson_doc_mut_copy(json_in, nullptr);
-            yyjson_doc_free(json_in);
-            m_root = yyjson_mut_doc_get_root(m_json);
-        } else {
-            log_write("creating new json doc\n");
-            m_json = yyjson_mut_doc_new(nullptr);
-            m_root = yyjson_mut_obj(m_json);
-            yyjson_mut_doc_set_root(m_json, m_root);
+        if (m_loaded && m_stale_count > COMPACT_MIN && m_stale_count > m_cache.size()) {
+            compact();
         }
 
-        return m_json && m_root;
+        m_cache.clear();
+        m_loaded = false;
     }
 
-    void exit() {
+    // size and timestamp are of the file at path, the caller should skip
+    // the lookup if the file doesn't exist.
+    void get(const fs::FsPath& path, s64 size, u64 timestamp, curl::Header& header) {
         mutexLock(&m_mutex);
         ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
 
-        if (!m_json) {
+        const auto value = get_internal(path, size, timestamp);
+        if (!value) {
             return;
         }
 
-        if (!yyjson_mut_write_file(JSON_PATH, m_json, YYJSON_WRITE_NOFLAG, nullptr, nullptr)) {
-            log_write("failed to write etag json: %s\n", JSON_PATH.s);
+        if (!value->etag.empty()) {
+            header.m_map.emplace("if-none-match", value->etag);
         }
 
-        yyjson_mut_doc_free(m_json);
-        m_json = nullptr;
-        m_root = nullptr;
-    }
-
-    void get(const fs::FsPath& path, curl::Header& header) {
-        const auto [etag, last_modified] = get_internal(path);
-        if (!etag.empty()) {
-            header.m_map.emplace("if-none-match", etag);
-        }
-
-        if (!last_modified.empty()) {
-            header.m_map.emplace("if-modified-since", last_modified);
+        if (!value->last_modified.empty()) {
+            header.m_map.emplace("if-modified-since", value->last_modified);
         }
     }
 
+    // should be called once the file has been written to path.
     void set(const fs::FsPath& path, const curl::Header& value) {
         mutexLock(&m_mutex);
         ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
 
-        std::string etag_str;
-        std::string last_modified_str;
-
+        Value new_value;
         if (auto it = value.Find(ETAG_STR); it != value.m_map.end()) {
-            etag_str = it->second;
+            new_value.etag = it->second;
         }
         if (auto it = value.Find(LAST_MODIFIED_STR); it != value.m_map.end()) {
-            last_modified_str = it->second;
+            new_value.last_modified = it->second;
+        }
+
+        if (new_value.etag.empty() && new_value.last_modified.empty()) {
+            return;
         }
 
-        if (!etag_str.empty() || !last_modified_str.empty()) {
-            set_internal(path, Value{etag_str, last_modified_str});
+        // tags that don't fit in a record aren't cached, a truncated tag would never match.
+        if (new_value.etag.length() >= sizeof(Record::etag) || new_value.last_modified.length() >= sizeof(Record::last_modified)) {
+            log_write("etag too long to cache, path: %s\n", path.s);
+            return;
+        }
+
+        FsTimeStampRaw ts{};
+        s64 size{};
+        if (R_FAILED(fs::FsNativeSd().FileGetSizeAndTimestamp(path, &ts, &size))) {
+            return;
         }
+
+        set_internal(path, Entry{new_value, size, ts.is_valid ? ts.modified : 0});
     }
 
 private:
-    auto get_internal(const fs::FsPath& path) -> Value {
-        if (!fs::FsNativeSd().FileExists(path)) {
-            return {};
+    struct Header {
+        u32 magic;
+        u32 version;
+    };
+
+    struct Record {
+        u64 key;
+        s64 size;
+        u64 timestamp;
+        char etag[0x100];
+        char last_modified[0x40];
+    };
+
+    struct Entry {
+        Value value;
+        s64 size;
+        u64 timestamp;
+    };
+
+    void load() {
+        if (m_loaded) {
+            return;
         }
 
-        const auto kkey = generate_key_from_path(path);
-        const auto it = m_cache.find(kkey);
-        if (it != m_cache.end()) {
-            return it->second;
+        m_loaded = true;
+        m_log_valid = false;
+        m_cache.clear();
+        m_stale_count = 0;
+
+        std::vector<u8> data;
+        if (R_FAILED(fs::FsNativeSd().read_entire_file(CACHE_PATH, data))) {
+            log_write("no etag cache, creating new one\n");
+            return;
         }
 
-        auto hash_key = yyjson_mut_obj_getn(m_root, kkey.c_str(), kkey.length());
-        if (!hash_key) {
-            return {};
+        Header header{};
+        if (data.size() < sizeof(header)) {
+            return;
         }
 
-        auto etag_key = yyjson_mut_obj_get(hash_key, ETAG_STR);
-        auto last_modified_key = yyjson_mut_obj_get(hash_key, LAST_MODIFIED_STR);
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) {
+            log_write("etag cache has bad magic or version, ignoring\n");
+            return;
+        }
 
-        const auto etag_value = yyjson_mut_get_str(etag_key);
-        const auto etag_value_len = yyjson_mut_get_len(etag_key);
-        const auto last_modified_value = yyjson_mut_get_str(last_modified_key);
-        const auto last_modified_value_len = yyjson_mut_get_len(last_modified_key);
+        m_log_valid = true;
 
-        if ((!etag_value || !etag_value_len) && (!last_modified_value || !last_modified_value_len)) {
-            return {};
+        // a partial record at the end is from a write that didn't complete, ignore it.
+        const auto count = (data.size() - sizeof(header)) / sizeof(Record);
+        m_cache.reserve(count);
+
+        for (size_t i = 0; i < count; i++) {
+            Record record;
+            std::memcpy(&record, data.data() + sizeof(header) + i * sizeof(Record), sizeof(record));
+            record.etag[sizeof(record.etag) - 1] = '\0';
+            record.last_modified[sizeof(record.last_modified) - 1] = '\0';
+
+            const auto [it, inserted] = m_cache.insert_or_assign(record.key, Entry{{record.etag, record.last_modified}, record.size, record.timestamp});
+            if (!inserted) {
+                m_stale_count++;
+            }
         }
 
-        std::string etag;
-        std::string last_modified;
-        if (etag_value && etag_value_len) {
-            etag.assign(etag_value, etag_value_len);
+        log_write("loaded etag cache, entries: %zu stale: %zu\n", m_cache.size(), m_stale_count);
+    }
+
+    auto get_internal(const fs::FsPath& path, s64 size, u64 timestamp) -> const Value* {
+        load();
+
+        const auto it = m_cache.find(generate_key_from_path(path));
+        if (it == m_cache.end()) {
+            return nullptr;
         }
-        if (last_modified_value && last_modified_value_len) {
-            last_modified.assign(last_modified_value, last_modified_value_len);
+
+        // the file was changed or replaced since it was downloaded, so the tag no longer applies.
+        const auto& entry = it->second;
+        if (entry.size != size || (entry.timestamp && timestamp && entry.timestamp != timestamp)) {
+            log_write("etag cache entry out of date, path: %s\n", path.s);
+            return nullptr;
         }
 
-        const Value ret{etag, last_modified};
-        m_cache.insert_or_assign(it, kkey, ret);
-        return ret;
+        return &entry.value;
     }
 
-    void set_internal(const fs::FsPath& path, const Value& value) {
-        const auto kkey = generate_key_from_path(path);
+    void set_internal(const fs::FsPath& path, const Entry& entry) {
+        load();
+
+        const auto key = generate_key_from_path(path);
 
         // check if we already have this entry
-        const auto it = m_cache.find(kkey);
-        if (it != m_cache.end() && it->second == value) {
-            log_write("already has etag, not updating, path: %s key: %s\n", path.s, kkey.c_str());
+        const auto it = m_cache.find(key);
+        if (it != m_cache.end() && it->second.value == entry.value && it->second.size == entry.size && it->second.timestamp == entry.timestamp) {
+            log_write("already has etag, not updating, path: %s key: %016lX\n", path.s, key);
             return;
         }
 
         if (it != m_cache.end()) {
-            log_write("updating etag, path: %s key: %s\n", path.s, kkey.c_str());
+            log_write("updating etag, path: %s key: %016lX\n", path.s, key);
+            m_stale_count++;
         } else {
-            log_write("setting new etag, path: %s key: %s\n", path.s, kkey.c_str());
+            log_write("setting new etag, path: %s key: %016lX\n", path.s, key);
         }
 
-        // insert new entry into cache, this will never fail.
-        const auto& [jkey, jvalue] = *m_cache.insert_or_assign(it, kkey, value);
-        const auto& [etag, last_modified] = jvalue;
+        m_cache.insert_or_assign(it, key, entry);
+
+        Record record{};
+        record.key = key;
+        record.size = entry.size;
+        record.timestamp = entry.timestamp;
+        std::strcpy(record.etag, entry.value.etag.c_str());
+        std::strcpy(record.last_modified, entry.value.last_modified.c_str());
 
-        // check if we need to add a new entry to root or simply update the value.
-        auto hash_key = yyjson_mut_obj_getn(m_root, kkey.c_str(), kkey.length());
-        if (!hash_key) {
-            hash_key = yyjson_mut_obj_add_obj(m_json, m_root, jkey.c_str());
+        if (!append(record)) {
+            log_write("failed to append etag record, path: %s\n", path.s);
         }
+    }
 
-        if (!hash_key) {
-            log_write("failed to set new cache key obj, path: %s key: %s\n", path.s, jkey.c_str());
-        } else {
-            const auto update_entry = [this, &hash_key](const char* tag, const std::string& value) {
-                if (value.empty()) {
-                    // workaround for appstore accepting etags but not returning them.
-                    yyjson_mut_obj_remove_str(hash_key, tag);
-                    return true;
-                } else {
-                    auto key = yyjson_mut_obj_get(hash_key, tag);
-                    if (!key) {
-                        return yyjson_mut_obj_add_str(m_json, hash_key, tag, value.c_str());
-                    } else {
-                        return yyjson_mut_set_str(key, value.c_str());
-                    }
-                }
-            };
+    auto open_log() -> bool {
+        if (m_file_fs) {
+            return true;
+        }
 
-            if (!update_entry("etag", etag)) {
-                log_write("failed to set new etag, path: %s key: %s\n", path.s, jkey.c_str());
-            }
+        // the file keeps a pointer to the fs, so it has to outlive this function.
+        auto fs = std::make_unique<fs::FsNativeSd>();
+        fs->CreateDirectoryRecursivelyWithPath(CACHE_PATH);
+
+        if (auto rc = fs->CreateFile(CACHE_PATH, 0, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
+            return false;
+        }
+
+        if (R_FAILED(fs->OpenFile(CACHE_PATH, FsOpenMode_Read|FsOpenMode_Write|FsOpenMode_Append, &m_file))) {
+            return false;
+        }
+
+        m_file_fs = std::move(fs);
+        if (R_FAILED(m_file.GetSize(&m_file_size))) {
+            close_log();
+            return false;
+        }
 
-            if (!update_entry("last-modified", last_modified)) {
-                log_write("failed to set new last-modified, path: %s key: %s\n", path.s, jkey.c_str());
+        // new or invalid log, start again with a fresh header.
+        // load() will have ignored the contents of an invalid log.
+        if (!m_log_valid || m_file_size < s64(sizeof(Header))) {
+            const Header header{CACHE_MAGIC, CACHE_VERSION};
+            if (R_FAILED(m_file.SetSize(0)) || R_FAILED(m_file.Write(0, &header, sizeof(header), FsWriteOption_None))) {
+                close_log();
+                return false;
             }
+            m_file_size = sizeof(header);
+            m_log_valid = true;
+        }
+
+        // drop any partial record so that the appended records stay aligned.
+        const auto aligned_size = sizeof(Header) + (m_file_size - sizeof(Header)) / sizeof(Record) * sizeof(Record);
+        if (s64(aligned_size) != m_file_size) {
+            m_file.SetSize(aligned_size);
+            m_file_size = aligned_size;
+        }
+
+        return true;
+    }
+
+    void close_log() {
+        m_file.Close();
+        m_file = {};
+        m_file_fs.reset();
+    }
+
+    auto append(const Record& record) -> bool {
+        if (!open_log()) {
+            return false;
+        }
+
+        if (R_FAILED(m_file.Write(m_file_size, &record, sizeof(record), FsWriteOption_Flush))) {
+            return false;
+        }
+
+        m_file_size += sizeof(record);
+        return true;
+    }
+
+    // rewrites the log with only the latest record for each key.
+    void compact() {
+        log_write("compacting etag cache, entries: %zu stale: %zu\n", m_cache.size(), m_stale_count);
+
+        std::vector<u8> data(sizeof(Header) + m_cache.size() * sizeof(Record));
+        const Header header{CACHE_MAGIC, CACHE_VERSION};
+        std::memcpy(data.data(), &header, sizeof(header));
+
+        auto out = data.data() + sizeof(header);
+        for (const auto& [key, entry] : m_cache) {
+            Record record{};
+            record.key = key;
+            record.size = entry.size;
+            record.timestamp = entry.timestamp;
+            std::strcpy(record.etag, entry.value.etag.c_str());
+            std::strcpy(record.last_modified, entry.value.last_modified.c_str());
+            std::memcpy(out, &record, sizeof(record));
+            out += sizeof(record);
+        }
+
+        // written to a temp file first so that the old log is kept if writing fails.
+        fs::FsNativeSd fs;
+        const auto temp_path = CACHE_PATH + ".temp";
+        fs.DeleteFile(temp_path);
+        if (R_FAILED(fs.write_entire_file(temp_path, data))) {
+            log_write("failed to write compacted etag cache\n");
+            fs.DeleteFile(temp_path);
+            return;
         }
+
+        fs.DeleteFile(CACHE_PATH);
+        if (R_FAILED(fs.RenameFile(temp_path, CACHE_PATH))) {
+            log_write("failed to rename compacted etag cache\n");
+        }
+
+        m_stale_count = 0;
     }
 
-    static constexpr inline fs::FsPath JSON_PATH{"/switch/npshop/cache/cache.json"};
+    static constexpr inline fs::FsPath CACHE_PATH{"/switch/npshop/cache/cache.bin"};
     static constexpr inline const char* ETAG_STR{"etag"};
     static constexpr inline const char* LAST_MODIFIED_STR{"last-modified"};
+    static constexpr inline u32 CACHE_MAGIC = 0x48435445; // ETCH
+    static constexpr inline u32 CACHE_VERSION = 1;
+    // don't bother compacting small logs.
+    static constexpr inline size_t COMPACT_MIN = 64;
 
     Mutex m_mutex{};
-    yyjson_mut_doc* m_json{};
-    yyjson_mut_val* m_root{};
-    std::unordered_map<std::string, Value> m_cache{};
+    std::unique_ptr<fs::FsNativeSd> m_file_fs{};
+    fs::File m_file{};
+    s64 m_file_size{};
+    bool m_loaded{};
+    // set if the log on disk has a valid header, records can be appended to it.
+    bool m_log_valid{};
+    // number of records in the log that have been replaced by a newer one.
+    size_t m_stale_count{};
+    std::unordered_map<u64, Entry> m_cache{};
 };
 
 struct ThreadEntry {
+    using Job = std::function<void(CURL* curl)>;
+
     auto Create() -> Result {
         m_curl = curl_easy_init();
         R_UNLESS(m_curl != nullptr, Result_CurlFailedEasyInit);
@@ -283,7 +501,6 @@ struct ThreadEntry {
     }
 
     auto Setup(const Api& api) -> bool {
-        assert(m_in_progress == false && "Setting up thread while active");
         mutexLock(&m_mutex);
         ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
 
@@ -297,12 +514,30 @@ struct ThreadEntry {
         return true;
     }
 
+    // runs the job on this thread using its curl handle, rather than an api request.
+    // this is used to borrow idle threads for segmented downloads.
+    auto SetupJob(Job&& job) -> bool {
+        mutexLock(&m_mutex);
+        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+        if (m_in_progress || m_exited) {
+            return false;
+        }
+        m_job = job;
+        m_in_progress = true;
+        ueventSignal(&m_uevent);
+        return true;
+    }
+
     static void ThreadFunc(void* p);
 
     CURL* m_curl{};
     Thread m_thread{};
     Api m_api{};
+    Job m_job{};
     std::atomic_bool m_in_progress{};
+    // set once the thread has exited, jobs can no longer be run.
+    bool m_exited{};
     Mutex m_mutex{};
     UEvent m_uevent{};
 };
@@ -372,7 +607,8 @@ void GetDownloadTempPath(fs::FsPath& buf) {
 }
 
 auto ProgressCallbackFunc1(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) -> size_t {
-    if (!g_running) {
+    auto api = static_cast<Api*>(clientp);
+    if (!g_running || api->GetToken().stop_requested()) {
         return 1;
     }
 
@@ -559,6 +795,30 @@ auto header_callback(char* b, size_t size, size_t nitems, void* userdata) -> siz
     return numbytes;
 }
 
+auto CreateHeaderList(const Header& header) -> curl_slist* {
+    curl_slist* list{};
+
+    for (const auto& [key, value] : header.m_map) {
+        if (value.empty()) {
+            continue;
+        }
+
+        // create header key value pair.
+        const auto header_str = key + ": " + value;
+
+        // try to append header chunk.
+        auto temp = curl_slist_append(list, header_str.c_str());
+        if (temp) {
+            log_write("adding header: %s\n", header_str.c_str());
+            list = temp;
+        } else {
+            log_write("failed to append header\n");
+        }
+    }
+
+    return list;
+}
+
 auto EscapeString(CURL* curl, const std::string& str) -> std::string {
     char* s{};
     if (!curl) {
@@ -665,159 +925,596 @@ void SetCommonCurlOptions(CURL* curl, const Api& e) {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_PORT, (long)e.GetPort());
     }
 
-    // progress calls.
+    // progress calls, these also abort the transfer once the token is stopped.
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFODATA, &e);
     if (e.GetOnProgress()) {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFODATA, &e);
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackFunc2);
     } else {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackFunc1);
     }
 
 }
-auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
-    App::SetAutoSleepDisabled(true);
-    ON_SCOPE_EXIT(App::SetAutoSleepDisabled(false));
 
-    // check if stop has been requested before starting download
-    if (e.GetToken().stop_requested()) {
-        return {};
+auto ProgressCallbackSegment(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) -> size_t {
+    auto dl = static_cast<SegmentedDownload*>(clientp);
+    if (!g_running || dl->failed || dl->api.GetToken().stop_requested()) {
+        return 1;
     }
 
-    fs::FsPath tmp_buf;
-    const bool has_file = !e.GetPath().empty() && e.GetPath() != "";
-    const bool has_post = !e.GetFields().empty() && e.GetFields() != "";
-    const auto encoded_url = EncodeUrl(e.GetUrl());
-
-    DataStruct chunk;
-    Header header_in = e.GetHeader();
-    Header header_out;
-    fs::FsNativeSd fs;
-
-    if (has_file) {
-        GetDownloadTempPath(tmp_buf);
-        fs.CreateDirectoryRecursivelyWithPath(tmp_buf);
-
-        if (auto rc = fs.CreateFile(tmp_buf, 0, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
-            log_write("failed to create file: %s\n", tmp_buf.s);
-            return {};
-        }
-
-        if (R_FAILED(fs.OpenFile(tmp_buf, FsOpenMode_Write|FsOpenMode_Append, &chunk.f))) {
-            log_write("failed to open file: %s\n", tmp_buf.s);
-            return {};
-        }
-
-        // only add etag if the dst file still exists.
-        if ((e.GetFlags() & Flag_Cache) && fs::FileExists(&fs.m_fs, e.GetPath())) {
-            g_cache.get(e.GetPath(), header_in);
+    // report the combined progress of all segments.
+    if (dl->api.GetOnProgress()) {
+        SCOPED_MUTEX(&dl->progress_mutex);
+        if (!dl->api.GetOnProgress()(dl->header.size, dl->downloaded, 0, 0)) {
+            dl->failed = true;
+            return 1;
         }
     }
 
-    // reserve the first chunk
-    chunk.data.reserve(CHUNK_SIZE);
+    Yield();
+    return 0;
+}
 
-    curl_easy_reset(curl);
-    SetCommonCurlOptions(curl, e);
+// must be called with the mutex locked.
+auto WriteSegmentJournal(SegmentedDownload* dl) -> Result {
+    R_TRY(dl->journal_f.Write(0, &dl->header, sizeof(dl->header), FsWriteOption_None));
+    R_TRY(dl->journal_f.Write(sizeof(dl->header), dl->segments.data(), dl->segments.size() * sizeof(SegmentJournalEntry), FsWriteOption_None));
+    R_SUCCEED();
+}
 
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, encoded_url.c_str());
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &header_out);
+auto WriteSegmentData(SegmentData* seg, const void* buf, s64 size) -> bool {
+    auto dl = seg->dl;
+    auto& entry = dl->segments[seg->index];
 
-    if (has_post) {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_POSTFIELDS, e.GetFields().c_str());
-        log_write("setting post field: %s\n", e.GetFields().c_str());
+    // each segment only writes to its own range, so the handle can be shared.
+    // the data is flushed so that it's on disk before the journal counts it.
+    if (R_FAILED(dl->f.Write(entry.offset + entry.done, buf, size, FsWriteOption_Flush))) {
+        log_write("[CURL] failed to write segment: %u\n", seg->index);
+        return false;
     }
 
-    struct curl_slist* list = NULL;
-    ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
+    SCOPED_MUTEX(&dl->mutex);
+    entry.done += size;
 
-    for (const auto& [key, value] : header_in.m_map) {
-        if (value.empty()) {
-            continue;
-        }
+    // failing to update the journal only affects resuming, so carry on.
+    if (R_FAILED(WriteSegmentJournal(dl))) {
+        log_write("[CURL] failed to update segment journal\n");
+    }
 
-        // create header key value pair.
-        const auto header_str = key + ": " + value;
+    return true;
+}
 
-        // try to append header chunk.
-        auto temp = curl_slist_append(list, header_str.c_str());
-        if (temp) {
-            log_write("adding header: %s\n", header_str.c_str());
-            list = temp;
-        } else {
-            log_write("failed to append header\n");
-        }
+auto FlushSegment(SegmentData* seg) -> bool {
+    if (!seg->offset) {
+        return true;
     }
 
-    if (list) {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
+    if (!WriteSegmentData(seg, seg->data.data(), seg->offset)) {
+        return false;
     }
 
-    // write calls.
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, has_file ? WriteFileCallback : WriteMemoryCallback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &chunk);
+    seg->offset = 0;
+    return true;
+}
 
-    // perform download and cleanup after and report the result.
-    const auto res = curl_easy_perform(curl);
-    bool success = res == CURLE_OK;
+auto WriteSegmentCallback(void *contents, size_t size, size_t num_files, void *userp) -> size_t {
+    if (!g_running) {
+        return 0;
+    }
 
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    auto seg = static_cast<SegmentData*>(userp);
+    const auto& entry = seg->dl->segments[seg->index];
+    const auto realsize = size * num_files;
 
-    if (has_file) {
-        ON_SCOPE_EXIT( fs.DeleteFile(tmp_buf) );
-        if (res == CURLE_OK && chunk.offset) {
-            chunk.f.Write(chunk.file_offset, chunk.data.data(), chunk.offset, FsWriteOption_None);
+    // a 200 means that the server ignored the range, writing that data
+    // to the segment offset would corrupt the file.
+    if (!seg->checked) {
+        long http_code = 0;
+        curl_easy_getinfo(seg->curl, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code != 206) {
+            log_write("[CURL] segment: %u bad response code: %ld\n", seg->index, http_code);
+            return 0;
         }
+        seg->checked = true;
+    }
 
-        chunk.f.Close();
-
-        if (res == CURLE_OK) {
-            if (http_code == 304) {
-                log_write("cached download: %s\n", e.GetUrl().c_str());
-            } else {
-                log_write("un-cached download: %s code: %lu\n", e.GetUrl().c_str(), http_code);
-                if (e.GetFlags() & Flag_Cache) {
-                    g_cache.set(e.GetPath(), header_out);
-                }
+    if (entry.done + seg->offset + (s64)realsize > entry.size) {
+        log_write("[CURL] segment: %u server sent more data than requested\n", seg->index);
+        return 0;
+    }
 
-                // enable to log received headers.
-                #if 0
-                log_write("\n\nLOGGING HEADER\n");
-                    for (auto [a, b] : header_out.m_map) {
-                        log_write("\t%s: %s\n", a.c_str(), b.c_str());
-                    }
-                log_write("\n\n");
-                #endif
+    // flush data if incomming data would overflow the buffer
+    if (seg->offset + realsize > seg->data.size()) {
+        if (!FlushSegment(seg)) {
+            return 0;
+        }
+    }
 
-                fs.DeleteFile(e.GetPath());
-                fs.CreateDirectoryRecursivelyWithPath(e.GetPath());
-                if (R_FAILED(fs.RenameFile(tmp_buf, e.GetPath()))) {
-                    success = false;
-                }
-            }
+    // we have a huge chunk! write it directly to file
+    if (realsize > seg->data.size()) {
+        if (!WriteSegmentData(seg, contents, realsize)) {
+            return 0;
         }
-        chunk.data.clear();
     } else {
-        // empty data if we failed
-        if (res != CURLE_OK) {
-            chunk.data.clear();
-        }
+        std::memcpy(seg->data.data() + seg->offset, contents, realsize);
+        seg->offset += realsize;
     }
 
-    log_write("Downloaded %s code: %ld %s\n", e.GetUrl().c_str(), http_code, curl_easy_strerror(res));
-    return {success, http_code, header_out, chunk.data, e.GetPath()};
+    seg->dl->downloaded += realsize;
+    Yield();
+    return realsize;
 }
 
-auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
-    // check if stop has been requested before starting download
-    if (e.GetToken().stop_requested()) {
-        return {};
+auto DownloadSegment(CURL* curl, SegmentData* seg) -> bool {
+    auto dl = seg->dl;
+    const auto& entry = dl->segments[seg->index];
+    if (entry.done >= entry.size) {
+        return true;
     }
 
-    if (e.GetUrl().starts_with("webdav://")) {
-        if (!WebdavCreateFolder(curl, e)) {
-            log_write("[CURL] failed to create webdav folder, aborting\n");
+    char range[64];
+    std::snprintf(range, sizeof(range), "%ld-%ld", entry.offset + entry.done, entry.offset + entry.size - 1);
+
+    seg->curl = curl;
+    seg->offset = 0;
+    seg->checked = false;
+
+    curl_easy_reset(curl);
+    SetCommonCurlOptions(curl, dl->api);
+
+    // ranges apply to the encoded data, so compression must be disabled.
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_ACCEPT_ENCODING, nullptr);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, dl->url.c_str());
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_RANGE, range);
+
+    if (dl->header_list) {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, dl->header_list);
+    }
+
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFODATA, dl);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackSegment);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, WriteSegmentCallback);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, seg);
+
+    const auto res = curl_easy_perform(curl);
+
+    // keep whatever was received, even on failure, so that it can be resumed.
+    if (seg->checked && !FlushSegment(seg)) {
+        return false;
+    }
+
+    if (res != CURLE_OK || entry.done != entry.size) {
+        long http_code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        log_write("[CURL] failed segment: %u range: %s code: %ld %s\n", seg->index, range, http_code, curl_easy_strerror(res));
+        return false;
+    }
+
+    return true;
+}
+
+// each connection pulls the next pending segment until none are left.
+void RunSegments(CURL* curl, SegmentedDownload* dl) {
+    SegmentData seg{dl};
+    seg.data.resize(SEGMENT_BUFFER_SIZE);
+
+    while (!dl->failed) {
+        {
+            SCOPED_MUTEX(&dl->mutex);
+            if (dl->next_segment >= dl->segments.size()) {
+                break;
+            }
+            seg.index = dl->next_segment++;
+        }
+
+        if (!DownloadSegment(curl, &seg)) {
+            dl->failed = true;
+        }
+    }
+}
+
+auto LoadSegmentJournal(fs::FsNativeSd& fs, const fs::FsPath& part_path, const fs::FsPath& journal_path, SegmentedDownload& dl) -> bool {
+    fs::File f;
+    R_TRY_RESULT(fs.OpenFile(journal_path, FsOpenMode_Read, &f), false);
+
+    SegmentJournalHeader header;
+    u64 bytes_read;
+    R_TRY_RESULT(f.Read(0, &header, sizeof(header), FsReadOption_None, &bytes_read), false);
+    R_UNLESS(bytes_read == sizeof(header), false);
+    R_UNLESS(header.magic == SEGMENT_JOURNAL_MAGIC && header.version == SEGMENT_JOURNAL_VERSION, false);
+    R_UNLESS(header.segment_count && header.segment_count <= SEGMENT_MAX, false);
+
+    // check that the file on the server is the same as the one being resumed.
+    R_UNLESS(header.url_hash == dl.header.url_hash && header.size == dl.header.size, false);
+    R_UNLESS(!std::strncmp(header.validator, dl.header.validator, sizeof(header.validator)), false);
+
+    std::vector<SegmentJournalEntry> segments(header.segment_count);
+    const auto segments_size = segments.size() * sizeof(SegmentJournalEntry);
+    R_TRY_RESULT(f.Read(sizeof(header), segments.data(), segments_size, FsReadOption_None, &bytes_read), false);
+    R_UNLESS(bytes_read == segments_size, false);
+
+    for (const auto& e : segments) {
+        R_UNLESS(e.offset >= 0 && e.size > 0 && e.offset + e.size <= header.size, false);
+        R_UNLESS(e.done >= 0 && e.done <= e.size, false);
+    }
+
+    fs::File part_f;
+    R_TRY_RESULT(fs.OpenFile(part_path, FsOpenMode_Read, &part_f), false);
+
+    s64 part_size;
+    R_TRY_RESULT(part_f.GetSize(&part_size), false);
+    R_UNLESS(part_size == header.size, false);
+
+    dl.header = header;
+    dl.segments = segments;
+    return true;
+}
+
+// downloads the file using multiple range requests in parallel.
+// the caller's thread downloads a segment and idle download threads are borrowed for the rest.
+// returns std::nullopt if the server doesn't support range requests, in which case
+// the normal download path should be used.
+auto DownloadSegmented(CURL* curl, const Api& e, const std::string& encoded_url) -> std::optional<ApiResult> {
+    auto list = CreateHeaderList(e.GetHeader());
+    ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
+
+    // request the first byte to check that ranges are supported and to get the size.
+    DataStruct probe;
+    Header header_out;
+
+    curl_easy_reset(curl);
+    SetCommonCurlOptions(curl, e);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_ACCEPT_ENCODING, nullptr);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, encoded_url.c_str());
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_RANGE, "0-0");
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &header_out);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &probe);
+
+    if (list) {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
+    }
+
+    const auto res = curl_easy_perform(curl);
+
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+    if (!g_running || e.GetToken().stop_requested()) {
+        return ApiResult{};
+    }
+
+    if (res != CURLE_OK || http_code != 206) {
+        log_write("[CURL] range not supported, code: %ld %s\n", http_code, curl_easy_strerror(res));
+        return std::nullopt;
+    }
+
+    // parse "bytes 0-0/1234" for the total size.
+    s64 size{};
+    if (auto it = header_out.Find("content-range"); it != header_out.m_map.end()) {
+        if (const auto slash = it->second.find_last_of('/'); slash != it->second.npos) {
+            size = std::strtoll(it->second.c_str() + slash + 1, nullptr, 10);
+        }
+    }
+
+    if (size <= 0) {
+        log_write("[CURL] unknown content length, not segmenting\n");
+        return std::nullopt;
+    }
+
+    SegmentedDownload dl{e};
+    dl.url = encoded_url;
+    dl.header_list = list;
+    dl.header.magic = SEGMENT_JOURNAL_MAGIC;
+    dl.header.version = SEGMENT_JOURNAL_VERSION;
+    dl.header.url_hash = crc32Calculate(encoded_url.data(), encoded_url.size());
+    dl.header.size = size;
+
+    if (auto it = header_out.Find("etag"); it != header_out.m_map.end()) {
+        std::strncpy(dl.header.validator, it->second.c_str(), sizeof(dl.header.validator) - 1);
+    } else if (auto it = header_out.Find("last-modified"); it != header_out.m_map.end()) {
+        std::strncpy(dl.header.validator, it->second.c_str(), sizeof(dl.header.validator) - 1);
+    }
+
+    fs::FsNativeSd fs;
+    const auto part_path = e.GetPath() + ".part";
+    const auto journal_path = e.GetPath() + ".journal";
+    fs.CreateDirectoryRecursivelyWithPath(part_path);
+
+    if (LoadSegmentJournal(fs, part_path, journal_path, dl)) {
+        log_write("[CURL] resuming segmented download: %s\n", part_path.s);
+    } else {
+        const auto& options = e.GetSegments();
+        const auto min_size = std::max<s64>(options.m_min_size, CHUNK_SIZE);
+        const auto max_count = std::clamp<u32>(options.m_count, 1, SEGMENT_MAX);
+        const auto count = std::clamp<s64>(size / min_size, 1, max_count);
+        const auto segment_size = size / count;
+
+        for (s64 i = 0; i < count; i++) {
+            const auto offset = i * segment_size;
+            const auto entry_size = i == count - 1 ? size - offset : segment_size;
+            dl.segments.emplace_back(offset, entry_size, 0);
+        }
+        dl.header.segment_count = dl.segments.size();
+
+        fs.DeleteFile(part_path);
+        fs.DeleteFile(journal_path);
+        if (R_FAILED(fs.CreateFile(part_path, size, 0))) {
+            log_write("failed to create file: %s\n", part_path.s);
+            return ApiResult{};
+        }
+    }
+
+    if (R_FAILED(fs.OpenFile(part_path, FsOpenMode_Write|FsOpenMode_Append, &dl.f))) {
+        log_write("failed to open file: %s\n", part_path.s);
+        return ApiResult{};
+    }
+
+    if (auto rc = fs.CreateFile(journal_path, 0, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
+        log_write("failed to create file: %s\n", journal_path.s);
+        return ApiResult{};
+    }
+
+    if (R_FAILED(fs.OpenFile(journal_path, FsOpenMode_Write|FsOpenMode_Append, &dl.journal_f))) {
+        log_write("failed to open file: %s\n", journal_path.s);
+        return ApiResult{};
+    }
+
+    u32 pending{};
+    for (const auto& entry : dl.segments) {
+        dl.downloaded += entry.done;
+        pending += entry.done < entry.size;
+    }
+
+    {
+        SCOPED_MUTEX(&dl.mutex);
+        WriteSegmentJournal(&dl);
+    }
+
+    log_write("[CURL] segmented download size: %zd segments: %zu pending: %u\n", size, dl.segments.size(), pending);
+
+    // borrow idle threads, the caller's thread also downloads.
+    u32 workers{};
+    for (auto& thread : g_threads) {
+        if (workers + 1 >= pending) {
+            break;
+        }
+
+        {
+            SCOPED_MUTEX(&dl.mutex);
+            dl.active_workers++;
+        }
+
+        const auto started = !thread.InProgress() && thread.SetupJob([&dl](CURL* curl){
+            RunSegments(curl, &dl);
+
+            SCOPED_MUTEX(&dl.mutex);
+            dl.active_workers--;
+            condvarWakeAll(&dl.cond);
+        });
+
+        if (started) {
+            workers++;
+        } else {
+            SCOPED_MUTEX(&dl.mutex);
+            dl.active_workers--;
+        }
+    }
+
+    RunSegments(curl, &dl);
+
+    // wait for the borrowed threads to finish as they reference dl.
+    mutexLock(&dl.mutex);
+    while (dl.active_workers) {
+        condvarWait(&dl.cond, &dl.mutex);
+    }
+    mutexUnlock(&dl.mutex);
+
+    dl.f.Close();
+    dl.journal_f.Close();
+
+    bool success = !dl.failed;
+    for (const auto& entry : dl.segments) {
+        success &= entry.done == entry.size;
+    }
+
+    if (success) {
+        fs.DeleteFile(e.GetPath());
+        fs.CreateDirectoryRecursivelyWithPath(e.GetPath());
+        if (R_FAILED(fs.RenameFile(part_path, e.GetPath()))) {
+            success = false;
+        } else {
+            fs.DeleteFile(journal_path);
+            if (e.GetFlags() & Flag_Cache) {
+                g_cache.set(e.GetPath(), header_out);
+            }
+        }
+    } else {
+        log_write("[CURL] segmented download incomplete, keeping for resume: %s\n", part_path.s);
+    }
+
+    // report the code of the complete file rather than the probe's 206.
+    http_code = success ? 200 : http_code;
+    log_write("Downloaded %s code: %ld segmented\n", e.GetUrl().c_str(), http_code);
+    return ApiResult{success, http_code, header_out, {}, e.GetPath()};
+}
+
+// state for a single download, split from DownloadInternal() so that the
+// transfer can be driven either by curl_easy_perform() or by the multi handle.
+struct DownloadRequest {
+    DownloadRequest(const Api& _api) : api{_api} {}
+
+    ~DownloadRequest() {
+        if (list) {
+            curl_slist_free_all(list);
+        }
+    }
+
+    const Api& api;
+    std::string encoded_url{};
+    fs::FsNativeSd fs{};
+    fs::FsPath tmp_buf{};
+    DataStruct chunk{};
+    Header header_in{};
+    Header header_out{};
+    curl_slist* list{};
+    bool has_file{};
+};
+
+// sets up the handle for the download, returns false if it failed.
+auto DownloadSetup(CURL* curl, DownloadRequest& r) -> bool {
+    const auto& e = r.api;
+    auto& fs = r.fs;
+    auto& chunk = r.chunk;
+    auto& header_in = r.header_in;
+
+    r.has_file = !e.GetPath().empty() && e.GetPath() != "";
+    const bool has_post = !e.GetFields().empty() && e.GetFields() != "";
+    header_in = e.GetHeader();
+
+    if (r.has_file) {
+        GetDownloadTempPath(r.tmp_buf);
+        fs.CreateDirectoryRecursivelyWithPath(r.tmp_buf);
+
+        if (auto rc = fs.CreateFile(r.tmp_buf, 0, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
+            log_write("failed to create file: %s\n", r.tmp_buf.s);
+            return false;
+        }
+
+        if (R_FAILED(fs.OpenFile(r.tmp_buf, FsOpenMode_Write|FsOpenMode_Append, &chunk.f))) {
+            log_write("failed to open file: %s\n", r.tmp_buf.s);
+            return false;
+        }
+
+        // only add etag if the dst file still exists.
+        // a single stat gets both that and the size / timestamp to validate the etag.
+        FsTimeStampRaw ts{};
+        s64 file_size{};
+        if ((e.GetFlags() & Flag_Cache) && R_SUCCEEDED(fs.FileGetSizeAndTimestamp(e.GetPath(), &ts, &file_size))) {
+            g_cache.get(e.GetPath(), file_size, ts.is_valid ? ts.modified : 0, header_in);
+        }
+    }
+
+    // reserve the first chunk
+    chunk.data.reserve(CHUNK_SIZE);
+
+    curl_easy_reset(curl);
+    SetCommonCurlOptions(curl, e);
+
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, r.encoded_url.c_str());
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &r.header_out);
+
+    if (has_post) {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_POSTFIELDS, e.GetFields().c_str());
+        log_write("setting post field: %s\n", e.GetFields().c_str());
+    }
+
+    r.list = CreateHeaderList(header_in);
+    if (r.list) {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, r.list);
+    }
+
+    // write calls.
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, r.has_file ? WriteFileCallback : WriteMemoryCallback);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &chunk);
+
+    return true;
+}
+
+// cleans up after the transfer has finished and reports the result.
+auto DownloadFinish(CURL* curl, DownloadRequest& r, CURLcode res) -> ApiResult {
+    const auto& e = r.api;
+    auto& fs = r.fs;
+    auto& chunk = r.chunk;
+    auto& header_out = r.header_out;
+    bool success = res == CURLE_OK;
+
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+    if (r.has_file) {
+        ON_SCOPE_EXIT( fs.DeleteFile(r.tmp_buf) );
+        if (res == CURLE_OK && chunk.offset) {
+            chunk.f.Write(chunk.file_offset, chunk.data.data(), chunk.offset, FsWriteOption_None);
+        }
+
+        chunk.f.Close();
+
+        if (res == CURLE_OK) {
+            if (http_code == 304) {
+                log_write("cached download: %s\n", e.GetUrl().c_str());
+            } else {
+                log_write("un-cached download: %s code: %lu\n", e.GetUrl().c_str(), http_code);
+
+                // enable to log received headers.
+                #if 0
+                log_write("\n\nLOGGING HEADER\n");
+                    for (auto [a, b] : header_out.m_map) {
+                        log_write("\t%s: %s\n", a.c_str(), b.c_str());
+                    }
+                log_write("\n\n");
+                #endif
+
+                fs.DeleteFile(e.GetPath());
+                fs.CreateDirectoryRecursivelyWithPath(e.GetPath());
+                if (R_FAILED(fs.RenameFile(r.tmp_buf, e.GetPath()))) {
+                    success = false;
+                } else if (e.GetFlags() & Flag_Cache) {
+                    g_cache.set(e.GetPath(), header_out);
+                }
+            }
+        }
+        chunk.data.clear();
+    } else {
+        // empty data if we failed
+        if (res != CURLE_OK) {
+            chunk.data.clear();
+        }
+    }
+
+    log_write("Downloaded %s code: %ld %s\n", e.GetUrl().c_str(), http_code, curl_easy_strerror(res));
+    return {success, http_code, header_out, std::move(chunk.data), e.GetPath()};
+}
+
+auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
+    App::SetAutoSleepDisabled(true);
+    ON_SCOPE_EXIT(App::SetAutoSleepDisabled(false));
+
+    // check if stop has been requested before starting download
+    if (e.GetToken().stop_requested()) {
+        return {};
+    }
+
+    DownloadRequest r{e};
+    r.encoded_url = EncodeUrl(e.GetUrl());
+
+    const bool has_file = !e.GetPath().empty() && e.GetPath() != "";
+    const bool has_post = !e.GetFields().empty() && e.GetFields() != "";
+    if ((e.GetFlags() & Flag_Segmented) && has_file && !has_post && e.GetCustomRequest().empty()) {
+        if (auto result = DownloadSegmented(curl, e, r.encoded_url)) {
+            return *result;
+        }
+    }
+
+    if (!DownloadSetup(curl, r)) {
+        return {};
+    }
+
+    // perform download and cleanup after and report the result.
+    const auto res = curl_easy_perform(curl);
+    return DownloadFinish(curl, r, res);
+}
+
+auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
+    // check if stop has been requested before starting download
+    if (e.GetToken().stop_requested()) {
+        return {};
+    }
+
+    if (e.GetUrl().starts_with("webdav://")) {
+        if (!WebdavCreateFolder(curl, e)) {
+            log_write("[CURL] failed to create webdav folder, aborting\n");
             return {};
         }
     }
@@ -877,27 +1574,9 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
     // instruct libcurl to create ftp folders if they don't yet exist.
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_FTP_CREATE_MISSING_DIRS, CURLFTP_CREATE_DIR_RETRY);
 
-    struct curl_slist* list = NULL;
+    auto list = CreateHeaderList(header_in);
     ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
 
-    for (const auto& [key, value] : header_in.m_map) {
-        if (value.empty()) {
-            continue;
-        }
-
-        // create header key value pair.
-        const auto header_str = key + ": " + value;
-
-        // try to append header chunk.
-        auto temp = curl_slist_append(list, header_str.c_str());
-        if (temp) {
-            log_write("adding header: %s\n", header_str.c_str());
-            list = temp;
-        } else {
-            log_write("failed to append header\n");
-        }
-    }
-
     if (list) {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
     }
@@ -1011,6 +1690,334 @@ auto WebdavCreateFolder(CURL* curl, const Api& e) -> bool {
     return true;
 }
 
+void PushCompleteEvent(const Api& api, const ApiResult& result) {
+    if (g_running && api.GetOnComplete() && !api.GetToken().stop_requested()) {
+        evman::push(
+            DownloadEventData{api.GetOnComplete(), result, api.GetToken()},
+            false
+        );
+    }
+}
+
+struct MultiQueue;
+
+struct MultiTransfer {
+    // callers that asked for the same (url, path), they all get the result.
+    struct Waiter {
+        OnComplete callback;
+        StopToken stoken;
+    };
+
+    MultiTransfer(MultiQueue* _queue, const Api& _api, const std::string& _key) : queue{_queue}, api{_api}, key{_key} {
+        waiters.emplace_back(api.GetOnComplete(), api.GetToken());
+    }
+
+    MultiQueue* queue;
+    Api api;
+    // references the api above, so the transfer must not be moved.
+    DownloadRequest request{api};
+    // empty if the request can't be shared.
+    std::string key;
+    // protected by the queue mutex.
+    std::vector<Waiter> waiters{};
+    CURL* curl{};
+};
+
+// runs async downloads on a single thread using a multi handle, rather than
+// one transfer per thread. http/2 transfers to the same host are multiplexed
+// over a shared connection, so a screen of icons can be requested at once.
+// http/1.1 servers fall back to a connection per transfer.
+// requests for the same (url, path) that are queued or in flight are merged,
+// and a transfer is dropped / aborted once all of its callers have stopped.
+struct MultiQueue {
+    auto Create() -> Result {
+        m_multi = curl_multi_init();
+        R_UNLESS(m_multi != nullptr, Result_CurlFailedEasyInit);
+
+        curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, MULTI_MAX_HOST_CONNECTIONS);
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_CONCURRENT_STREAMS, (long)MULTI_MAX_TRANSFERS);
+
+        R_TRY(threadCreate(&m_thread, ThreadFunc, this, nullptr, 1024*32, THREAD_PRIO, THREAD_CORE));
+        if (auto rc = threadStart(&m_thread); R_FAILED(rc)) {
+            threadClose(&m_thread);
+            R_THROW(rc);
+        }
+
+        m_created = true;
+        R_SUCCEED();
+    }
+
+    void Close() {
+        if (m_created) {
+            curl_multi_wakeup(m_multi);
+            threadWaitForExit(&m_thread);
+            threadClose(&m_thread);
+            m_created = false;
+        }
+
+        for (auto& transfer : m_active) {
+            curl_multi_remove_handle(m_multi, transfer->curl);
+            curl_easy_cleanup(transfer->curl);
+            App::SetAutoSleepDisabled(false);
+        }
+        m_active.clear();
+        m_pending.clear();
+        m_lookup.clear();
+
+        for (auto curl : m_free_handles) {
+            curl_easy_cleanup(curl);
+        }
+        m_free_handles.clear();
+
+        if (m_multi) {
+            curl_multi_cleanup(m_multi);
+            m_multi = nullptr;
+        }
+    }
+
+    auto IsCreated() const -> bool {
+        return m_created;
+    }
+
+    auto Add(const Api& api) -> bool {
+        if (api.GetUrl().empty() || !api.GetOnComplete()) {
+            return false;
+        }
+
+        mutexLock(&m_mutex);
+        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+        // post requests and custom requests may not return the same result each time.
+        std::string key;
+        if (api.GetFields().empty() && api.GetCustomRequest().empty()) {
+            key = api.GetUrl() + '\n' + api.GetPath().toString();
+        }
+
+        if (!key.empty()) {
+            // a transfer that all of its callers have stopped is about to be
+            // dropped / aborted, so start a new one rather than merging with it.
+            if (auto it = m_lookup.find(key); it != m_lookup.end() && IsStopped(*it->second)) {
+                m_lookup.erase(it);
+            } else if (it != m_lookup.end()) {
+                auto transfer = it->second;
+                transfer->waiters.emplace_back(api.GetOnComplete(), api.GetToken());
+                log_write("[CURL] merged duplicate request: %s waiters: %zu\n", api.GetUrl().c_str(), transfer->waiters.size());
+
+                // bump the queued request to the front if the new one is more urgent.
+                if (api.GetPriority() == Priority::High) {
+                    const auto pit = std::ranges::find_if(m_pending, [transfer](auto& e) {
+                        return e.get() == transfer;
+                    });
+                    if (pit != m_pending.end() && pit != m_pending.begin()) {
+                        std::rotate(m_pending.begin(), pit, pit + 1);
+                    }
+                }
+
+                return true;
+            }
+        }
+
+        auto transfer = std::make_unique<MultiTransfer>(this, api, key);
+        if (!key.empty()) {
+            m_lookup.emplace(key, transfer.get());
+        }
+
+        switch (api.GetPriority()) {
+            case Priority::Normal:
+                m_pending.emplace_back(std::move(transfer));
+                break;
+            case Priority::High:
+                m_pending.emplace_front(std::move(transfer));
+                break;
+        }
+
+        curl_multi_wakeup(m_multi);
+        return true;
+    }
+
+    static void ThreadFunc(void* p);
+
+private:
+    // returns true if every caller of the transfer has stopped.
+    // must be called with the mutex locked.
+    static auto IsStopped(const MultiTransfer& transfer) -> bool {
+        return std::ranges::all_of(transfer.waiters, [](auto& e) {
+            return e.stoken.stop_requested();
+        });
+    }
+
+    static auto ProgressCallback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) -> int {
+        auto transfer = static_cast<MultiTransfer*>(clientp);
+        if (!g_running) {
+            return 1;
+        }
+
+        {
+            mutexLock(&transfer->queue->m_mutex);
+            ON_SCOPE_EXIT(mutexUnlock(&transfer->queue->m_mutex));
+            // abort the transfer if no one is waiting for it anymore.
+            if (IsStopped(*transfer)) {
+                log_write("[CURL] aborting stopped transfer: %s\n", transfer->api.GetUrl().c_str());
+                transfer->queue->RemoveLookup(*transfer);
+                return 1;
+            }
+        }
+
+        if (transfer->api.GetOnProgress() && !transfer->api.GetOnProgress()(dltotal, dlnow, ultotal, ulnow)) {
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // removes the transfer from the lookup so that new requests aren't merged with it.
+    // the key may already belong to a newer transfer if this one was stopped.
+    // must be called with the mutex locked.
+    void RemoveLookup(const MultiTransfer& transfer) {
+        if (!transfer.key.empty()) {
+            if (auto it = m_lookup.find(transfer.key); it != m_lookup.end() && it->second == &transfer) {
+                m_lookup.erase(it);
+            }
+        }
+    }
+
+    // sends the result to every caller that hasn't stopped.
+    void Complete(MultiTransfer& transfer, const ApiResult& result) {
+        mutexLock(&m_mutex);
+        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+        RemoveLookup(transfer);
+        for (const auto& e : transfer.waiters) {
+            if (g_running && e.callback && !e.stoken.stop_requested()) {
+                evman::push(DownloadEventData{e.callback, result, e.stoken}, false);
+            }
+        }
+    }
+
+    // moves pending requests onto the multi handle until it's full.
+    void StartPending() {
+        {
+            mutexLock(&m_mutex);
+            ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+            // drop queued requests that no one is waiting for anymore,
+            // this happens a lot when quickly scrolling through a list.
+            const auto removed = std::erase_if(m_pending, [this](auto& transfer) {
+                if (!IsStopped(*transfer)) {
+                    return false;
+                }
+
+                RemoveLookup(*transfer);
+                return true;
+            });
+
+            if (removed) {
+                log_write("[CURL] dropped %zu stopped requests\n", removed);
+            }
+        }
+
+        while (g_running && m_active.size() < MULTI_MAX_TRANSFERS) {
+            std::unique_ptr<MultiTransfer> transfer;
+            {
+                mutexLock(&m_mutex);
+                ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+                if (m_pending.empty()) {
+                    break;
+                }
+
+                transfer = std::move(m_pending.front());
+                m_pending.pop_front();
+            }
+
+            const auto& api = transfer->api;
+            if (!m_free_handles.empty()) {
+                transfer->curl = m_free_handles.back();
+                m_free_handles.pop_back();
+            } else {
+                transfer->curl = curl_easy_init();
+            }
+
+            if (!transfer->curl) {
+                log_write("[CURL] failed to create multi easy handle\n");
+                Complete(*transfer, {});
+                continue;
+            }
+
+            auto curl = transfer->curl;
+            transfer->request.encoded_url = EncodeUrl(api.GetUrl());
+            if (!DownloadSetup(curl, transfer->request)) {
+                m_free_handles.emplace_back(curl);
+                Complete(*transfer, {});
+                continue;
+            }
+
+            CURL_EASY_SETOPT_LOG(curl, CURLOPT_PRIVATE, transfer.get());
+            CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+            // wait for an existing connection to multiplex on, rather than opening a new one.
+            CURL_EASY_SETOPT_LOG(curl, CURLOPT_PIPEWAIT, 1L);
+            // checks all of the waiters rather than just the api's token.
+            CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFODATA, transfer.get());
+            CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+
+            if (auto rc = curl_multi_add_handle(m_multi, curl); rc != CURLM_OK) {
+                log_write("[CURL] curl_multi_add_handle() msg: %s\n", curl_multi_strerror(rc));
+                m_free_handles.emplace_back(curl);
+                Complete(*transfer, {});
+                continue;
+            }
+
+            App::SetAutoSleepDisabled(true);
+            m_active.emplace_back(std::move(transfer));
+        }
+    }
+
+    // finishes the transfers that have completed and reports their results.
+    void ReadCompleted() {
+        int msgs_left;
+        while (auto msg = curl_multi_info_read(m_multi, &msgs_left)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            // msg is invalid once the handle is removed.
+            auto curl = msg->easy_handle;
+            const auto res = msg->data.result;
+            curl_multi_remove_handle(m_multi, curl);
+
+            const auto it = std::ranges::find(m_active, curl, &MultiTransfer::curl);
+            if (it == m_active.end()) {
+                log_write("[CURL] unknown multi transfer finished\n");
+                curl_easy_cleanup(curl);
+                continue;
+            }
+
+            auto& transfer = *it;
+            const auto result = DownloadFinish(curl, transfer->request, res);
+            Complete(*transfer, result);
+            App::SetAutoSleepDisabled(false);
+
+            m_free_handles.emplace_back(curl);
+            m_active.erase(it);
+        }
+    }
+
+private:
+    CURLM* m_multi{};
+    Thread m_thread{};
+    // protects the pending queue, the lookup and the waiters of each transfer.
+    Mutex m_mutex{};
+    std::deque<std::unique_ptr<MultiTransfer>> m_pending{};
+    // (url, path) of pending and active transfers, used to merge requests.
+    std::unordered_map<std::string, MultiTransfer*> m_lookup{};
+    // only accessed by the thread.
+    std::vector<std::unique_ptr<MultiTransfer>> m_active{};
+    std::vector<CURL*> m_free_handles{};
+    bool m_created{};
+};
+
+MultiQueue g_multi_queue;
+
 void my_lock(CURL *handle, curl_lock_data data, curl_lock_access laccess, void *useptr) {
     mutexLock(&g_mutex_share[data]);
 }
@@ -1032,18 +2039,34 @@ void ThreadEntry::ThreadFunc(void* p) {
             continue;
         }
 
-        const auto result = data->m_api.IsUpload() ? UploadInternal(data->m_curl, data->m_api) : DownloadInternal(data->m_curl, data->m_api);
-        if (g_running && data->m_api.GetOnComplete() && !data->m_api.GetToken().stop_requested()) {
-            evman::push(
-                DownloadEventData{data->m_api.GetOnComplete(), result, data->m_api.GetToken()},
-                false
-            );
+        if (data->m_job) {
+            data->m_job(data->m_curl);
+            data->m_job = {};
+        } else {
+            const auto result = data->m_api.IsUpload() ? UploadInternal(data->m_curl, data->m_api) : DownloadInternal(data->m_curl, data->m_api);
+            PushCompleteEvent(data->m_api, result);
         }
 
         data->m_in_progress = false;
         // notify the queue that there's a space free
         ueventSignal(&g_thread_queue.m_uevent);
     }
+
+    // a job may have been handed over just before exiting, it still has to run
+    // as the caller waits for it to finish. it returns straight away, as the
+    // transfer is aborted once g_running is cleared.
+    ThreadEntry::Job job;
+    {
+        SCOPED_MUTEX(&data->m_mutex);
+        data->m_exited = true;
+        job = std::move(data->m_job);
+        data->m_job = {};
+    }
+
+    if (job) {
+        job(data->m_curl);
+    }
+
     log_write("exited download thread\n");
 }
 
@@ -1061,6 +2084,12 @@ void ThreadQueue::ThreadFunc(void* p) {
 
         mutexLock(&data->m_mutex);
         ON_SCOPE_EXIT(mutexUnlock(&data->m_mutex));
+
+        // drop queued requests that have been stopped whilst waiting.
+        std::erase_if(data->m_entries, [](auto& e) {
+            return e.api.GetToken().stop_requested();
+        });
+
         if (data->m_entries.empty()) {
             continue;
         }
@@ -1079,8 +2108,8 @@ void ThreadQueue::ThreadFunc(void* p) {
                     return;
                 }
 
-                if (!thread.InProgress()) {
-                    thread.Setup(entry.api);
+                // setup can fail if the thread was borrowed for a segmented download.
+                if (!thread.InProgress() && thread.Setup(entry.api)) {
                     // log_write("[dl queue] starting download\n");
                     // mark entry for deletion
                     entry.m_delete = true;
@@ -1104,6 +2133,25 @@ void ThreadQueue::ThreadFunc(void* p) {
     log_write("exited download thread queue\n");
 }
 
+void MultiQueue::ThreadFunc(void* p) {
+    auto data = static_cast<MultiQueue*>(p);
+    while (g_running) {
+        data->StartPending();
+
+        int running{};
+        if (auto rc = curl_multi_perform(data->m_multi, &running); rc != CURLM_OK) {
+            log_write("[CURL] curl_multi_perform() msg: %s\n", curl_multi_strerror(rc));
+        }
+
+        data->ReadCompleted();
+
+        // sleeps until a transfer has data or Add() wakes us up.
+        curl_multi_poll(data->m_multi, nullptr, 0, 1000, nullptr);
+    }
+
+    log_write("exited download multi queue\n");
+}
+
 } // namespace
 
 auto Init() -> bool {
@@ -1134,6 +2182,11 @@ auto Init() -> bool {
         }
     }
 
+    // async downloads fall back to the thread queue if this fails.
+    if (R_FAILED(g_multi_queue.Create())) {
+        log_write("!failed to create download multi queue\n");
+    }
+
     g_curl_single = curl_easy_init();
     if (!g_curl_single) {
         log_write("failed to create g_curl_single\n");
@@ -1141,9 +2194,7 @@ auto Init() -> bool {
 
     log_write("finished creating threads\n");
 
-    if (!g_cache.init()) {
-        log_write("failed to init json cache\n");
-    }
+    g_cache.init();
 
     return true;
 }
@@ -1152,6 +2203,7 @@ void Exit() {
     g_running = false;
 
     g_thread_queue.Close();
+    g_multi_queue.Close();
 
     if (g_curl_single) {
         curl_easy_cleanup(g_curl_single);
@@ -1200,10 +2252,17 @@ auto FromFile(const Api& e) -> ApiResult {
 }
 
 auto ToMemoryAsync(const Api& api) -> bool {
+    if (g_multi_queue.IsCreated()) {
+        return g_multi_queue.Add(api);
+    }
     return g_thread_queue.Add(api);
 }
 
 auto ToFileAsync(const Api& e) -> bool {
+    // segmented downloads borrow idle threads from the thread queue.
+    if (g_multi_queue.IsCreated() && !(e.GetFlags() & Flag_Segmented)) {
+        return g_multi_queue.Add(e);
+    }
     return g_thread_queue.Add(e);
 }
 
@@ -1218,6 +2277,14 @@ auto FromFileAsync(const Api& e) -> bool {
 auto EscapeString(const std::string& str) -> std::string {
     return EscapeString(nullptr, str);
 }
+
+void SetupHandle(void* curl, const Api& e) {
+    SetCommonCurlOptions(static_cast<CURL*>(curl), e);
+}
+
+auto HeaderCallback(char* b, size_t size, size_t nitems, void* userdata) -> size_t {
+    return header_callback(b, size, nitems, userdata);
+}
 // --- helper local para inserir/normalizar "Key: Value" em curl::Header ---
 static inline void header_insert_line(Header& h, const std::string& line) {
     auto pos = line.find(':');
@@ -103,8 +103,6 @@ private:
 #endif
 
 Result DumpToFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& root, BaseSource* source, std::span<const fs::FsPath> paths) {
-    const auto is_file_based_emummc = App::IsFileBaseEmummc();
-
     for (const auto& path : paths) {
         const auto base_path = fs::AppendPath(root, path);
         const auto file_size = source->GetSize(path);
@@ -122,17 +120,16 @@ Result DumpToFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& root, Bas
         {
             fs::File file;
             R_TRY(fs->OpenFile(temp_path, FsOpenMode_Write, &file));
+            thread::Throttle throttle{};
 
             R_TRY(thread::Transfer(pbox, file_size,
                 [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
                     return source->Read(path, data, off, size, bytes_read);
                 },
                 [&](const void* data, s64 off, s64 size) -> Result {
-                    const auto rc = file.Write(off, data, size, FsWriteOption_None);
-                    if (is_file_based_emummc) {
-                        svcSleepThread(2e+6); // 2ms
-                    }
-                    return rc;
+                    return throttle.Run(size, [&]() -> Result {
+                        return file.Write(off, data, size, FsWriteOption_None);
+                    });
                 }
             ));
         }
@@ -1,20 +1,32 @@
 #include "hasher.hpp"
 #include "app.hpp"
+#include "log.hpp"
+#include "defines.hpp"
 #include "threaded_file_transfer.hpp"
 #include <mbedtls/md5.h>
 #include <utility>
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 namespace npshop::hash {
 namespace {
 
+constexpr fs::FsPath CACHE_PATH{"/config/npshop/hash_cache.txt"};
+// oldest entries are dropped once the cache is full.
+constexpr u32 CACHE_MAX_ENTRIES = 512;
+constexpr u32 TYPE_COUNT = std::size(ALL_TYPES);
+
 consteval auto CalculateHashStrLen(s64 buf_size) {
     return buf_size * 2 + 1;
 }
 
 struct FileSource final : BaseSource {
-    FileSource(fs::Fs* fs, const fs::FsPath& path) : m_fs{fs} {
+    FileSource(fs::Fs* fs, const fs::FsPath& path) : m_fs{fs}, m_throttle{fs->IsNative() && App::IsFileBaseEmummc()} {
         m_open_result = m_fs->OpenFile(path, FsOpenMode_Read, std::addressof(m_file));
-        m_is_file_based_emummc = App::IsFileBaseEmummc();
     }
 
     Result Size(s64* out) override {
@@ -22,18 +34,16 @@ struct FileSource final : BaseSource {
     }
 
     Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override {
-        const auto rc = m_file.Read(off, buf, size, 0, bytes_read);
-        if (m_fs->IsNative() && m_is_file_based_emummc) {
-            svcSleepThread(2e+6); // 2ms
-        }
-        return rc;
+        return m_throttle.Run(size, [&]() -> Result {
+            return m_file.Read(off, buf, size, 0, bytes_read);
+        });
     }
 
 private:
     fs::Fs* m_fs{};
     fs::File m_file{};
     Result m_open_result{};
-    bool m_is_file_based_emummc{};
+    thread::Throttle m_throttle;
 };
 
 struct MemSource final : BaseSource {
@@ -156,7 +166,166 @@ private:
     Sha256Context m_ctx{};
 };
 
-Result Hash(ui::ProgressBox* pbox, std::unique_ptr<HashSource> hash, BaseSource* source, std::string& out) {
+auto MakeHashSource(Type type) -> std::unique_ptr<HashSource> {
+    switch (type) {
+        case Type::Crc32: return std::make_unique<HashCrc32>();
+        case Type::Md5: return std::make_unique<HashMd5>();
+        case Type::Sha1: return std::make_unique<HashSha1>();
+        case Type::Sha256: return std::make_unique<HashSha256>();
+    }
+    std::unreachable();
+}
+
+// updates several hashes with the same data. the first hash is updated on the
+// calling thread, the rest each have their own thread, so they run on different cores.
+struct MultiHash {
+    MultiHash(std::span<const std::unique_ptr<HashSource>> hashes) : m_hashes{hashes} {
+        mutexInit(std::addressof(m_mutex));
+        condvarInit(std::addressof(m_can_work));
+        condvarInit(std::addressof(m_done));
+    }
+
+    ~MultiHash() {
+        Close();
+    }
+
+    // if this fails, all hashes are updated on the calling thread.
+    Result Create() {
+        const auto rc = CreateInternal();
+        if (R_FAILED(rc)) {
+            Close();
+        }
+        return rc;
+    }
+
+    void Update(const void* buf, s64 size) {
+        if (m_workers.empty()) {
+            for (auto& hash : m_hashes) {
+                hash->Update(buf, size);
+            }
+            return;
+        }
+
+        mutexLock(std::addressof(m_mutex));
+        m_buf = buf;
+        m_size = size;
+        m_pending = m_workers.size();
+        m_generation++;
+        condvarWakeAll(std::addressof(m_can_work));
+        mutexUnlock(std::addressof(m_mutex));
+
+        m_hashes[0]->Update(buf, size);
+
+        // the buffer is only valid until this returns, so wait for the workers.
+        SCOPED_MUTEX(std::addressof(m_mutex));
+        while (m_pending) {
+            condvarWait(std::addressof(m_done), std::addressof(m_mutex));
+        }
+    }
+
+private:
+    Result CreateInternal() {
+        m_running = true;
+        m_workers.resize(m_hashes.size() - 1);
+
+        for (u32 i = 0; i < m_workers.size(); i++) {
+            auto& worker = m_workers[i];
+            worker.self = this;
+            worker.hash = m_hashes[i + 1].get();
+            R_TRY(threadCreate(&worker.thread, WorkerFunc, std::addressof(worker), nullptr, 1024*64, PRIO_PREEMPTIVE, i % 3));
+            worker.created = true;
+            R_TRY(threadStart(&worker.thread));
+            worker.started = true;
+        }
+
+        R_SUCCEED();
+    }
+
+    struct Worker {
+        MultiHash* self{};
+        HashSource* hash{};
+        Thread thread{};
+        bool created{};
+        bool started{};
+    };
+
+    void Close() {
+        mutexLock(std::addressof(m_mutex));
+        m_running = false;
+        condvarWakeAll(std::addressof(m_can_work));
+        mutexUnlock(std::addressof(m_mutex));
+
+        for (auto& worker : m_workers) {
+            if (worker.started) {
+                threadWaitForExit(&worker.thread);
+            }
+            if (worker.created) {
+                threadClose(&worker.thread);
+            }
+        }
+
+        m_workers.clear();
+    }
+
+    static void WorkerFunc(void* p) {
+        auto worker = static_cast<Worker*>(p);
+        auto self = worker->self;
+        u32 generation{};
+
+        for (;;) {
+            mutexLock(std::addressof(self->m_mutex));
+            while (self->m_running && self->m_generation == generation) {
+                condvarWait(std::addressof(self->m_can_work), std::addressof(self->m_mutex));
+            }
+
+            if (!self->m_running) {
+                mutexUnlock(std::addressof(self->m_mutex));
+                break;
+            }
+
+            generation = self->m_generation;
+            const auto buf = self->m_buf;
+            const auto size = self->m_size;
+            mutexUnlock(std::addressof(self->m_mutex));
+
+            worker->hash->Update(buf, size);
+
+            mutexLock(std::addressof(self->m_mutex));
+            if (!--self->m_pending) {
+                condvarWakeOne(std::addressof(self->m_done));
+            }
+            mutexUnlock(std::addressof(self->m_mutex));
+        }
+    }
+
+private:
+    const std::span<const std::unique_ptr<HashSource>> m_hashes;
+    std::vector<Worker> m_workers{};
+
+    Mutex m_mutex{};
+    CondVar m_can_work{};
+    CondVar m_done{};
+
+    const void* m_buf{};
+    s64 m_size{};
+    u32 m_pending{};
+    u32 m_generation{};
+    bool m_running{};
+};
+
+Result HashInternal(ui::ProgressBox* pbox, std::span<const Type> types, BaseSource* source, std::vector<std::string>& out) {
+    R_UNLESS(!types.empty(), 0x1);
+
+    std::vector<std::unique_ptr<HashSource>> hashes;
+    for (const auto type : types) {
+        hashes.emplace_back(MakeHashSource(type));
+    }
+
+    MultiHash multi_hash{hashes};
+    if (hashes.size() > 1 && R_FAILED(multi_hash.Create())) {
+        log_write("[HASH] failed to create threads, hashing on a single thread\n");
+    }
+
     s64 file_size;
     R_TRY(source->Size(&file_size));
 
@@ -165,15 +334,133 @@ Result Hash(ui::ProgressBox* pbox, std::unique_ptr<HashSource> hash, BaseSource*
             return source->Read(data, off, size, bytes_read);
         },
         [&](const void* data, s64 off, s64 size) -> Result {
-            hash->Update(data, size);
+            multi_hash.Update(data, size);
             R_SUCCEED();
         }
     ));
 
-    hash->Get(out);
+    out.resize(hashes.size());
+    for (u32 i = 0; i < hashes.size(); i++) {
+        hashes[i]->Get(out[i]);
+    }
+
     R_SUCCEED();
 }
 
+// hashes of files that have already been hashed, stored as one line per file:
+// size, modified timestamp, a hash for each type (empty if not yet hashed) and the key.
+struct CacheEntry {
+    std::string key{};
+    s64 size{};
+    u64 timestamp{};
+    std::string hashes[TYPE_COUNT]{};
+};
+
+Mutex g_cache_mutex{};
+// ordered from least to most recently used.
+std::list<CacheEntry> g_cache{};
+std::unordered_map<std::string, std::list<CacheEntry>::iterator> g_cache_index{};
+bool g_cache_loaded{};
+// set when an entry changes, the cache is only written on exit.
+bool g_cache_dirty{};
+
+void CacheAdd(CacheEntry&& entry) {
+    // later lines replace earlier ones with the same key.
+    if (const auto it = g_cache_index.find(entry.key); it != g_cache_index.end()) {
+        g_cache.erase(it->second);
+        g_cache_index.erase(it);
+    }
+
+    const auto it = g_cache.emplace(g_cache.end(), std::move(entry));
+    g_cache_index.emplace(it->key, it);
+
+    while (g_cache.size() > CACHE_MAX_ENTRIES) {
+        g_cache_index.erase(g_cache.front().key);
+        g_cache.pop_front();
+    }
+}
+
+void CacheLoad() {
+    if (g_cache_loaded) {
+        return;
+    }
+    g_cache_loaded = true;
+
+    std::vector<u8> data;
+    if (R_FAILED(fs::FsNativeSd().read_entire_file(CACHE_PATH, data))) {
+        return;
+    }
+
+    std::string_view view{(const char*)data.data(), data.size()};
+    while (!view.empty()) {
+        const auto line_end = std::min(view.find('\n'), view.size());
+        auto line = view.substr(0, line_end);
+        view.remove_prefix(std::min(line_end + 1, view.size()));
+
+        // split on tabs, the key is last as it's the only field that could contain anything else.
+        std::string_view fields[TYPE_COUNT + 3];
+        u32 count{};
+        for (; count < std::size(fields) - 1; count++) {
+            const auto tab = line.find('\t');
+            if (tab == line.npos) {
+                break;
+            }
+            fields[count] = line.substr(0, tab);
+            line.remove_prefix(tab + 1);
+        }
+        fields[count++] = line;
+
+        if (count != std::size(fields) || fields[TYPE_COUNT + 2].empty()) {
+            continue;
+        }
+
+        CacheEntry entry{};
+        entry.size = std::strtoll(std::string{fields[0]}.c_str(), nullptr, 10);
+        entry.timestamp = std::strtoull(std::string{fields[1]}.c_str(), nullptr, 10);
+        for (u32 i = 0; i < TYPE_COUNT; i++) {
+            entry.hashes[i] = fields[i + 2];
+        }
+        entry.key = fields[TYPE_COUNT + 2];
+        CacheAdd(std::move(entry));
+    }
+
+    log_write("[HASH] loaded cache entries: %zu\n", g_cache.size());
+}
+
+void CacheSave() {
+    if (!g_cache_dirty) {
+        return;
+    }
+    g_cache_dirty = false;
+
+    std::string out;
+    for (const auto& entry : g_cache) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%ld\t%lu\t", entry.size, entry.timestamp);
+        out += buf;
+        for (const auto& hash : entry.hashes) {
+            out += hash + '\t';
+        }
+        out += entry.key + '\n';
+    }
+
+    fs::FsNativeSd fs;
+    if (R_FAILED(fs.write_entire_file(CACHE_PATH, std::vector<u8>(out.begin(), out.end())))) {
+        log_write("[HASH] failed to save cache\n");
+    }
+}
+
+// entries that are found are moved to the back, so the least recently used are dropped first.
+auto CacheFind(const std::string& key) -> CacheEntry* {
+    const auto it = g_cache_index.find(key);
+    if (it == g_cache_index.end()) {
+        return nullptr;
+    }
+
+    g_cache.splice(g_cache.end(), g_cache, it->second);
+    return &g_cache.back();
+}
+
 } // namespace
 
 auto GetTypeStr(Type type) -> const char* {
@@ -187,13 +474,10 @@ auto GetTypeStr(Type type) -> const char* {
 }
 
 Result Hash(ui::ProgressBox* pbox, Type type, BaseSource* source, std::string& out) {
-    switch (type) {
-        case Type::Crc32: return Hash(pbox, std::make_unique<HashCrc32>(), source, out);
-        case Type::Md5: return Hash(pbox, std::make_unique<HashMd5>(), source, out);
-        case Type::Sha1: return Hash(pbox, std::make_unique<HashSha1>(), source, out);
-        case Type::Sha256: return Hash(pbox, std::make_unique<HashSha256>(), source, out);
-    }
-    std::unreachable();
+    std::vector<std::string> hashes;
+    R_TRY(HashInternal(pbox, std::span{&type, 1}, source, hashes));
+    out = hashes[0];
+    R_SUCCEED();
 }
 
 Result Hash(ui::ProgressBox* pbox, Type type, fs::Fs* fs, const fs::FsPath& path, std::string& out) {
@@ -206,4 +490,82 @@ Result Hash(ui::ProgressBox* pbox, Type type, std::span<const u8> data, std::str
     return Hash(pbox, type, source.get(), out);
 }
 
-} // namespace npshop::has
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, BaseSource* source, std::vector<std::string>& out) {
+    return HashInternal(pbox, types, source, out);
+}
+
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, fs::Fs* fs, const fs::FsPath& path, std::vector<std::string>& out, const std::string& cache_key) {
+    out.clear();
+    out.resize(types.size());
+
+    FsTimeStampRaw ts{};
+    s64 size{};
+    const auto use_cache = !cache_key.empty() && R_SUCCEEDED(fs->FileGetSizeAndTimestamp(path, &ts, &size)) && ts.is_valid;
+
+    // only hash the types that aren't cached.
+    std::vector<Type> missing;
+    if (use_cache) {
+        SCOPED_MUTEX(&g_cache_mutex);
+        CacheLoad();
+
+        const auto entry = CacheFind(cache_key);
+        for (u32 i = 0; i < types.size(); i++) {
+            const auto index = std::to_underlying(types[i]);
+            if (entry && entry->size == size && entry->timestamp == ts.modified && !entry->hashes[index].empty()) {
+                out[i] = entry->hashes[index];
+            } else {
+                missing.emplace_back(types[i]);
+            }
+        }
+    } else {
+        missing.assign(types.begin(), types.end());
+    }
+
+    if (missing.empty()) {
+        log_write("[HASH] cache hit: %s\n", cache_key.c_str());
+        R_SUCCEED();
+    }
+
+    auto source = std::make_unique<FileSource>(fs, path);
+    std::vector<std::string> hashes;
+    R_TRY(HashInternal(pbox, missing, source.get(), hashes));
+
+    for (u32 i = 0, j = 0; i < types.size(); i++) {
+        if (out[i].empty()) {
+            out[i] = hashes[j++];
+        }
+    }
+
+    if (use_cache) {
+        SCOPED_MUTEX(&g_cache_mutex);
+
+        auto entry = CacheFind(cache_key);
+        if (!entry || entry->size != size || entry->timestamp != ts.modified) {
+            if (!entry) {
+                CacheAdd(CacheEntry{.key = cache_key});
+                entry = &g_cache.back();
+            }
+
+            entry->size = size;
+            entry->timestamp = ts.modified;
+            for (auto& hash : entry->hashes) {
+                hash.clear();
+            }
+        }
+
+        for (u32 i = 0; i < types.size(); i++) {
+            entry->hashes[std::to_underlying(types[i])] = out[i];
+        }
+
+        g_cache_dirty = true;
+    }
+
+    R_SUCCEED();
+}
+
+void SaveCache() {
+    SCOPED_MUTEX(&g_cache_mutex);
+    CacheSave();
+}
+
+} // namespace npshop::hash
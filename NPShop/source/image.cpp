@@ -22,6 +22,7 @@
 
 #include "app.hpp"
 #include "log.hpp"
+#include "defines.hpp"
 #ifdef USE_NVJPG
 #include <nvjpg.hpp>
 #endif
@@ -48,7 +49,12 @@ auto ImageLoadInternal(stbi_uc* image_data, int x, int y) -> ImageResult {
 }
 
 #ifdef USE_NVJPG
+// the decoder is shared, images are loaded from both the main thread and the image loader.
+Mutex g_nvjpg_mutex{};
+
 auto ImageLoadInternal(nj::Image&& image) -> ImageResult {
+    SCOPED_MUTEX(&g_nvjpg_mutex);
+
     if (!image.is_valid() || image.parse()) {
         log_write("[NVJPG] failed to parse image\n");
         return {};
@@ -1,4 +1,5 @@
 #include "nro.hpp"
+#include "dir_walker.hpp"
 #include "defines.hpp"
 #include "evman.hpp"
 #include "app.hpp"
@@ -8,6 +9,8 @@
 #include <vector>
 #include <cstring>
 #include <string_view>
+#include <algorithm>
+#include <strings.h>
 #include <minIni.h>
 
 namespace npshop {
@@ -76,54 +79,55 @@ auto nro_parse_internal(fs::Fs* fs, const fs::FsPath& path, NroEntry& entry) ->
     R_SUCCEED();
 }
 
-// this function is recursive by 1 level deep
+// this function scans 1 level deep
 // if the nro is in switch/folder/folder2/app.nro it will NOT be found
 // switch/folder/app.nro for example will work fine.
-auto nro_scan_internal(fs::Fs* fs, const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir, bool root) -> Result {
-    // we don't need to scan for folders if we are not root
-    u32 dir_open_type = FsDirOpenMode_ReadFiles | FsDirOpenMode_NoFileSize;
-    if (root) {
-        dir_open_type |= FsDirOpenMode_ReadDirs;
-    }
-
-    fs::Dir d;
-    R_TRY(fs->OpenDirectory(path, dir_open_type, &d));
-
-    // we won't run out of memory here
-    std::vector<FsDirectoryEntry> entries;
-    R_TRY(d.ReadAll(entries));
-
-    for (const auto& e : entries) {
-        // skip hidden files / folders
-        if ('.' == e.name[0]) {
-            continue;
-        }
-
-        if (e.type == FsDirEntryType_Dir) {
-            // assert(!root && "dir should only be scanned on non-root!");
-            fs::FsPath fullpath;
-            std::snprintf(fullpath, sizeof(fullpath), "%s/%s/%s.nro", path.s, e.name, e.name);
+// the folders are listed in parallel, then the nros are parsed in the order they were listed.
+auto nro_scan_internal(fs::Fs* fs, const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir) -> Result {
+    fs::WalkConfig config{};
+    config.max_depth = 1;
+    config.ignore_errors = true;
+    // skip hidden folders
+    config.filter = [](const FsDirectoryEntry& e) {
+        return '.' != e.name[0];
+    };
+
+    std::vector<fs::WalkEntry> dirs;
+    R_TRY(fs::WalkDirs(fs, path, dirs, config));
+
+    for (const auto& dir : dirs) {
+        const auto root = dir.parent < 0;
+
+        if (!root) {
+            // fast path for detecting an nro in a folder, switch/folder/folder.nro
+            char name[sizeof(FsDirectoryEntry::name)];
+            std::snprintf(name, sizeof(name), "%s.nro", dir.name.s);
+
+            const auto it = std::ranges::find_if(dir.files, [&name](const FsDirectoryEntry& e) {
+                return !strcasecmp(e.name, name);
+            });
 
-            // fast path for detecting an nro in a folder
             NroEntry entry;
-            if (R_SUCCEEDED(nro_parse_internal(fs, fullpath, entry))) {
-                // log_write("NRO: fast path for: %s\n", fullpath);
+            if (it != dir.files.end() && R_SUCCEEDED(nro_parse_internal(fs, fs::AppendPath(dir.path, it->name), entry))) {
                 nros.emplace_back(entry);
-            } else {
-                // slow path...
-                std::snprintf(fullpath, sizeof(fullpath), "%s/%s", path.s, e.name);
-                nro_scan_internal(fs, fullpath, nros, nested, scan_all_dir, false);
+                continue;
+            }
+        }
+
+        for (const auto& e : dir.files) {
+            // skip hidden files
+            if ('.' == e.name[0] || !std::string_view{e.name}.ends_with(".nro")) {
+                continue;
             }
-        } else if (e.type == FsDirEntryType_File && std::string_view{e.name}.ends_with(".nro")) {
-            fs::FsPath fullpath;
-            std::snprintf(fullpath, sizeof(fullpath), "%s/%s", path.s, e.name);
+
+            const auto fullpath = fs::AppendPath(dir.path, e.name);
 
             NroEntry entry;
             if (R_SUCCEEDED(nro_parse_internal(fs, fullpath, entry))) {
                 nros.emplace_back(entry);
                 if (!root && !scan_all_dir) {
                     // log_write("NRO: slow path for: %s\n", fullpath);
-                    R_SUCCEED();
+                    break;
                 }
             } else {
                 log_write("error when trying to parse %s\n", fullpath.s);
@@ -134,9 +138,9 @@ auto nro_scan_internal(fs::Fs* fs, const fs::FsPath& path, std::vector<NroEntry>
     R_SUCCEED();
 }
 
-auto nro_scan_internal(const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir, bool root) -> Result {
+auto nro_scan_internal(const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir) -> Result {
     fs::FsNativeSd fs;
-    return nro_scan_internal(&fs, path, nros, nested, scan_all_dir, root);
+    return nro_scan_internal(&fs, path, nros, nested, scan_all_dir);
 }
 
 auto nro_get_icon_internal(fs::File* f, u64 size, u64 offset) -> std::vector<u8> {
@@ -194,7 +198,7 @@ auto nro_parse(const fs::FsPath& path, NroEntry& entry) -> Result {
 }
 
 auto nro_scan(const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir) -> Result {
-    return nro_scan_internal(path, nros, nested, scan_all_dir, true);
+    return nro_scan_internal(path, nros, nested, scan_all_dir);
 }
 
 auto nro_get_icon(const fs::FsPath& path, u64 size, u64 offset) -> std::vector<u8> {
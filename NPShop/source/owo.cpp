@@ -604,14 +604,7 @@ void write_nca_padding(BufHelper& buf) {
 }
 
 void nca_encrypt_header(nca::Header* header, std::span<const u8> key) {
-    Aes128XtsContext ctx{};
-    aes128XtsContextCreate(&ctx, key.data(), key.data() + 0x10, true);
-
-    u8 sector{};
-    for (u64 pos = 0; pos < 0xC00; pos += 0x200) {
-        aes128XtsContextResetSector(&ctx, sector++, true);
-        aes128XtsEncrypt(&ctx, (u8*)header + pos, (const u8*)header + pos, 0x200);
-    }
+    crypto::cryptoAes128Xts(header, header, key.data(), 0, 0x200, 0xC00, true);
 }
 
 void write_nca_section(nca::Header& nca_header, u8 index, u64 start, u64 end) {
@@ -3,10 +3,14 @@
 #include "defines.hpp"
 #include "app.hpp"
 #include "minizip_helper.hpp"
+#include "spsc_ring.hpp"
+#include "buffer_pool.hpp"
+#include "transfer_stats.hpp"
 
 #include <vector>
 #include <algorithm>
 #include <cstring>
+#include <cstdio>
 #include <atomic>
 #include <minizip/unzip.h>
 #include <minizip/zip.h>
@@ -19,60 +23,153 @@ constexpr u64 SMALL_BUFFER_SIZE = 1024 * 512;
 // used for everything else.
 constexpr u64 NORMAL_BUFFER_SIZE = 1024*1024*4;
 
-struct ThreadBuffer {
-    ThreadBuffer() {
-        buf.reserve(NORMAL_BUFFER_SIZE);
-    }
+// the throttle starts at the fixed 2ms sleep that was used before.
+constexpr u64 THROTTLE_START_SLEEP_NS = 2e+6;
+constexpr u64 THROTTLE_MIN_SLEEP_NS = 2.5e+5;
+constexpr u64 THROTTLE_MAX_SLEEP_NS = 8e+6;
+// io this much slower than the fastest seen means that the sd card is busy.
+constexpr double THROTTLE_BUSY_RATIO = 1.5;
+// small io is mostly fixed overhead, so it isn't used for measuring.
+constexpr s64 THROTTLE_MIN_SAMPLE_SIZE = 1024 * 64;
+
+// number of chunks measured before tuning.
+constexpr u32 TUNE_WINDOW_CHUNKS = 8;
+// throughput must change by this much to count as better / worse.
+constexpr double TUNE_THRESHOLD = 0.05;
+// the buffers in flight are limited to this many times the initial buffer size.
+constexpr u64 TUNE_MEMORY_BUDGET = 6;
+constexpr u32 TUNE_MAX_DEPTH = 4;
+// default depth, also the depth the tuner won't shrink below.
+constexpr u32 TUNE_DEFAULT_DEPTH = 2;
+
+// tunes the chunk size and queue depth of the read thread whilst transferring.
+// the read thread is blocked whilst the write thread is slower, so the bytes it
+// reads over a window of chunks is the throughput of the whole transfer.
+// the chunk size is doubled / halved whilst the throughput improves, the queue depth
+// is raised if both threads had to wait on each other (bursty io) and lowered
+// if the write thread never ran out of data.
+struct Tuner {
+    Tuner(u64 chunk_size, bool enabled)
+    : m_enabled{enabled}
+    , m_chunk_size{chunk_size}
+    , m_min_chunk_size{std::max<u64>(chunk_size / 4, 1024 * 64)}
+    // the small buffer is used where larger io isn't safe, so it's never grown.
+    , m_max_chunk_size{chunk_size <= SMALL_BUFFER_SIZE ? chunk_size : chunk_size * 2}
+    , m_memory_budget{chunk_size * TUNE_MEMORY_BUDGET}
+    , m_best_chunk_size{chunk_size} {
+        m_window_start = armGetSystemTick();
+    }
+
+    auto GetChunkSize() const -> u64 {
+        return m_chunk_size;
+    }
+
+    template<u32 Size>
+    void Update(u64 bytes, SpscRing<Size>& ring) {
+        if (!m_enabled) {
+            return;
+        }
 
-    std::vector<u8> buf;
-    s64 off;
-};
+        m_window_bytes += bytes;
+        if (++m_window_chunks < TUNE_WINDOW_CHUNKS) {
+            return;
+        }
 
-template<std::size_t Size>
-struct RingBuf {
-private:
-    ThreadBuffer buf[Size]{};
-    unsigned r_index{};
-    unsigned w_index{};
+        const auto now = armGetSystemTick();
+        const auto elapsed_ns = armTicksToNs(now - m_window_start);
+        const auto throughput = double(m_window_bytes) / double(std::max<u64>(elapsed_ns, 1));
+        m_window_start = now;
+        m_window_bytes = 0;
+        m_window_chunks = 0;
 
-    static_assert((sizeof(RingBuf::buf) & (sizeof(RingBuf::buf) - 1)) == 0, "Must be power of 2!");
+        TuneChunkSize(throughput);
+        TuneDepth(ring);
 
-public:
-    void ringbuf_reset() {
-        this->r_index = this->w_index;
+        log_write("[TUNE] speed: %.2f MiB/s chunk: %zu KiB depth: %u\n", throughput * 1e+9 / 1024.0 / 1024.0, m_chunk_size / 1024, ring.GetDepth());
     }
 
-    unsigned ringbuf_capacity() const {
-        return sizeof(this->buf) / sizeof(this->buf[0]);
-    }
+private:
+    void TuneChunkSize(double throughput) {
+        if (m_settled) {
+            return;
+        }
 
-    unsigned ringbuf_size() const {
-        return (this->w_index - this->r_index) % (ringbuf_capacity() * 2U);
+        if (throughput >= m_best_throughput * (1.0 + TUNE_THRESHOLD)) {
+            // keep going in the same direction.
+            m_best_throughput = throughput;
+            m_best_chunk_size = m_chunk_size;
+            if (!Step()) {
+                m_settled = true;
+            }
+        } else {
+            // worse or no different, go back to the best size and try the other direction once.
+            m_chunk_size = m_best_chunk_size;
+            if (m_reversed) {
+                m_settled = true;
+            } else {
+                m_reversed = true;
+                m_grow = !m_grow;
+                if (!Step()) {
+                    m_settled = true;
+                }
+            }
+        }
     }
 
-    unsigned ringbuf_free() const {
-        return ringbuf_capacity() - ringbuf_size();
-    }
+    template<u32 Size>
+    void TuneDepth(SpscRing<Size>& ring) {
+        const auto push_waits = ring.GetPushWaits() - m_push_waits;
+        const auto pop_waits = ring.GetPopWaits() - m_pop_waits;
+        m_push_waits = ring.GetPushWaits();
+        m_pop_waits = ring.GetPopWaits();
 
-    void ringbuf_push(std::vector<u8>& buf_in, s64 off_in) {
-        auto& value = this->buf[this->w_index % ringbuf_capacity()];
-        value.off = off_in;
-        std::swap(value.buf, buf_in);
+        // the read / write threads also hold a buffer each.
+        const auto max_depth = std::clamp<u64>(m_memory_budget / m_chunk_size, 3, TUNE_MAX_DEPTH + 2) - 2;
+
+        auto depth = ring.GetDepth();
+        if (push_waits && pop_waits) {
+            depth++;
+        } else if (!pop_waits && depth > TUNE_DEFAULT_DEPTH) {
+            depth--;
+        }
 
-        this->w_index = (this->w_index + 1U) % (ringbuf_capacity() * 2U);
+        ring.SetDepth(std::min<u32>(depth, max_depth));
     }
 
-    void ringbuf_pop(std::vector<u8>& buf_out, s64& off_out) {
-        auto& value = this->buf[this->r_index % ringbuf_capacity()];
-        off_out = value.off;
-        std::swap(value.buf, buf_out);
+    auto Step() -> bool {
+        const auto size = m_grow ? m_chunk_size * 2 : m_chunk_size / 2;
+        if (size < m_min_chunk_size || size > m_max_chunk_size) {
+            return false;
+        }
 
-        this->r_index = (this->r_index + 1U) % (ringbuf_capacity() * 2U);
+        m_chunk_size = size;
+        return true;
     }
+
+private:
+    const bool m_enabled;
+    u64 m_chunk_size;
+    const u64 m_min_chunk_size;
+    const u64 m_max_chunk_size;
+    const u64 m_memory_budget;
+
+    u64 m_window_start{};
+    u64 m_window_bytes{};
+    u32 m_window_chunks{};
+
+    double m_best_throughput{};
+    u64 m_best_chunk_size;
+    bool m_grow{true};
+    bool m_reversed{};
+    bool m_settled{};
+
+    u32 m_push_waits{};
+    u32 m_pop_waits{};
 };
 
 struct ThreadData {
     ThreadData(ui::ProgressBox* _pbox, s64 size, ReadCallback _rfunc, WriteCallback _wfunc, u64 buffer_size);
+    ~ThreadData();
 
     auto GetResults() volatile -> Result;
     void WakeAllThreads();
@@ -89,6 +186,10 @@ struct ThreadData {
         return write_size;
     }
 
+    auto GetStats() -> TransferStats& {
+        return stats;
+    }
+
     auto GetDoneEvent() {
         return &m_uevent_done;
     }
@@ -135,24 +236,25 @@ private:
     const WriteCallback wfunc;
 
     // these need to be created
-    Mutex mutex{};
-    Mutex pull_mutex{};
-
-    CondVar can_read{};
-    CondVar can_write{};
-    CondVar can_pull{};
-    CondVar can_pull_write{};
-
     UEvent m_uevent_done{};
     UEvent m_uevent_progres{};
 
-    RingBuf<2> write_buffers{};
+    // buffers are swapped between the threads, the rings are filled from
+    // the pool on creation.
+    BufferPool buffer_pool;
+    SpscRing<TUNE_MAX_DEPTH> write_buffers{};
+    SpscRing<1> pull_buffers{};
+    // buffer currently being pulled from, only accessed by the pull thread.
     std::vector<u8> pull_buffer{};
     s64 pull_buffer_offset{};
 
-    const u64 read_buffer_size;
     const s64 write_size;
 
+    // only accessed by the read thread.
+    Tuner tuner;
+
+    TransferStats stats{"transfer"};
+
     // these are shared between threads
     std::atomic<s64> read_offset{};
     std::atomic<s64> write_offset{};
@@ -169,20 +271,22 @@ ThreadData::ThreadData(ui::ProgressBox* _pbox, s64 size, ReadCallback _rfunc, Wr
 : pbox{_pbox}
 , rfunc{_rfunc}
 , wfunc{_wfunc}
-, read_buffer_size{buffer_size}
-, write_size{size} {
-    mutexInit(std::addressof(mutex));
-    mutexInit(std::addressof(pull_mutex));
-
-    condvarInit(std::addressof(can_read));
-    condvarInit(std::addressof(can_write));
-    condvarInit(std::addressof(can_pull));
-    condvarInit(std::addressof(can_pull_write));
-
+, buffer_pool{"transfer", buffer_size}
+, write_size{size}
+, tuner{buffer_size, App::GetTransferAdaptiveEnable()} {
+    write_buffers.SetDepth(TUNE_DEFAULT_DEPTH);
+    write_buffers.Reserve(buffer_pool);
+    pull_buffers.Reserve(buffer_pool);
     ueventCreate(&m_uevent_done, false);
     ueventCreate(&m_uevent_progres, true);
 }
 
+ThreadData::~ThreadData() {
+    write_buffers.Release(buffer_pool);
+    pull_buffers.Release(buffer_pool);
+    buffer_pool.Release(pull_buffer);
+}
+
 auto ThreadData::GetResults() volatile -> Result {
     R_TRY(pbox->ShouldExitResult());
     R_TRY(read_result.load());
@@ -192,89 +296,77 @@ auto ThreadData::GetResults() volatile -> Result {
 }
 
 void ThreadData::WakeAllThreads() {
-    condvarWakeAll(std::addressof(can_read));
-    condvarWakeAll(std::addressof(can_write));
-    condvarWakeAll(std::addressof(can_pull));
-    condvarWakeAll(std::addressof(can_pull_write));
-
-    mutexUnlock(std::addressof(mutex));
-    mutexUnlock(std::addressof(pull_mutex));
+    write_buffers.Close();
+    pull_buffers.Close();
 }
 
 Result ThreadData::SetWriteBuf(std::vector<u8>& buf, s64 size) {
     buf.resize(size);
+    R_TRY(GetResults());
 
-    mutexLock(std::addressof(mutex));
-    if (!write_buffers.ringbuf_free()) {
-        if (!write_running) {
-            R_SUCCEED();
-        }
-        R_TRY(condvarWait(std::addressof(can_read), std::addressof(mutex)));
+    // fails if the write thread has exited, GetResults() will report why.
+    bool pushed;
+    {
+        ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Read).full_ns};
+        pushed = write_buffers.Push(buf, 0);
     }
 
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(mutex)));
     R_TRY(GetResults());
-    write_buffers.ringbuf_push(buf, 0);
-    return condvarWakeOne(std::addressof(can_write));
+    // the write thread exited without an error, so the data can't be written.
+    R_UNLESS(pushed, Result_TransferCancelled);
+    buffer_pool.AcquireIfEmpty(buf);
+    R_SUCCEED();
 }
 
 Result ThreadData::GetWriteBuf(std::vector<u8>& buf_out, s64& off_out) {
-    mutexLock(std::addressof(mutex));
-    if (!write_buffers.ringbuf_size()) {
-        if (!read_running) {
-            buf_out.resize(0);
-            R_SUCCEED();
-        }
-        R_TRY(condvarWait(std::addressof(can_write), std::addressof(mutex)));
+    ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Write).empty_ns};
+    // fails once the read thread has exited and all data has been popped.
+    if (!write_buffers.Pop(buf_out, off_out)) {
+        buf_out.resize(0);
     }
-
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(mutex)));
-    R_TRY(GetResults());
-    write_buffers.ringbuf_pop(buf_out, off_out);
-    return condvarWakeOne(std::addressof(can_read));
+    return GetResults();
 }
 
 Result ThreadData::SetPullBuf(std::vector<u8>& buf, s64 size) {
     buf.resize(size);
+    R_TRY(GetResults());
 
-    mutexLock(std::addressof(pull_mutex));
-    if (!pull_buffer.empty()) {
-        R_TRY(condvarWait(std::addressof(can_pull_write), std::addressof(pull_mutex)));
+    bool pushed;
+    {
+        ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Write).full_ns};
+        pushed = pull_buffers.Push(buf, 0);
     }
 
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(pull_mutex)));
     R_TRY(GetResults());
-
-    pull_buffer.swap(buf);
-    return condvarWakeOne(std::addressof(can_pull));
+    // the pull thread stopped pulling without an error.
+    R_UNLESS(pushed, Result_TransferCancelled);
+    R_SUCCEED();
 }
 
 Result ThreadData::GetPullBuf(void* data, s64 size, u64* bytes_read) {
-    mutexLock(std::addressof(pull_mutex));
-    if (pull_buffer.empty()) {
-        R_TRY(condvarWait(std::addressof(can_pull), std::addressof(pull_mutex)));
+    // fetch the next buffer once the current one has been consumed.
+    // this frees the slot, so the write thread can push the next buffer whilst this one is pulled.
+    if (pull_buffer_offset == pull_buffer.size()) {
+        s64 dummy_off;
+        pull_buffer_offset = 0;
+        if (!pull_buffers.Pop(pull_buffer, dummy_off)) {
+            pull_buffer.clear();
+        }
     }
 
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(pull_mutex)));
     R_TRY(GetResults());
 
     *bytes_read = size = std::min<s64>(size, pull_buffer.size() - pull_buffer_offset);
     std::memcpy(data, pull_buffer.data() + pull_buffer_offset, size);
     pull_buffer_offset += size;
-
-    if (pull_buffer_offset == pull_buffer.size()) {
-        pull_buffer_offset = 0;
-        pull_buffer.clear();
-        return condvarWakeOne(std::addressof(can_pull_write));
-    } else {
-        R_SUCCEED();
-    }
+    R_SUCCEED();
 }
 
 Result ThreadData::Read(void* buf, s64 size, u64* bytes_read) {
     size = std::min<s64>(size, write_size - read_offset);
     const auto rc = rfunc(buf, read_offset, size, bytes_read);
     read_offset += *bytes_read;
+    stats.GetStage(TransferStats::Stage_Read).bytes += *bytes_read;
     return rc;
 }
 
@@ -284,15 +376,22 @@ Result ThreadData::Pull(void* data, s64 size, u64* bytes_read) {
 
 // read thread reads all data from the source
 Result ThreadData::readFuncInternal() {
-    ON_SCOPE_EXIT( read_running = false; );
+    ON_SCOPE_EXIT( read_running = false; write_buffers.Close(); );
 
     // the main buffer which data is read into.
     std::vector<u8> buf;
-    buf.reserve(this->read_buffer_size);
+    buffer_pool.Acquire(buf);
+    ON_SCOPE_EXIT(buffer_pool.Release(buf));
 
     while (this->read_offset < this->write_size && R_SUCCEEDED(this->GetResults())) {
+        ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Read).running_ns};
         // read more data
-        s64 read_size = this->read_buffer_size;
+        s64 read_size = this->tuner.GetChunkSize();
+
+        // drop buffers left over from a larger chunk size.
+        if (buf.capacity() > (u64)read_size) {
+            std::vector<u8>{}.swap(buf);
+        }
 
         u64 bytes_read{};
         buf.resize(read_size);
@@ -303,6 +402,7 @@ Result ThreadData::readFuncInternal() {
 
         auto buf_size = bytes_read;
         R_TRY(this->SetWriteBuf(buf, buf_size));
+        this->tuner.Update(buf_size, write_buffers);
     }
 
     log_write("finished read thread success!\n");
@@ -311,12 +411,14 @@ Result ThreadData::readFuncInternal() {
 
 // write thread writes data to wfunc.
 Result ThreadData::writeFuncInternal() {
-    ON_SCOPE_EXIT( write_running = false; );
+    ON_SCOPE_EXIT( write_running = false; write_buffers.Close(); pull_buffers.Close(); );
 
+    // starts empty, filled by swapping with the read thread.
     std::vector<u8> buf;
-    buf.reserve(this->read_buffer_size);
+    ON_SCOPE_EXIT(buffer_pool.Release(buf));
 
     while (this->write_offset < this->write_size && R_SUCCEEDED(this->GetResults())) {
+        ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Write).running_ns};
         s64 dummy_off;
         R_TRY(this->GetWriteBuf(buf, dummy_off));
         const auto size = buf.size();
@@ -332,6 +434,7 @@ Result ThreadData::writeFuncInternal() {
         }
 
         this->write_offset += size;
+        stats.GetStage(TransferStats::Stage_Write).bytes += size;
         ueventSignal(GetProgressEvent());
     }
 
@@ -351,6 +454,37 @@ void writeFunc(void* d) {
     log_write("write thread returned now\n");
 }
 
+} // namespace
+
+Throttle::Throttle() : Throttle{App::IsFileBaseEmummc()} {
+}
+
+Throttle::Throttle(bool enabled) : m_enabled{enabled}, m_sleep_ns{THROTTLE_START_SLEEP_NS} {
+}
+
+void Throttle::Update(u64 elapsed_ns, s64 size) {
+    if (size >= THROTTLE_MIN_SAMPLE_SIZE) {
+        const auto ns_per_kib = double(elapsed_ns) / (double(size) / 1024.0);
+
+        // the best slowly decays so that it follows the sd card over time.
+        if (!m_best_ns_per_kib || ns_per_kib < m_best_ns_per_kib) {
+            m_best_ns_per_kib = ns_per_kib;
+        } else {
+            m_best_ns_per_kib *= 1.001;
+        }
+
+        if (ns_per_kib > m_best_ns_per_kib * THROTTLE_BUSY_RATIO) {
+            m_sleep_ns = std::min(m_sleep_ns * 2, THROTTLE_MAX_SLEEP_NS);
+        } else {
+            m_sleep_ns = std::max(m_sleep_ns * 3 / 4, THROTTLE_MIN_SLEEP_NS);
+        }
+    }
+
+    svcSleepThread(m_sleep_ns);
+}
+
+namespace {
+
 auto GetAlternateCore(int id) {
     return id == 1 ? 2 : 1;
 }
@@ -404,6 +538,16 @@ Result TransferInternal(ui::ProgressBox* pbox, s64 size, ReadCallback rfunc, Wri
 
         ThreadData t_data{pbox, size, rfunc, wfunc, buffer_size};
 
+        // restored afterwards, in case this transfer is part of a larger one.
+        const auto old_stats = pbox->GetStats();
+        pbox->SetStats(std::addressof(t_data.GetStats()));
+        ON_SCOPE_EXIT(
+            pbox->SetStats(old_stats);
+            if (App::GetTransferStatsEnable()) {
+                t_data.GetStats().Save();
+            }
+        );
+
         Thread t_read{};
         R_TRY(threadCreate(&t_read, readFunc, std::addressof(t_data), nullptr, 1024*256, 0x3B, READ_THREAD_CORE));
         ON_SCOPE_EXIT(threadClose(&t_read));
@@ -495,6 +639,203 @@ Result TransferPull(ui::ProgressBox* pbox, s64 size, ReadCallback rfunc, StartCa
     return TransferInternal(pbox, size, rfunc, nullptr, sfunc, mode);
 }
 
+Result TransferCopyBatch(ui::ProgressBox* pbox, fs::Fs* fs_src, fs::Fs* fs_dst, std::span<const CopyEntry> entries, CopyDoneCallback on_done, Mode mode) {
+    struct Job {
+        // start of the file in the combined stream.
+        s64 offset{};
+        s64 size{};
+        fs::File src{};
+        fs::File dst{};
+        // set by the read thread.
+        bool src_opened{};
+        // set by the write thread.
+        bool dst_opened{};
+    };
+
+    // the files are treated as one stream, so the read / write threads are only created once.
+    // the read thread opens the next file whilst the write thread is still writing the previous one.
+    // each fs is only accessed from a single thread (src on the read thread, dst on the
+    // write thread), as stdio fs are not safe to access from multiple threads.
+    // the src / dst of a job are only accessed by their own thread, so no locking is needed.
+    std::vector<Job> jobs(entries.size());
+    s64 total_size{};
+    for (u64 i = 0; i < entries.size(); i++) {
+        jobs[i].offset = total_size;
+        jobs[i].size = entries[i].size;
+
+        // stdio folder listings don't include the size.
+        if (!fs_src->IsNative()) {
+            R_TRY(pbox->ShouldExitResult());
+            FsTimeStampRaw ts;
+            R_TRY(fs_src->FileGetSizeAndTimestamp(entries[i].src, &ts, &jobs[i].size));
+        }
+
+        total_size += jobs[i].size;
+    }
+
+    const auto is_both_native = fs_src->IsNative() && fs_dst->IsNative();
+    // read and write happen on different threads, so each gets a throttle.
+    Throttle read_throttle{is_both_native && App::IsFileBaseEmummc()};
+    Throttle write_throttle{is_both_native && App::IsFileBaseEmummc()};
+
+    const auto open_src = [&](u64 i) -> Result {
+        auto& job = jobs[i];
+        const auto& e = entries[i];
+        job.src_opened = true;
+
+        R_TRY(fs_src->OpenFile(e.src, FsOpenMode_Read, &job.src));
+
+        s64 size;
+        R_TRY(job.src.GetSize(&size));
+        if (size != job.size) {
+            log_write("[COPY] file size changed: %s %zd vs %zd\n", e.src.s, size, job.size);
+            R_THROW(Result_FsFileSizeChanged);
+        }
+
+        if (!size) {
+            job.src.Close();
+        }
+
+        R_SUCCEED();
+    };
+
+    const auto open_dst = [&](u64 i) -> Result {
+        auto& job = jobs[i];
+        const auto& e = entries[i];
+        job.dst_opened = true;
+
+        // this can fail if it already exists so we ignore the result.
+        fs_dst->CreateFile(e.dst, job.size, 0);
+        R_TRY(fs_dst->OpenFile(e.dst, FsOpenMode_Write, &job.dst));
+        R_TRY(job.dst.SetSize(job.size));
+
+        if (!job.size) {
+            job.dst.Close();
+        }
+
+        R_SUCCEED();
+    };
+
+    const auto start = armGetSystemTick();
+    std::atomic<u64> files_done{};
+    u64 last_title_update{};
+
+    const auto update_title = [&](bool force) {
+        const auto now = armGetSystemTick();
+        const auto elapsed_ns = armTicksToNs(now - start);
+        if (!force && armTicksToNs(now - last_title_update) < 250e+6) {
+            return;
+        }
+
+        last_title_update = now;
+        const auto files_per_second = double(files_done) / (double(std::max<u64>(elapsed_ns, 1)) / 1e+9);
+
+        char title[128];
+        std::snprintf(title, sizeof(title), "%zu / %zu files (%.1f files/s)", files_done.load(), entries.size(), files_per_second);
+        pbox->SetTitle(title);
+    };
+
+    // only accessed by the read thread.
+    u64 r_index{};
+    // only accessed by the write thread.
+    u64 w_index{};
+
+    Result rc{};
+    if (total_size) {
+        rc = TransferInternal(pbox, total_size,
+            [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+                // skip to the file that contains off, checking empty files along the way.
+                while (off >= jobs[r_index].offset + jobs[r_index].size) {
+                    if (!jobs[r_index].src_opened) {
+                        R_TRY(open_src(r_index));
+                    }
+                    r_index++;
+                }
+
+                auto& job = jobs[r_index];
+                if (!job.src_opened) {
+                    R_TRY(open_src(r_index));
+                }
+
+                // don't read past the end of the file, so each buffer only contains a single file.
+                const auto file_off = off - job.offset;
+                size = std::min<s64>(size, job.size - file_off);
+
+                R_TRY(read_throttle.Run(size, [&]() -> Result {
+                    return job.src.Read(file_off, data, size, 0, bytes_read);
+                }));
+
+                if (file_off + (s64)*bytes_read >= job.size) {
+                    job.src.Close();
+                }
+
+                R_SUCCEED();
+            },
+            [&](const void* data, s64 off, s64 size) -> Result {
+                // skip to the file that contains off, creating empty files along the way.
+                while (off >= jobs[w_index].offset + jobs[w_index].size) {
+                    if (!jobs[w_index].dst_opened) {
+                        R_TRY(open_dst(w_index));
+                    }
+                    w_index++;
+                    files_done++;
+                }
+
+                auto& job = jobs[w_index];
+                if (!job.dst_opened) {
+                    R_TRY(open_dst(w_index));
+                }
+
+                const auto file_off = off - job.offset;
+
+                R_TRY(write_throttle.Run(size, [&]() -> Result {
+                    return job.dst.Write(file_off, data, size, 0);
+                }));
+
+                if (file_off + size >= job.size) {
+                    job.dst.Close();
+                    w_index++;
+                    files_done++;
+                    update_title(false);
+                }
+
+                R_SUCCEED();
+            }, nullptr, mode
+        );
+    }
+
+    // create the empty files at the end, which the threads never reached.
+    // the threads have exited at this point, so both fs can be accessed here.
+    if (R_SUCCEEDED(rc)) {
+        for (u64 i = 0; i < entries.size(); i++) {
+            if (!jobs[i].src_opened && R_FAILED(rc = open_src(i))) {
+                break;
+            }
+            if (!jobs[i].dst_opened && R_FAILED(rc = open_dst(i))) {
+                break;
+            }
+        }
+
+        if (R_SUCCEEDED(rc)) {
+            files_done = entries.size();
+        }
+    }
+
+    update_title(true);
+    log_write("[COPY] copied %zu / %zu files %zd bytes in %.2fs\n", files_done.load(), entries.size(), total_size, double(armTicksToNs(armGetSystemTick() - start)) / 1e+9);
+
+    // this is done after the threads have exited, so that the src fs isn't
+    // accessed from multiple threads, and only for the files that were fully copied.
+    if (on_done) {
+        for (u64 i = 0; i < files_done; i++) {
+            pbox->Yield();
+            R_TRY(on_done(entries[i]));
+        }
+    }
+
+    return rc;
+}
+
 Result TransferUnzip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& path, s64 size, u32 crc32, Mode mode) {
     Result rc;
     if (R_FAILED(rc = fs->CreateDirectoryRecursivelyWithPath(path)) && rc != FsError_PathAlreadyExists) {
@@ -0,0 +1,542 @@
+#include "thumb_cache.hpp"
+#include "app.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+namespace npshop::thumb {
+namespace {
+
+constexpr fs::FsPath CACHE_PATH{"/switch/npshop/cache/thumbs"};
+constexpr u32 INDEX_MAGIC = 0x424D4854; // "THMB"
+constexpr u32 INDEX_VERSION = 1;
+constexpr u64 PAGE_BYTES = PAGE_SIZE * PAGE_SIZE * 4;
+// pages are written once no thumbnails have been set for this long,
+// so that a page isn't written again for every thumbnail whilst scrolling.
+constexpr u64 SAVE_DELAY_NS = 2e+9;
+
+struct IndexHeader {
+    u32 magic;
+    u32 version;
+    u32 thumb_size;
+    u32 page_size;
+};
+
+struct IndexRecord {
+    u64 key;
+    u64 stamp;
+    u32 slot;
+    u32 reserved;
+};
+
+// written to a temp file first so that the old file is kept if writing fails.
+auto WriteFile(const fs::FsPath& path, const std::vector<u8>& data) -> bool {
+    fs::FsNativeSd fs;
+    const auto temp_path = path + ".temp";
+    fs.DeleteFile(temp_path);
+    if (R_FAILED(fs.write_entire_file(temp_path, data))) {
+        fs.DeleteFile(temp_path);
+        return false;
+    }
+
+    fs.DeleteFile(path);
+    return R_SUCCEEDED(fs.RenameFile(temp_path, path));
+}
+
+// 64-bit fnv-1a.
+auto Fnv1a(const u8* data, size_t size) -> u64 {
+    u64 hash = 0xCBF29CE484222325;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3;
+    }
+    return hash;
+}
+
+} // namespace
+
+Cache::Cache(const char* name, u32 max_pages) : m_max_pages{max_pages} {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_work);
+    std::snprintf(m_path, sizeof(m_path), "%s/%s", CACHE_PATH.s, name);
+
+    LoadIndex(name);
+
+    m_running = true;
+    if (R_FAILED(threadCreate(&m_thread, ThreadFunc, this, nullptr, 1024*64, PRIO_PREEMPTIVE, -2))) {
+        log_write("[THUMB] failed to create save thread\n");
+    } else if (R_FAILED(threadStart(&m_thread))) {
+        log_write("[THUMB] failed to start save thread\n");
+        threadClose(&m_thread);
+    } else {
+        m_thread_created = true;
+    }
+}
+
+Cache::~Cache() {
+    // the thread stores and saves anything left before exiting.
+    if (m_thread_created) {
+        {
+            SCOPED_MUTEX(&m_mutex);
+            m_running = false;
+            condvarWakeAll(&m_can_work);
+        }
+
+        threadWaitForExit(&m_thread);
+        threadClose(&m_thread);
+    } else {
+        Save();
+    }
+
+    auto vg = App::GetVg();
+    for (auto& page : m_pages) {
+        if (page.image) {
+            nvgDeleteImage(vg, page.image);
+        }
+    }
+}
+
+auto Cache::Get(u64 key, u64 stamp, Thumb& out) -> bool {
+    SCOPED_MUTEX(&m_mutex);
+
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end() || it->second.stamp != stamp || it->second.pending) {
+        return false;
+    }
+
+    auto& e = it->second;
+    e.used = true;
+    const auto index = e.slot / THUMBS_PER_PAGE;
+    auto& page = m_pages[index];
+
+    if (!page.image) {
+        // the page is read by the thread, it's uploaded once it's ready.
+        if (page.data.empty()) {
+            if (!page.requested) {
+                page.requested = true;
+                m_page_requests.emplace_back(index);
+                condvarWakeOne(&m_can_work);
+            }
+            return false;
+        }
+
+        TimeStamp ts;
+        page.image = nvgCreateImageRGBA(App::GetVg(), PAGE_SIZE, PAGE_SIZE, 0, page.data.data());
+        if (!page.image) {
+            return false;
+        }
+
+        // everything in the page is now uploaded.
+        for (auto& [k, other] : m_entries) {
+            if (other.slot / THUMBS_PER_PAGE == index) {
+                other.pending = false;
+            }
+        }
+
+        // the page is read again if a thumbnail has to be written to it.
+        if (!page.dirty) {
+            page.data = {};
+        }
+
+        log_write("[THUMB] uploaded page: %u time taken: %.2fs %zums\n", index, ts.GetSecondsD(), ts.GetMs());
+    }
+
+    const auto slot = e.slot % THUMBS_PER_PAGE;
+    const auto x = (slot % THUMBS_PER_ROW) * THUMB_SIZE;
+    const auto y = (slot / THUMBS_PER_ROW) * THUMB_SIZE;
+
+    // inset by half a pixel so that the neighbouring thumbnails don't bleed in when filtered.
+    out.image = page.image;
+    out.src = Vec4(x + 0.5f, y + 0.5f, THUMB_SIZE - 1.f, THUMB_SIZE - 1.f);
+    return true;
+}
+
+auto Cache::Contains(u64 key, u64 stamp) -> bool {
+    SCOPED_MUTEX(&m_mutex);
+
+    const auto it = m_entries.find(key);
+    return it != m_entries.end() && it->second.stamp == stamp && !it->second.pending;
+}
+
+void Cache::Set(u64 key, u64 stamp, ImageResult image) {
+    if (image.data.empty()) {
+        return;
+    }
+
+    Job job{key, stamp, std::move(image)};
+    if (!m_thread_created) {
+        Store(job);
+        return;
+    }
+
+    SCOPED_MUTEX(&m_mutex);
+    m_jobs.emplace_back(std::move(job));
+    condvarWakeOne(&m_can_work);
+}
+
+void Cache::Store(const Job& job) {
+    const auto thumb = Resize(job.image);
+    if (thumb.w != THUMB_SIZE || thumb.h != THUMB_SIZE || thumb.data.size() != THUMB_SIZE * THUMB_SIZE * 4) {
+        return;
+    }
+
+    // the page is read without the lock held, as it's a large read that would
+    // otherwise block Get() on the main thread.
+    // the slot is found again once the page is loaded, as it may have changed.
+    std::optional<u32> read_index;
+    std::vector<u8> read_data;
+    for (;;) {
+        if (read_index) {
+            read_data = ReadPage(*read_index);
+        }
+
+        SCOPED_MUTEX(&m_mutex);
+        if (read_index) {
+            SetPageData(*read_index, std::move(read_data));
+            read_index.reset();
+        }
+
+        const auto slot = FindSlot(job.key);
+        if (!slot) {
+            log_write("[THUMB] cache is full, not adding: %016lX\n", job.key);
+            return;
+        }
+
+        // the page is created again if it's missing.
+        const auto index = *slot / THUMBS_PER_PAGE;
+        if (index >= m_pages.size() || m_pages[index].data.empty()) {
+            read_index = index;
+            continue;
+        }
+
+        // take the free slot, or replace the unused entry.
+        if (!m_entries.contains(job.key)) {
+            if (*slot == m_next_slot) {
+                m_next_slot++;
+            } else {
+                std::erase_if(m_entries, [slot](const auto& pair) {
+                    return pair.second.slot == *slot;
+                });
+            }
+        }
+
+        auto& page = m_pages[index];
+        const auto x = (*slot % THUMBS_PER_PAGE % THUMBS_PER_ROW) * THUMB_SIZE;
+        const auto y = (*slot % THUMBS_PER_PAGE / THUMBS_PER_ROW) * THUMB_SIZE;
+        for (int row = 0; row < THUMB_SIZE; row++) {
+            std::memcpy(page.data.data() + ((y + row) * PAGE_SIZE + x) * 4, thumb.data.data() + row * THUMB_SIZE * 4, THUMB_SIZE * 4);
+        }
+
+        page.dirty = true;
+        m_entries.insert_or_assign(job.key, Entry{job.stamp, *slot, ++m_seq, true, true, false});
+        m_index_dirty = true;
+        m_last_set = armGetSystemTick();
+        return;
+    }
+}
+
+void Cache::Save() {
+    {
+        SCOPED_MUTEX(&m_mutex);
+        if (!m_index_dirty) {
+            return;
+        }
+
+        m_index_dirty = false;
+    }
+
+    TimeStamp ts;
+    fs::FsNativeSd().CreateDirectoryRecursively(m_path);
+
+    for (u32 i = 0;; i++) {
+        // copied so that thumbnails can still be set whilst the page is written.
+        std::vector<u8> data;
+        u32 seq{};
+        {
+            SCOPED_MUTEX(&m_mutex);
+            if (i >= m_pages.size()) {
+                break;
+            }
+
+            auto& page = m_pages[i];
+            if (!page.dirty) {
+                continue;
+            }
+
+            data = page.data;
+            seq = m_seq;
+            page.dirty = false;
+        }
+
+        // the entries of the page aren't added to the index if it can't be written,
+        // as they would point to an old or missing page.
+        if (!WriteFile(GetPagePath(i), data)) {
+            log_write("[THUMB] failed to write page: %u\n", i);
+            continue;
+        }
+
+        SCOPED_MUTEX(&m_mutex);
+        for (auto& [key, e] : m_entries) {
+            if (e.slot / THUMBS_PER_PAGE == i && e.seq <= seq) {
+                e.saved = true;
+            }
+        }
+
+        auto& page = m_pages[i];
+        if (page.image && !page.dirty) {
+            page.data = {};
+        }
+    }
+
+    std::vector<u8> data;
+    {
+        SCOPED_MUTEX(&m_mutex);
+        data.resize(sizeof(IndexHeader) + m_entries.size() * sizeof(IndexRecord));
+        const IndexHeader header{INDEX_MAGIC, INDEX_VERSION, THUMB_SIZE, PAGE_SIZE};
+        std::memcpy(data.data(), &header, sizeof(header));
+
+        auto out = data.data() + sizeof(header);
+        for (const auto& [key, e] : m_entries) {
+            if (e.saved) {
+                const IndexRecord record{key, e.stamp, e.slot, 0};
+                std::memcpy(out, &record, sizeof(record));
+                out += sizeof(record);
+            }
+        }
+
+        data.resize(out - data.data());
+    }
+
+    if (!WriteFile(fs::AppendPath(m_path, "index.bin"), data)) {
+        log_write("[THUMB] failed to write index: %s\n", m_path.s);
+    }
+
+    log_write("[THUMB] saved cache: %s entries: %zu time taken: %.2fs %zums\n", m_path.s, (data.size() - sizeof(IndexHeader)) / sizeof(IndexRecord), ts.GetSecondsD(), ts.GetMs());
+}
+
+// reads a page that was requested by Get(), so that it can be uploaded.
+void Cache::LoadRequestedPage(u32 index) {
+    {
+        SCOPED_MUTEX(&m_mutex);
+        if (!m_pages[index].data.empty()) {
+            m_pages[index].requested = false;
+            return;
+        }
+    }
+
+    auto data = ReadPage(index);
+
+    SCOPED_MUTEX(&m_mutex);
+    SetPageData(index, std::move(data));
+    m_pages[index].requested = false;
+}
+
+// returns the page as stored on the sd card, empty if it's missing or invalid.
+// doesn't access the entries, so it can be called without the lock held.
+auto Cache::ReadPage(u32 index) const -> std::vector<u8> {
+    std::vector<u8> data;
+    if (R_FAILED(fs::FsNativeSd().read_entire_file(GetPagePath(index), data)) || data.size() != PAGE_BYTES) {
+        return {};
+    }
+
+    return data;
+}
+
+// sets the data returned by ReadPage(), unless the page was loaded in the meantime.
+// returns false if the thumbnails stored in the page were lost.
+auto Cache::SetPageData(u32 index, std::vector<u8>&& data) -> bool {
+    if (index >= m_pages.size()) {
+        m_pages.resize(index + 1);
+    }
+
+    auto& page = m_pages[index];
+    if (!page.data.empty()) {
+        return true;
+    }
+
+    if (data.empty()) {
+        // forget about the thumbnails that were stored in the missing page.
+        const auto removed = std::erase_if(m_entries, [index](const auto& pair) {
+            return pair.second.slot / THUMBS_PER_PAGE == index && !pair.second.pending;
+        });
+
+        if (removed) {
+            log_write("[THUMB] page: %u is missing or invalid, removed: %zu\n", index, removed);
+            m_index_dirty = true;
+        }
+
+        page.data.assign(PAGE_BYTES, 0);
+        return !removed;
+    }
+
+    page.data = std::move(data);
+    return true;
+}
+
+// returns the slot of the key if it's cached, otherwise a free slot,
+// or the slot of an entry that wasn't used since opening once full.
+auto Cache::FindSlot(u64 key) const -> std::optional<u32> {
+    if (const auto it = m_entries.find(key); it != m_entries.end()) {
+        return it->second.slot;
+    }
+
+    if (m_next_slot < m_max_pages * THUMBS_PER_PAGE) {
+        return m_next_slot;
+    }
+
+    const auto it = std::ranges::find_if(m_entries, [](const auto& pair) {
+        return !pair.second.used;
+    });
+
+    if (it == m_entries.end()) {
+        return std::nullopt;
+    }
+
+    return it->second.slot;
+}
+
+// reads the entries from the index, the pages are read once used.
+void Cache::LoadIndex(const char* name) {
+    std::vector<u8> data;
+    if (R_FAILED(fs::FsNativeSd().read_entire_file(fs::AppendPath(m_path, "index.bin"), data))) {
+        log_write("[THUMB] no cache for: %s\n", name);
+        return;
+    }
+
+    IndexHeader header{};
+    if (data.size() < sizeof(header)) {
+        return;
+    }
+
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != INDEX_MAGIC || header.version != INDEX_VERSION || header.thumb_size != THUMB_SIZE || header.page_size != PAGE_SIZE) {
+        log_write("[THUMB] cache has bad magic or version, ignoring: %s\n", name);
+        return;
+    }
+
+    const auto count = (data.size() - sizeof(header)) / sizeof(IndexRecord);
+    m_entries.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+        IndexRecord record;
+        std::memcpy(&record, data.data() + sizeof(header) + i * sizeof(record), sizeof(record));
+        if (record.slot >= m_max_pages * THUMBS_PER_PAGE) {
+            continue;
+        }
+
+        m_entries.insert_or_assign(record.key, Entry{record.stamp, record.slot, 0, false, false, true});
+        m_next_slot = std::max(m_next_slot, record.slot + 1);
+    }
+
+    m_pages.resize((m_next_slot + THUMBS_PER_PAGE - 1) / THUMBS_PER_PAGE);
+    log_write("[THUMB] loaded cache: %s entries: %zu pages: %zu\n", name, m_entries.size(), m_pages.size());
+}
+
+// reads the pages requested by Get() first, as they're waiting to be drawn,
+// then stores the queued thumbnails. the changes are saved once nothing
+// has been stored for SAVE_DELAY_NS, and before exiting.
+void Cache::ThreadFunc(void* p) {
+    auto cache = static_cast<Cache*>(p);
+
+    for (;;) {
+        std::optional<u32> page;
+        std::optional<Job> job;
+        bool running;
+        {
+            SCOPED_MUTEX(&cache->m_mutex);
+            for (;;) {
+                running = cache->m_running;
+                if (!running) {
+                    cache->m_page_requests.clear();
+                }
+
+                if (!cache->m_page_requests.empty()) {
+                    page = cache->m_page_requests.front();
+                    cache->m_page_requests.pop_front();
+                    break;
+                }
+
+                if (!cache->m_jobs.empty()) {
+                    job = std::move(cache->m_jobs.front());
+                    cache->m_jobs.pop_front();
+                    break;
+                }
+
+                if (!running) {
+                    break;
+                }
+
+                if (!cache->m_index_dirty) {
+                    condvarWait(&cache->m_can_work, &cache->m_mutex);
+                    continue;
+                }
+
+                const auto elapsed = armTicksToNs(armGetSystemTick() - cache->m_last_set);
+                if (elapsed >= SAVE_DELAY_NS) {
+                    break;
+                }
+
+                condvarWaitTimeout(&cache->m_can_work, &cache->m_mutex, SAVE_DELAY_NS - elapsed);
+            }
+        }
+
+        if (page) {
+            cache->LoadRequestedPage(*page);
+        } else if (job) {
+            cache->Store(*job);
+        } else {
+            cache->Save();
+            if (!running) {
+                break;
+            }
+        }
+    }
+}
+
+auto Cache::GetPagePath(u32 index) const -> fs::FsPath {
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "%s/page_%u.bin", m_path.s, index);
+    return path;
+}
+
+auto Resize(const ImageResult& image) -> ImageResult {
+    if (image.data.empty()) {
+        return {};
+    }
+
+    return ImageResize(image.data, image.w, image.h, THUMB_SIZE, THUMB_SIZE);
+}
+
+auto GetKey(std::string_view str) -> u64 {
+    return Fnv1a(reinterpret_cast<const u8*>(str.data()), str.size());
+}
+
+auto GetAppStamp(u64 app_id) -> u64 {
+    std::vector<u32> versions;
+    NsApplicationContentMetaStatus status[0x20];
+    for (s32 offset = 0;;) {
+        s32 count{};
+        if (R_FAILED(nsListApplicationContentMetaStatus(app_id, offset, status, std::size(status), &count)) || !count) {
+            break;
+        }
+
+        for (s32 i = 0; i < count; i++) {
+            if (status[i].meta_type == NcmContentMetaType_Application || status[i].meta_type == NcmContentMetaType_Patch) {
+                versions.emplace_back(status[i].meta_type);
+                versions.emplace_back(status[i].version);
+            }
+        }
+
+        offset += count;
+    }
+
+    // not installed, such as the saves of a deleted game, so the icon can't change.
+    if (versions.empty()) {
+        return 1;
+    }
+
+    return Fnv1a(reinterpret_cast<const u8*>(versions.data()), versions.size() * sizeof(u32));
+}
+
+} // namespace npshop::thumb
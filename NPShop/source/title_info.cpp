@@ -10,6 +10,9 @@
 #include <atomic>
 #include <ranges>
 #include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <nxtc.h>
 #include <minIni.h>
@@ -18,16 +21,21 @@ namespace npshop::title {
 namespace {
 
 constexpr int THREAD_PRIO = PRIO_PREEMPTIVE;
-constexpr int THREAD_CORE = 1;
+// the workers are spread across the cores that the ui doesn't run on.
+// most of the time is spent waiting on ns / fs, so there's more workers than cores.
+constexpr int THREAD_CORES[]{1, 2, 1};
+// min time between loads from the control data, shared by all the workers so that ns isn't hogged.
+constexpr u64 CONTROL_LOAD_DELAY_NS = 2e+6;
 
 struct ThreadData {
     ThreadData(bool title_cache);
 
-    void Run();
+    void Run(u32 index);
     void Close();
     void Clear();
 
     void PushAsync(u64 id);
+    void PushAsync(std::span<const u64> ids);
     auto GetAsync(u64 app_id) -> ThreadResultData*;
     auto Get(u64 app_id, bool* cached = nullptr) -> ThreadResultData*;
 
@@ -39,23 +47,65 @@ struct ThreadData {
         return m_title_cache;
     }
 
+private:
+    // blocks until there's an id to load, returns false once closed.
+    // cache_only is set for ids that haven't been looked up in the title cache yet.
+    auto Pop(u32 index, u64& id, bool& cache_only) -> bool;
+    // called once the worker is done with the id, not_cached requeues the id to
+    // be loaded from the control data.
+    void Finish(u64 id, bool cached, bool not_cached);
+    // sleeps until this worker's turn to load from the control data.
+    void WaitForControlLoad();
+
+    auto LoadFromCache(u64 app_id) -> std::unique_ptr<ThreadResultData>;
+    auto LoadFromControl(u64 app_id) -> std::unique_ptr<ThreadResultData>;
+    void LoadOverrides(ThreadResultData* result);
+    auto AddResult(std::unique_ptr<ThreadResultData>&& result) -> ThreadResultData*;
+
 private:
     fs::FsNativeSd m_fs{};
-    UEvent m_uevent{};
     Mutex m_mutex_id{};
+    CondVar m_can_pop{};
     Mutex m_mutex_result{};
     bool m_title_cache{};
 
-    // app_ids pushed to the queue, signal uevent when pushed.
-    std::vector<u64> m_ids{};
-    // control data pushed to the queue.
-    std::vector<std::unique_ptr<ThreadResultData>> m_result{};
+    // app_ids pushed to the queue, these are looked up in the title cache first
+    // so that every cached entry is loaded before the slow ones.
+    std::deque<u64> m_ids{};
+    // app_ids that weren't in the title cache, loaded from the control data.
+    std::deque<u64> m_slow_ids{};
+    // app_ids that are queued or being loaded, so that they're not queued twice.
+    std::unordered_set<u64> m_pending{};
+    // app_ids pushed one at a time, these are visible so they skip the queue.
+    std::unordered_set<u64> m_urgent{};
+    u32 m_busy{};
+    // earliest time the next load from the control data can start, in ns.
+    u64 m_next_control_load{};
+
+    // control data indexed by app_id, only removed on Clear() so pointers remain valid.
+    std::unordered_map<u64, std::unique_ptr<ThreadResultData>> m_result{};
+
+    // timing of the last list pushed, logged once everything has been loaded.
+    struct Batch {
+        TimeStamp ts{};
+        u32 count{};
+        u32 cached{};
+        u32 loaded{};
+        bool active{};
+    } m_batch{};
 
     std::atomic_bool m_running{};
 };
 
+struct Worker {
+    Thread thread{};
+    u32 index{};
+    bool created{};
+    bool started{};
+};
+
 Mutex g_mutex{};
-Thread g_thread{};
+Worker g_workers[std::size(THREAD_CORES)]{};
 u32 g_ref_count{};
 std::unique_ptr<ThreadData> g_thread_data{};
 
@@ -133,57 +183,41 @@ Result LoadControlManual(u64 id, NacpStruct& nacp, ThreadResultData* data) {
 }
 
 ThreadData::ThreadData(bool title_cache) : m_title_cache{title_cache} {
-    ueventCreate(&m_uevent, true);
     mutexInit(&m_mutex_id);
+    condvarInit(&m_can_pop);
     mutexInit(&m_mutex_result);
     m_running = true;
 }
 
-void ThreadData::Run() {
-    TimeStamp ts{};
-    bool cached{true};
-    const auto waiter = waiterForUEvent(&m_uevent);
+void ThreadData::Run(u32 index) {
+    u64 id;
+    bool cache_only;
 
-    while (IsRunning()) {
-        const auto rc = waitSingle(waiter, 3e+9);
+    while (Pop(index, id, cache_only)) {
+        if (cache_only) {
+            auto result = LoadFromCache(id);
+            if (result) {
+                LoadOverrides(result.get());
+                AddResult(std::move(result));
+            }
 
-        // if we timed out, flush the cache and poll again.
-        if (R_FAILED(rc)) {
-            nxtcFlushCacheFile();
+            Finish(id, true, !result);
             continue;
         }
 
-        if (!IsRunning()) {
-            return;
-        }
-
-        std::vector<u64> ids;
-        {
-            SCOPED_MUTEX(&m_mutex_id);
-            std::swap(ids, m_ids);
-        }
-
-        for (u64 i = 0; i < std::size(ids); i++) {
-            if (!IsRunning()) {
-                return;
-            }
+        WaitForControlLoad();
 
-            // sleep after every other entry loaded.
-            const auto elapsed = (s64)2e+6 - (s64)ts.GetNs();
-            if (!cached && elapsed > 0) {
-                svcSleepThread(elapsed);
-            }
-
-            // loads new entry into cache.
-            std::ignore = Get(ids[i], &cached);
-            ts.Update();
-        }
+        // loads new entry into cache.
+        bool cached{};
+        std::ignore = Get(id, &cached);
+        Finish(id, cached, false);
     }
 }
 
 void ThreadData::Close() {
+    SCOPED_MUTEX(&m_mutex_id);
     m_running = false;
-    ueventSignal(&m_uevent);
+    condvarWakeAll(&m_can_pop);
 }
 
 void ThreadData::Clear() {
@@ -195,175 +229,297 @@ void ThreadData::Clear() {
 
 void ThreadData::PushAsync(u64 id) {
     SCOPED_MUTEX(&m_mutex_id);
-    SCOPED_MUTEX(&m_mutex_result);
 
-    const auto it_id = std::ranges::find(m_ids, id);
-    const auto it_result = std::ranges::find_if(m_result, [id](auto& e){
-        return id == e->id;
-    });
+    if (GetAsync(id)) {
+        return;
+    }
+
+    // already queued, move it to the front.
+    const auto bump = [id](std::deque<u64>& ids) {
+        if (const auto it = std::ranges::find(ids, id); it != ids.end()) {
+            ids.erase(it);
+            ids.emplace_front(id);
+        }
+    };
+
+    m_urgent.emplace(id);
+    if (!m_pending.emplace(id).second) {
+        bump(m_ids);
+        bump(m_slow_ids);
+        return;
+    }
 
-    if (it_id == m_ids.end() && it_result == m_result.end()) {
-        m_ids.emplace_back(id);
-        ueventSignal(&m_uevent);
+    m_ids.emplace_front(id);
+    condvarWakeOne(&m_can_pop);
+}
+
+void ThreadData::PushAsync(std::span<const u64> ids) {
+    SCOPED_MUTEX(&m_mutex_id);
+
+    m_batch = {};
+    m_batch.active = true;
+
+    for (const auto id : ids) {
+        if (GetAsync(id)) {
+            m_batch.cached++;
+        } else if (m_pending.emplace(id).second) {
+            m_ids.emplace_back(id);
+        }
     }
+
+    m_batch.count = ids.size();
+    condvarWakeAll(&m_can_pop);
 }
 
 auto ThreadData::GetAsync(u64 app_id) -> ThreadResultData* {
     SCOPED_MUTEX(&m_mutex_result);
 
-    for (s64 i = 0; i < std::size(m_result); i++) {
-        if (app_id == m_result[i]->id) {
-            return m_result[i].get();
-        }
+    if (const auto it = m_result.find(app_id); it != m_result.end()) {
+        return it->second.get();
     }
 
     return {};
 }
 
-auto ThreadData::Get(u64 app_id, bool* cached) -> ThreadResultData* {
-    // try and fetch from results first, before manually loading.
-    if (auto data = GetAsync(app_id)) {
+auto ThreadData::Pop(u32 index, u64& id, bool& cache_only) -> bool {
+    SCOPED_MUTEX(&m_mutex_id);
+
+    while (IsRunning()) {
+        if (!m_ids.empty()) {
+            id = m_ids.front();
+            m_ids.pop_front();
+            cache_only = true;
+            m_busy++;
+            return true;
+        }
+
+        if (!m_slow_ids.empty()) {
+            id = m_slow_ids.front();
+            m_slow_ids.pop_front();
+            cache_only = false;
+            m_busy++;
+            return true;
+        }
+
+        // if we timed out, flush the cache and poll again.
+        if (R_FAILED(condvarWaitTimeout(&m_can_pop, &m_mutex_id, 3e+9)) && !index) {
+            mutexUnlock(&m_mutex_id);
+            nxtcFlushCacheFile();
+            mutexLock(&m_mutex_id);
+        }
+    }
+
+    return false;
+}
+
+void ThreadData::Finish(u64 id, bool cached, bool not_cached) {
+    SCOPED_MUTEX(&m_mutex_id);
+    m_busy--;
+
+    if (not_cached) {
+        if (m_urgent.contains(id)) {
+            m_slow_ids.emplace_front(id);
+        } else {
+            m_slow_ids.emplace_back(id);
+        }
+        condvarWakeOne(&m_can_pop);
+        return;
+    }
+
+    m_pending.erase(id);
+    m_urgent.erase(id);
+
+    if (m_batch.active) {
         if (cached) {
-            *cached = true;
+            m_batch.cached++;
+        } else {
+            m_batch.loaded++;
         }
-        return data;
+
+        if (m_ids.empty() && m_slow_ids.empty() && !m_busy) {
+            m_batch.active = false;
+            log_write("[TITLE] loaded list of: %u cached: %u not cached: %u time taken: %.2fs %zums\n", m_batch.count, m_batch.cached, m_batch.loaded, m_batch.ts.GetSecondsD(), m_batch.ts.GetMs());
+        }
+    }
+}
+
+void ThreadData::WaitForControlLoad() {
+    u64 delay;
+    {
+        SCOPED_MUTEX(&m_mutex_id);
+        // reserve the next slot, so that the workers don't all wake up at the same time.
+        const auto now = armTicksToNs(armGetSystemTick());
+        const auto start = std::max(now, m_next_control_load);
+        m_next_control_load = start + CONTROL_LOAD_DELAY_NS;
+        delay = start - now;
     }
 
+    if (delay) {
+        svcSleepThread(delay);
+    }
+}
+
+auto ThreadData::LoadFromCache(u64 app_id) -> std::unique_ptr<ThreadResultData> {
     TimeStamp ts;
+    auto data = nxtcGetApplicationMetadataEntryById(app_id);
+    if (!data) {
+        return {};
+    }
+
+    log_write("[NXTC] loaded from cache time taken: %.2fs %zums %zuns\n", ts.GetSecondsD(), ts.GetMs(), ts.GetNs());
+    ON_SCOPE_EXIT(nxtcFreeApplicationMetadata(&data));
+
     auto result = std::make_unique<ThreadResultData>(app_id);
-    result->status = NacpLoadStatus::Error;
+    result->status = NacpLoadStatus::Loaded;
+    std::strcpy(result->lang.name, data->name);
+    std::strcpy(result->lang.author, data->publisher);
+    result->icon.resize(data->icon_size);
+    std::memcpy(result->icon.data(), data->icon_data, result->icon.size());
+    return result;
+}
 
-    if (auto data = nxtcGetApplicationMetadataEntryById(app_id)) {
-        log_write("[NXTC] loaded from cache time taken: %.2fs %zums %zuns\n", ts.GetSecondsD(), ts.GetMs(), ts.GetNs());
-        ON_SCOPE_EXIT(nxtcFreeApplicationMetadata(&data));
+auto ThreadData::LoadFromControl(u64 app_id) -> std::unique_ptr<ThreadResultData> {
+    auto result = std::make_unique<ThreadResultData>(app_id);
+    result->status = NacpLoadStatus::Error;
 
-        if (cached) {
-            *cached = true;
-        }
+    bool manual_load = true;
+    u64 actual_size{};
+    auto control = std::make_unique<NsApplicationControlData>();
 
-        result->status = NacpLoadStatus::Loaded;
-        std::strcpy(result->lang.name, data->name);
-        std::strcpy(result->lang.author, data->publisher);
-        result->icon.resize(data->icon_size);
-        std::memcpy(result->icon.data(), data->icon_data, result->icon.size());
-    } else {
-        if (cached) {
-            *cached = false;
+    if (hosversionBefore(20,0,0)) {
+        TimeStamp ts;
+        if (R_SUCCEEDED(nsGetApplicationControlData(NsApplicationControlSource_CacheOnly, app_id, control.get(), sizeof(NsApplicationControlData), &actual_size))) {
+            manual_load = false;
+            log_write("\t\t[ns control cache] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
         }
+    }
 
-        bool manual_load = true;
-        u64 actual_size{};
-        auto control = std::make_unique<NsApplicationControlData>();
+    if (manual_load) {
+        manual_load = R_SUCCEEDED(LoadControlManual(app_id, control->nacp, result.get()));
+    }
 
-        if (hosversionBefore(20,0,0)) {
-            TimeStamp ts;
-            if (R_SUCCEEDED(nsGetApplicationControlData(NsApplicationControlSource_CacheOnly, app_id, control.get(), sizeof(NsApplicationControlData), &actual_size))) {
-                manual_load = false;
-                log_write("\t\t[ns control cache] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
-            }
+    Result rc{};
+    if (!manual_load) {
+        TimeStamp ts;
+        if (R_SUCCEEDED(rc = nsGetApplicationControlData(NsApplicationControlSource_Storage, app_id, control.get(), sizeof(NsApplicationControlData), &actual_size))) {
+            log_write("\t\t[ns control storage] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
         }
+    }
 
-        if (manual_load) {
-            manual_load = R_SUCCEEDED(LoadControlManual(app_id, control->nacp, result.get()));
+    if (R_FAILED(rc)) {
+        FakeNacpEntry(result.get());
+    } else {
+        bool valid = true;
+        NacpLanguageEntry* lang;
+        if (R_SUCCEEDED(nsGetApplicationDesiredLanguage(&control->nacp, &lang))) {
+            result->lang = *lang;
+        } else {
+            FakeNacpEntry(result.get());
+            valid = false;
         }
 
-        Result rc{};
         if (!manual_load) {
-            TimeStamp ts;
-            if (R_SUCCEEDED(rc = nsGetApplicationControlData(NsApplicationControlSource_Storage, app_id, control.get(), sizeof(NsApplicationControlData), &actual_size))) {
-                log_write("\t\t[ns control storage] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
-            }
+            const auto jpeg_size = actual_size - sizeof(NacpStruct);
+            result->icon.resize(jpeg_size);
+            std::memcpy(result->icon.data(), control->icon, result->icon.size());
         }
 
-        if (R_FAILED(rc)) {
-            FakeNacpEntry(result.get());
-        } else {
-            bool valid = true;
-            NacpLanguageEntry* lang;
-            if (R_SUCCEEDED(nsGetApplicationDesiredLanguage(&control->nacp, &lang))) {
-                result->lang = *lang;
-            } else {
-                FakeNacpEntry(result.get());
-                valid = false;
-            }
+        // add new entry to cache, if valid.
+        if (valid) {
+            nxtcAddEntry(app_id, &control->nacp, result->icon.size(), result->icon.data(), true);
+        }
 
-            if (!manual_load) {
-                const auto jpeg_size = actual_size - sizeof(NacpStruct);
-                result->icon.resize(jpeg_size);
-                std::memcpy(result->icon.data(), control->icon, result->icon.size());
-            }
+        result->status = NacpLoadStatus::Loaded;
+    }
 
-            // add new entry to cache, if valid.
-            if (valid) {
-                nxtcAddEntry(app_id, &control->nacp, result->icon.size(), result->icon.data(), true);
-            }
+    return result;
+}
 
-            result->status = NacpLoadStatus::Loaded;
-        }
+// load override from sys-tweak.
+void ThreadData::LoadOverrides(ThreadResultData* result) {
+    if (result->status != NacpLoadStatus::Loaded) {
+        return;
+    }
+
+    const auto tweak_path = GetContentsPath(result->id);
+    if (!m_fs.DirExists(tweak_path)) {
+        return;
     }
 
-    // load override from sys-tweak.
-    if (result->status == NacpLoadStatus::Loaded) {
-        const auto tweak_path = GetContentsPath(app_id);
-        if (m_fs.DirExists(tweak_path)) {
-            log_write("[TITLE] found contents path: %s\n", tweak_path.s);
+    log_write("[TITLE] found contents path: %s\n", tweak_path.s);
 
-            std::vector<u8> icon;
-            m_fs.read_entire_file(fs::AppendPath(tweak_path, "icon.jpg"), icon);
+    std::vector<u8> icon;
+    m_fs.read_entire_file(fs::AppendPath(tweak_path, "icon.jpg"), icon);
 
-            struct Overrides {
-                std::string name;
-                std::string author;
-            } overrides;
+    struct Overrides {
+        std::string name;
+        std::string author;
+    } overrides;
 
-            static const auto cb = [](const mTCHAR *Section, const mTCHAR *Key, const mTCHAR *Value, void *UserData) -> int {
-                auto e = static_cast<Overrides*>(UserData);
+    static const auto cb = [](const mTCHAR *Section, const mTCHAR *Key, const mTCHAR *Value, void *UserData) -> int {
+        auto e = static_cast<Overrides*>(UserData);
 
-                if (!std::strcmp(Section, "override_nacp")) {
-                    if (!std::strcmp(Key, "name")) {
-                        e->name = Value;
-                    } else if (!std::strcmp(Key, "author")) {
-                        e->author = Value;
-                    }
-                }
+        if (!std::strcmp(Section, "override_nacp")) {
+            if (!std::strcmp(Key, "name")) {
+                e->name = Value;
+            } else if (!std::strcmp(Key, "author")) {
+                e->author = Value;
+            }
+        }
 
-                return 1;
-            };
+        return 1;
+    };
 
-            ini_browse(cb, &overrides, fs::AppendPath(tweak_path, "config.ini"));
+    ini_browse(cb, &overrides, fs::AppendPath(tweak_path, "config.ini"));
 
-            if (!icon.empty() && icon.size() < sizeof(NsApplicationControlData::icon)) {
-                log_write("[TITLE] overriding icon: %zu -> %zu\n", result->icon.size(), icon.size());
-                result->icon = icon;
-            }
+    if (!icon.empty() && icon.size() < sizeof(NsApplicationControlData::icon)) {
+        log_write("[TITLE] overriding icon: %zu -> %zu\n", result->icon.size(), icon.size());
+        result->icon = icon;
+    }
 
-            if (!overrides.name.empty() && overrides.name.length() < sizeof(result->lang.name)) {
-                log_write("[TITLE] overriding name: %s -> %s\n", result->lang.name, overrides.name.c_str());
-                std::strcpy(result->lang.name, overrides.name.c_str());
-            }
+    if (!overrides.name.empty() && overrides.name.length() < sizeof(result->lang.name)) {
+        log_write("[TITLE] overriding name: %s -> %s\n", result->lang.name, overrides.name.c_str());
+        std::strcpy(result->lang.name, overrides.name.c_str());
+    }
 
-            if (!overrides.author.empty() && overrides.author.length() < sizeof(result->lang.author)) {
-                log_write("[TITLE] overriding author: %s -> %s\n", result->lang.author, overrides.author.c_str());
-                std::strcpy(result->lang.author, overrides.author.c_str());
-            }
-        }
+    if (!overrides.author.empty() && overrides.author.length() < sizeof(result->lang.author)) {
+        log_write("[TITLE] overriding author: %s -> %s\n", result->lang.author, overrides.author.c_str());
+        std::strcpy(result->lang.author, overrides.author.c_str());
     }
+}
 
+// if the entry was loaded by another thread in the meantime, that one is kept.
+auto ThreadData::AddResult(std::unique_ptr<ThreadResultData>&& result) -> ThreadResultData* {
     SCOPED_MUTEX(&m_mutex_result);
-    return m_result.emplace_back(std::move(result)).get();
+    const auto id = result->id;
+    return m_result.try_emplace(id, std::move(result)).first->second.get();
 }
 
-void ThreadFunc(void* user) {
-    auto data = static_cast<ThreadData*>(user);
+auto ThreadData::Get(u64 app_id, bool* cached) -> ThreadResultData* {
+    // try and fetch from results first, before manually loading.
+    if (auto data = GetAsync(app_id)) {
+        if (cached) {
+            *cached = true;
+        }
+        return data;
+    }
 
-    if (data->IsTitleCacheEnabled() && !nxtcInitialize()) {
-        log_write("[NXTC] failed to init cache\n");
+    auto result = LoadFromCache(app_id);
+    if (cached) {
+        *cached = result != nullptr;
     }
-    ON_SCOPE_EXIT(nxtcExit());
 
-    while (data->IsRunning()) {
-        data->Run();
+    if (!result) {
+        result = LoadFromControl(app_id);
     }
+
+    LoadOverrides(result.get());
+    return AddResult(std::move(result));
+}
+
+void ThreadFunc(void* user) {
+    auto worker = static_cast<Worker*>(user);
+    g_thread_data->Run(worker->index);
 }
 
 } // namespace
@@ -381,9 +537,20 @@ Result Init() {
         }
 
         g_thread_data = std::make_unique<ThreadData>(true);
-        R_TRY(threadCreate(&g_thread, ThreadFunc, g_thread_data.get(), nullptr, 1024*32, THREAD_PRIO, THREAD_CORE));
-        svcSetThreadCoreMask(g_thread.handle, THREAD_CORE, THREAD_AFFINITY_DEFAULT(THREAD_CORE));
-        R_TRY(threadStart(&g_thread));
+        if (g_thread_data->IsTitleCacheEnabled() && !nxtcInitialize()) {
+            log_write("[NXTC] failed to init cache\n");
+        }
+
+        for (u32 i = 0; i < std::size(g_workers); i++) {
+            auto& worker = g_workers[i];
+            const auto core = THREAD_CORES[i];
+            worker.index = i;
+            R_TRY(threadCreate(&worker.thread, ThreadFunc, &worker, nullptr, 1024*32, THREAD_PRIO, core));
+            worker.created = true;
+            svcSetThreadCoreMask(worker.thread.handle, core, THREAD_AFFINITY_DEFAULT(core));
+            R_TRY(threadStart(&worker.thread));
+            worker.started = true;
+        }
     }
 
     g_ref_count++;
@@ -401,9 +568,18 @@ void Exit() {
     if (!g_ref_count) {
         g_thread_data->Close();
 
-        threadWaitForExit(&g_thread);
-        threadClose(&g_thread);
+        for (auto& worker : g_workers) {
+            if (worker.started) {
+                threadWaitForExit(&worker.thread);
+            }
+            if (worker.created) {
+                threadClose(&worker.thread);
+            }
+            worker = {};
+        }
+
         g_thread_data.reset();
+        nxtcExit();
 
         for (auto& e : ncm_entries) {
             e.Close();
@@ -428,6 +604,13 @@ void PushAsync(u64 app_id) {
     }
 }
 
+void PushAsync(std::span<const u64> app_ids) {
+    SCOPED_MUTEX(&g_mutex);
+    if (g_thread_data) {
+        g_thread_data->PushAsync(app_ids);
+    }
+}
+
 auto GetAsync(u64 app_id) -> ThreadResultData* {
     SCOPED_MUTEX(&g_mutex);
     if (g_thread_data) {
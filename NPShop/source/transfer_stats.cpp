@@ -0,0 +1,101 @@
+#include "transfer_stats.hpp"
+#include "fs.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+
+#include <cstdio>
+#include <yyjson.h>
+
+namespace npshop {
+namespace {
+
+constexpr fs::FsPath STATS_PATH{"/config/npshop/stats"};
+
+constexpr const char* STAGE_NAMES[]{
+    "read",
+    "decompress",
+    "write",
+};
+
+auto ToSeconds(u64 ns) -> double {
+    return double(ns) / 1e+9;
+}
+
+auto ToPercent(u64 ns, u64 total_ns) -> double {
+    return total_ns ? double(ns) * 100.0 / double(total_ns) : 0.0;
+}
+
+auto ToMiBs(u64 bytes, u64 ns) -> double {
+    return ns ? (double(bytes) / 1024.0 / 1024.0) / ToSeconds(ns) : 0.0;
+}
+
+} // namespace
+
+auto TransferStats::Format() const -> std::string {
+    std::string out;
+    char line[256];
+
+    for (u32 i = 0; i < Stage_Max; i++) {
+        const auto& stage = m_stages[i];
+        const auto running = stage.running_ns.load();
+        if (!running) {
+            continue;
+        }
+
+        std::snprintf(line, sizeof(line), "%s: %.1f MiB (%.2f MiB/s) busy: %.0f%% empty: %.0f%% full: %.0f%%\n",
+            STAGE_NAMES[i], double(stage.bytes) / 1024.0 / 1024.0, ToMiBs(stage.bytes, stage.GetBusyNs()),
+            ToPercent(stage.GetBusyNs(), running), ToPercent(stage.empty_ns, running), ToPercent(stage.full_ns, running));
+        out += line;
+    }
+
+    std::snprintf(line, sizeof(line), "zstd: %.2fs aes: %.2fs sha256: %.2fs",
+        ToSeconds(zstd_ns), ToSeconds(aes_ns), ToSeconds(sha_ns));
+    out += line;
+
+    return out;
+}
+
+void TransferStats::Save() const {
+    auto doc = yyjson_mut_doc_new(nullptr);
+    if (!doc) {
+        return;
+    }
+    ON_SCOPE_EXIT(yyjson_mut_doc_free(doc));
+
+    const auto elapsed = GetElapsedNs();
+    auto root = yyjson_mut_obj(doc);
+    yyjson_mut_doc_set_root(doc, root);
+    yyjson_mut_obj_add_str(doc, root, "name", m_name);
+    yyjson_mut_obj_add_real(doc, root, "elapsed_s", ToSeconds(elapsed));
+    yyjson_mut_obj_add_real(doc, root, "zstd_s", ToSeconds(zstd_ns));
+    yyjson_mut_obj_add_real(doc, root, "aes_s", ToSeconds(aes_ns));
+    yyjson_mut_obj_add_real(doc, root, "sha256_s", ToSeconds(sha_ns));
+
+    auto stages = yyjson_mut_obj_add_obj(doc, root, "stages");
+    for (u32 i = 0; i < Stage_Max; i++) {
+        const auto& stage = m_stages[i];
+        if (!stage.running_ns) {
+            continue;
+        }
+
+        auto obj = yyjson_mut_obj_add_obj(doc, stages, STAGE_NAMES[i]);
+        yyjson_mut_obj_add_uint(doc, obj, "bytes", stage.bytes);
+        yyjson_mut_obj_add_real(doc, obj, "running_s", ToSeconds(stage.running_ns));
+        yyjson_mut_obj_add_real(doc, obj, "busy_s", ToSeconds(stage.GetBusyNs()));
+        yyjson_mut_obj_add_real(doc, obj, "empty_s", ToSeconds(stage.empty_ns));
+        yyjson_mut_obj_add_real(doc, obj, "full_s", ToSeconds(stage.full_ns));
+        yyjson_mut_obj_add_real(doc, obj, "busy_mib_s", ToMiBs(stage.bytes, stage.GetBusyNs()));
+    }
+
+    fs::CreateDirectoryRecursively(STATS_PATH);
+
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "%s/%s.json", STATS_PATH.s, m_name);
+    if (!yyjson_mut_write_file(path, doc, YYJSON_WRITE_PRETTY, nullptr, nullptr)) {
+        log_write("[STATS] failed to write: %s\n", path.s);
+    } else {
+        log_write("[STATS] saved: %s\n", path.s);
+    }
+}
+
+} // namespace npshop
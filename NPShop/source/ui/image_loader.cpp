@@ -0,0 +1,228 @@
+#include "ui/image_loader.hpp"
+#include "app.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace npshop::ui {
+namespace {
+
+// max images uploaded to the gpu per frame.
+constexpr u32 UPLOAD_MAX_PER_FRAME = 4;
+
+// distance from the visible entries, used to decide what to load first.
+auto GetDistance(s64 index, s64 start, s64 end) -> s64 {
+    if (index < start) {
+        return start - index;
+    } else if (index >= end) {
+        return index - end + 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+ImageLoader::ImageLoader(u32 max_images) : m_max_images{max_images} {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_pop);
+
+    m_running = true;
+    if (R_FAILED(threadCreate(&m_thread, ThreadFunc, this, nullptr, 1024*128, PRIO_PREEMPTIVE, 2))) {
+        log_write("[IMAGE] failed to create loader thread\n");
+    } else if (R_FAILED(threadStart(&m_thread))) {
+        log_write("[IMAGE] failed to start loader thread\n");
+        threadClose(&m_thread);
+    } else {
+        m_thread_created = true;
+    }
+}
+
+ImageLoader::~ImageLoader() {
+    {
+        SCOPED_MUTEX(&m_mutex);
+        m_running = false;
+        m_jobs.clear();
+        condvarWakeAll(&m_can_pop);
+    }
+
+    if (m_thread_created) {
+        threadWaitForExit(&m_thread);
+        threadClose(&m_thread);
+    }
+
+    for (auto& [key, e] : m_images) {
+        FreeImage(e);
+    }
+}
+
+void ImageLoader::BeginFrame(const List& list, s64 count) {
+    m_frame++;
+
+    const auto page = list.GetPage();
+    const auto start = list.GetVisibleStart(count);
+    const auto end = std::min(start + page, count);
+    m_prefetch_start = std::max<s64>(0, start - page);
+    m_prefetch_end = std::min(end + page, count);
+
+    SCOPED_MUTEX(&m_mutex);
+    m_visible_start = start;
+    m_visible_end = end;
+
+    // drop requests that have been scrolled out of range, they are queued
+    // again if they come back into range.
+    std::erase_if(m_jobs, [this](const Job& job) {
+        if (job.index >= m_prefetch_start && job.index < m_prefetch_end) {
+            return false;
+        }
+
+        if (auto it = m_images.find(job.key); it != m_images.end() && it->second.request_id == job.request_id) {
+            it->second.state = State::None;
+        }
+        return true;
+    });
+}
+
+void ImageLoader::EndFrame(NVGcontext* vg) {
+    std::vector<LoadResult> results;
+    {
+        SCOPED_MUTEX(&m_mutex);
+        const auto count = std::min<size_t>(m_results.size(), UPLOAD_MAX_PER_FRAME);
+        results.assign(std::make_move_iterator(m_results.begin()), std::make_move_iterator(m_results.begin() + count));
+        m_results.erase(m_results.begin(), m_results.begin() + count);
+    }
+
+    for (auto& result : results) {
+        // the image was removed whilst loading.
+        auto it = m_images.find(result.key);
+        if (it == m_images.end() || it->second.request_id != result.request_id || it->second.state != State::Queued) {
+            continue;
+        }
+
+        auto& e = it->second;
+        const auto& data = result.image.data;
+        if (data.empty()) {
+            e.state = State::Failed;
+            continue;
+        }
+
+        e.image.image = nvgCreateImageRGBA(vg, result.image.w, result.image.h, 0, data.data());
+        e.image.w = result.image.w;
+        e.image.h = result.image.h;
+        std::memcpy(e.image.first_pixel, data.data(), sizeof(e.image.first_pixel));
+        e.state = e.image.image ? State::Loaded : State::Failed;
+        if (e.image.image) {
+            m_loaded_count++;
+        }
+    }
+
+    // forget about entries that were never loaded and are no longer in view.
+    std::erase_if(m_images, [this](const auto& pair) {
+        return pair.second.state == State::None && pair.second.last_used != m_frame;
+    });
+
+    // free the least recently used images, but never ones requested this frame.
+    while (m_loaded_count > m_max_images) {
+        auto lru = m_images.end();
+        for (auto it = m_images.begin(); it != m_images.end(); it++) {
+            if (it->second.state == State::Loaded && it->second.last_used != m_frame) {
+                if (lru == m_images.end() || it->second.last_used < lru->second.last_used) {
+                    lru = it;
+                }
+            }
+        }
+
+        if (lru == m_images.end()) {
+            break;
+        }
+
+        FreeImage(lru->second);
+        m_images.erase(lru);
+    }
+}
+
+void ImageLoader::Remove(u64 key) {
+    auto it = m_images.find(key);
+    if (it == m_images.end()) {
+        return;
+    }
+
+    FreeImage(it->second);
+    m_images.erase(it);
+
+    SCOPED_MUTEX(&m_mutex);
+    std::erase_if(m_jobs, [key](const Job& job) {
+        return job.key == key;
+    });
+}
+
+void ImageLoader::Clear() {
+    {
+        SCOPED_MUTEX(&m_mutex);
+        m_jobs.clear();
+        m_results.clear();
+    }
+
+    for (auto& [key, e] : m_images) {
+        FreeImage(e);
+    }
+    m_images.clear();
+}
+
+void ImageLoader::Queue(u64 key, Entry& e, s64 index, LoadFunc&& func) {
+    e.state = State::Queued;
+    e.request_id = ++m_next_request_id;
+
+    SCOPED_MUTEX(&m_mutex);
+    m_jobs.emplace_back(key, e.request_id, index, std::move(func));
+    condvarWakeOne(&m_can_pop);
+}
+
+void ImageLoader::FreeImage(Entry& e) {
+    if (e.image.image) {
+        nvgDeleteImage(App::GetVg(), e.image.image);
+        m_loaded_count--;
+    }
+
+    e.image = {};
+    e.state = State::None;
+}
+
+void ImageLoader::ThreadFunc(void* p) {
+    auto loader = static_cast<ImageLoader*>(p);
+
+    while (true) {
+        Job job;
+        {
+            SCOPED_MUTEX(&loader->m_mutex);
+            while (loader->m_running && loader->m_jobs.empty()) {
+                condvarWait(&loader->m_can_pop, &loader->m_mutex);
+            }
+
+            if (!loader->m_running) {
+                break;
+            }
+
+            // take the request nearest to the visible entries.
+            const auto start = loader->m_visible_start;
+            const auto end = loader->m_visible_end;
+            const auto it = std::ranges::min_element(loader->m_jobs, {}, [start, end](const Job& job) {
+                return GetDistance(job.index, start, end);
+            });
+
+            job = std::move(*it);
+            loader->m_jobs.erase(it);
+        }
+
+        TimeStamp ts;
+        auto image = job.func();
+        log_write("\t[image load] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
+
+        SCOPED_MUTEX(&loader->m_mutex);
+        loader->m_results.emplace_back(job.key, job.request_id, std::move(image));
+    }
+
+    log_write("[IMAGE] exited loader thread\n");
+}
+
+} // namespace npshop::ui
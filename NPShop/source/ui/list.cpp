@@ -57,6 +57,17 @@ void List::Draw(NVGcontext* vg, Theme* theme, s64 count, Callback callback) cons
     }
 }
 
+auto List::GetVisibleStart(s64 count) const -> s64 {
+    switch (m_layout) {
+        case Layout::HOME:
+            return ClampX(m_yoff + m_y_prog, count) / GetMaxX();
+        case Layout::GRID:
+            return s64(ClampY(m_yoff + m_y_prog, count) / GetMaxY()) * m_row;
+    }
+
+    return 0;
+}
+
 auto List::ScrollDown(s64& index, s64 step, s64 count) -> bool {
     const auto old_index = index;
     const auto max = m_layout == Layout::GRID ? GetMaxY() : GetMaxX();
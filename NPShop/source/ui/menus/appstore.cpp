@@ -20,6 +20,7 @@
 #include "minizip_helper.hpp"
 #include "yati/yati.hpp"
 #include "yati/source/file.hpp"
+#include "yati/source/http.hpp"
 
 #include <minIni.h>
 #include <string>
@@ -431,11 +432,9 @@ static void DrawCoverPlaceholder(NVGcontext* vg, const Vec4& r,
     nvgRestore(vg);
 }
 
-void DrawIcon(NVGcontext* vg, const LazyImage& l, const LazyImage& d, float x, float y, float w, float h, bool rounded = true, float scale = 1.0) {
-    const auto& i = l.image ? l : d;
-
-    const float iw = (float)i.w / scale;
-    const float ih = (float)i.h / scale;
+void DrawIcon(NVGcontext* vg, int image, int image_w, int image_h, const u8* first_pixel, float x, float y, float w, float h, bool rounded = true, float scale = 1.0) {
+    const float iw = (float)image_w / scale;
+    const float ih = (float)image_h / scale;
     float ix = x;
     float iy = y;
     bool rounded_image = rounded;
@@ -454,7 +453,7 @@ void DrawIcon(NVGcontext* vg, const LazyImage& l, const LazyImage& d, float x, f
     bool crop = false;
     if (iw < w || ih < h) {
         rounded_image = false;
-        gfx::drawRect(vg, x, y, w, h, nvgRGB(i.first_pixel[0], i.first_pixel[1], i.first_pixel[2]), rounded ? 5 : 0);
+        gfx::drawRect(vg, x, y, w, h, nvgRGB(first_pixel[0], first_pixel[1], first_pixel[2]), rounded ? 5 : 0);
     }
     if (iw > w || ih > h) {
         crop = true;
@@ -462,12 +461,17 @@ void DrawIcon(NVGcontext* vg, const LazyImage& l, const LazyImage& d, float x, f
         nvgIntersectScissor(vg, x, y, w, h);
     }
 
-    gfx::drawImage(vg, ix, iy, iw, ih, i.image, rounded_image ? 5 : 0);
+    gfx::drawImage(vg, ix, iy, iw, ih, image, rounded_image ? 5 : 0);
     if (crop) {
         nvgRestore(vg);
     }
 }
 
+void DrawIcon(NVGcontext* vg, const LazyImage& l, const LazyImage& d, float x, float y, float w, float h, bool rounded = true, float scale = 1.0) {
+    const auto& i = l.image ? l : d;
+    DrawIcon(vg, i.image, i.w, i.h, i.first_pixel, x, y, w, h, rounded, scale);
+}
+
 void DrawIcon(NVGcontext* vg, const LazyImage& l, const LazyImage& d, Vec4 vec, bool rounded = true, float scale = 1.0) {
     DrawIcon(vg, l, d, vec.x, vec.y, vec.w, vec.h, rounded, scale);
 }
@@ -753,6 +757,8 @@ void EntryMenu::UpdateOptions() {
                 curl::Api api{
                     curl::Url{url},
                     curl::Path{out},
+                    curl::Flags{curl::Flag_Segmented},
+                    curl::Segments{(u32)App::GetDownloadSegmentCount(), App::GetDownloadMinSegmentSize()},
                     curl::OnProgress{pbox->OnDownloadProgressCallback()},
                 };
                 auto r = curl::ToFile(api);
@@ -766,6 +772,31 @@ void EntryMenu::UpdateOptions() {
         );
     };
 
+    // installs directly from the url using range requests, nothing is written to the sd card.
+    auto install_direct = [this](const std::string& url, const std::string& filename) -> void {
+        if (url.empty() || filename.empty()) {
+            App::Notify("URL ou filename vazio"_i18n);
+            return;
+        }
+
+        if (!App::GetInstallEnable()) {
+            App::ShowEnableInstallPrompt();
+            return;
+        }
+
+        App::Push<ProgressBox>(
+            m_entry.image.image, "Installing "_i18n, filename,
+            [url, filename](auto pbox) -> Result {
+                yati::source::Http source{url};
+                return yati::InstallFromSource(pbox, &source, filename);
+            },
+            [filename](Result rc) {
+                App::PushErrorBox(rc, "Install failed!"_i18n);
+                if (R_SUCCEEDED(rc)) App::Notify("Installed "_i18n + filename);
+            }
+        );
+    };
+
     m_options.clear();
 
     const bool is_installed = (m_entry.status == EntryStatus::Installed || m_entry.status == EntryStatus::Local);
@@ -779,6 +810,12 @@ void EntryMenu::UpdateOptions() {
                     download_to_sd(m_entry.hb_base_url, m_entry.hb_base_filename);
                 }
             });
+            m_options.emplace_back(Option{
+                "Install directly"_i18n,
+                [this, install_direct]{
+                    install_direct(m_entry.hb_base_url, m_entry.hb_base_filename);
+                }
+            });
         }
     } else {
         // Instalado: oferecer Updates e DLCs sob demanda
@@ -791,6 +828,12 @@ void EntryMenu::UpdateOptions() {
                     download_to_sd(m_entry.hb_upd_url, m_entry.hb_upd_filename);
                 }
             });
+            m_options.emplace_back(Option{
+                "Install update directly"_i18n,
+                [this, install_direct]{
+                    install_direct(m_entry.hb_upd_url, m_entry.hb_upd_filename);
+                }
+            });
         }
 
         // Lista completa de updates (endpoint dedicado sugerido)
@@ -950,7 +993,10 @@ Menu::Menu(u32 flags) : grid::Menu{"AppStore"_i18n, flags} {
             if (m_entries_current.empty()) {
                 return;
             }
-            App::Push<EntryMenu>(m_entries[m_entries_current[m_index]], m_default_image, *this);
+            // the grid icons are owned by the image loader, so load a copy for the entry menu.
+            auto& e = m_entries[m_entries_current[m_index]];
+            EntryLoadImageFile(BuildIconCachePath(e), e.image);
+            App::Push<EntryMenu>(e, m_default_image, *this);
         }}),
         std::make_pair(Button::X, Action{"Options"_i18n, [this](){
             auto options = std::make_unique<Sidebar>("AppStore Options"_i18n, Sidebar::Side::RIGHT);
@@ -1065,74 +1111,61 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         return;
     }
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
-
-    m_list->Draw(vg, theme, m_entries_current.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
-        const auto& [x, y, w, h] = v;
-        const auto index = m_entries_current[pos];
-        auto& e = m_entries[index];
+    const auto load_icon = [this](s64 pos) -> const ImageLoader::Image& {
+        auto& e = m_entries[m_entries_current[pos]];
         auto& image = e.image;
-
-        // try and load cached image.
-        if (image_load_count < image_load_max && !image.image && !image.tried_cache) {
-            image.tried_cache = true;
-            image.cached = EntryLoadImageFile(BuildIconCachePath(e), image);
-            if (image.cached) {
-                image_load_count++;
-            }
-        }
-
-        // lazy load image
-        if (!image.image || image.cached) {
-            switch (image.state) {
-                case ImageDownloadState::None: {
-                    const auto path = BuildIconCachePath(e);
-                    const auto url = BuildIconUrl(e);
-                    image.state = ImageDownloadState::Progress;
-                    curl::Api().ToFileAsync(
-                        curl::Url{url},
-                        curl::Path{path},
-                        curl::Flags{curl::Flag_Cache},
-                        curl::StopToken{this->GetToken()},
-                        curl::OnComplete{[this, &image](auto& result) {
-                            if (result.success) {
-                                image.state = ImageDownloadState::Done;
-                                // data hasn't changed
-                                if (result.code == 304) {
-                                    image.cached = false;
-                                }
-                            } else {
-                                image.state = ImageDownloadState::Failed;
-                                log_write("failed to download image\n");
-                            }
-                        }}
-                    );
-                }   break;
-                case ImageDownloadState::Progress: {
-                }   break;
-                case ImageDownloadState::Done: {
-                    if (image_load_count < image_load_max) {
-                        image.cached = false;
-                        if (!EntryLoadImageFile(BuildIconCachePath(e), e.image)) {
-                            image.state = ImageDownloadState::Failed;
-                        } else {
-                            image_load_count++;
+        const auto path = BuildIconCachePath(e);
+        const auto key = std::hash<std::string_view>{}(path.s);
+
+        // download the icon, the cached copy is shown whilst checking for an update.
+        if (image.state == ImageDownloadState::None) {
+            const auto url = BuildIconUrl(e);
+            image.state = ImageDownloadState::Progress;
+            curl::Api().ToFileAsync(
+                curl::Url{url},
+                curl::Path{path},
+                curl::Flags{curl::Flag_Cache},
+                curl::StopToken{this->GetToken()},
+                curl::OnComplete{[this, &image, key](auto& result) {
+                    if (result.success) {
+                        image.state = ImageDownloadState::Done;
+                        // data has changed, so load it again.
+                        if (result.code != 304) {
+                            m_image_loader.Remove(key);
                         }
+                    } else {
+                        image.state = ImageDownloadState::Failed;
+                        log_write("failed to download image\n");
                     }
-                }   break;
-                case ImageDownloadState::Failed: {
-                }   break;
-            }
+                }}
+            );
         }
 
+        return m_image_loader.Get(key, pos, [&path]() -> ImageLoader::LoadFunc {
+            return [path]() {
+                return ImageLoadFromFile(path);
+            };
+        });
+    };
+
+    // request the entries around the visible ones first, so they're ready when scrolled to.
+    m_image_loader.BeginFrame(*m_list, m_entries_current.size());
+    for (auto i = m_image_loader.GetPrefetchStart(); i < m_image_loader.GetPrefetchEnd(); i++) {
+        load_icon(i);
+    }
+
+    m_list->Draw(vg, theme, m_entries_current.size(), [this, &load_icon](auto* vg, auto* theme, auto v, auto pos) {
+        const auto& [x, y, w, h] = v;
+        const auto index = m_entries_current[pos];
+        auto& e = m_entries[index];
+        const auto& icon = load_icon(pos);
+
         const auto selected = pos == m_index;
         const auto image_vec = DrawEntryNoImage(vg, theme, m_layout.Get(), v, selected, e.title.c_str(), e.author.c_str(), e.version.c_str());
 
-        if (e.image.image) {
+        if (icon.image) {
             const auto image_scale = 256.0 / image_vec.w;
-            DrawIcon(vg, e.image, m_default_image, image_vec.x, image_vec.y, image_vec.w, image_vec.h, true, image_scale);
+            DrawIcon(vg, icon.image, icon.w, icon.h, icon.first_pixel, image_vec.x, image_vec.y, image_vec.w, image_vec.h, true, image_scale);
         } else {
             DrawCoverPlaceholder(vg, image_vec, e.title, e.hb_titleid, true);
         }
@@ -1153,6 +1186,8 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
                 break;
         }
     });
+
+    m_image_loader.EndFrame(vg);
 }
 
 void Menu::OnFocusGained() {
@@ -11,6 +11,7 @@
 #include "app.hpp"
 #include "ui/nvg_util.hpp"
 #include "fs.hpp"
+#include "dir_walker.hpp"
 #include "nro.hpp"
 #include "defines.hpp"
 #include "image.hpp"
@@ -601,8 +602,6 @@ namespace npshop::ui::menu::filebrowser {
 				const auto loc = network_locations[*op_index];
 				App::Push<ProgressBox>(0, "Uploading"_i18n, "", [this, loc](auto pbox) -> Result {
 					auto targets = GetSelectedEntries();
-					const auto is_file_based_emummc = App::IsFileBaseEmummc();
-
 					const auto file_add = [&](s64 file_size, const fs::FsPath& file_path, const char* name) -> Result {
 						// the file name needs to be relative to the current directory.
 						const auto relative_file_name = file_path.s + std::strlen(m_path);
@@ -611,14 +610,13 @@ namespace npshop::ui::menu::filebrowser {
 
 						fs::File f;
 						R_TRY(m_fs->OpenFile(file_path, FsOpenMode_Read, &f));
+						thread::Throttle throttle{m_fs->IsNative() && App::IsFileBaseEmummc()};
 
 						return thread::TransferPull(pbox, file_size,
 							[&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
-								const auto rc = f.Read(off, data, size, FsReadOption_None, bytes_read);
-								if (m_fs->IsNative() && is_file_based_emummc) {
-									svcSleepThread(2e+6); // 2ms
-								}
-								return rc;
+								return throttle.Run(size, [&]() -> Result {
+									return f.Read(off, data, size, FsReadOption_None, bytes_read);
+								});
 							},
 							[&](thread::PullCallback pull) -> Result {
 								s64 offset{};
@@ -983,60 +981,49 @@ namespace npshop::ui::menu::filebrowser {
 						const auto full_path = GetNewPath(selected.m_path, p.name);
 						if (p.IsDir()) {
 							pbox->NewTransfer("Scanning "_i18n + full_path);
-							R_TRY(get_collections(src_fs, full_path, p.name, collections));
+							R_TRY(get_collections(src_fs, full_path, p.name, collections, true));
 						}
 					}
 
-					for (const auto& p : selected.m_files) {
-						pbox->Yield();
-						R_TRY(pbox->ShouldExitResult());
+					// create all the folders first, parents are always listed before their children.
+					// this allows for all the files to then be copied in a single batch.
+					std::vector<thread::CopyEntry> entries;
+					pbox->NewTransfer("Creating folders"_i18n);
 
+					for (const auto& p : selected.m_files) {
 						const auto src_path = GetNewPath(selected.m_path, p.name);
 						const auto dst_path = GetNewPath(p);
 
 						if (p.IsDir()) {
-							pbox->SetTitle(p.name);
-							pbox->NewTransfer("Creating "_i18n + dst_path);
 							m_fs->CreateDirectory(dst_path);
 						}
 						else {
-							pbox->SetTitle(p.name);
-							pbox->NewTransfer("Copying "_i18n + src_path);
-							R_TRY(pbox->CopyFile(src_fs, m_fs.get(), src_path, dst_path, is_same_fs));
-							R_TRY(on_paste_file(src_path, dst_path));
+							entries.emplace_back(src_path, dst_path, p.file_size);
 						}
 					}
 
-					// copy everything in collections
 					for (const auto& c : collections) {
+						R_TRY(pbox->ShouldExitResult());
 						const auto base_dst_path = GetNewPath(m_path, c.parent_name);
 
 						for (const auto& p : c.dirs) {
-							pbox->Yield();
-							R_TRY(pbox->ShouldExitResult());
-
-							// const auto src_path = GetNewPath(c.path, p.name);
-							const auto dst_path = GetNewPath(base_dst_path, p.name);
-
-							pbox->SetTitle(p.name);
-							pbox->NewTransfer("Creating "_i18n + dst_path);
-							m_fs->CreateDirectory(dst_path);
+							m_fs->CreateDirectory(GetNewPath(base_dst_path, p.name));
 						}
 
 						for (const auto& p : c.files) {
-							pbox->Yield();
-							R_TRY(pbox->ShouldExitResult());
-
-							const auto src_path = GetNewPath(c.path, p.name);
-							const auto dst_path = GetNewPath(base_dst_path, p.name);
-
-							pbox->SetTitle(p.name);
-							pbox->NewTransfer("Copying "_i18n + src_path);
-							R_TRY(pbox->CopyFile(src_fs, m_fs.get(), src_path, dst_path, is_same_fs));
-							R_TRY(on_paste_file(src_path, dst_path));
+							entries.emplace_back(GetNewPath(c.path, p.name), GetNewPath(base_dst_path, p.name), p.file_size);
 						}
 					}
 
+					// stdio fs are not safe to access from multiple threads, so same fs
+					// copies are single threaded. otherwise, each fs is only used by one thread.
+					const auto mode = is_same_fs ? thread::Mode::SingleThreaded : thread::Mode::MultiThreaded;
+
+					pbox->NewTransfer("Copying to "_i18n + m_path.toString());
+					R_TRY(thread::TransferCopyBatch(pbox, src_fs, m_fs.get(), entries, [&](const thread::CopyEntry& e) -> Result {
+						return on_paste_file(e.src, e.dst);
+					}, mode));
+
 					// moving accross fs is not possible, thus files have to be copied.
 					// this leaves the files on the src_fs.
 					// the files are deleted one by one after a successfull copy (see above)
@@ -1088,19 +1075,31 @@ namespace npshop::ui::menu::filebrowser {
 	}
 
 	auto FsView::get_collections(fs::Fs* fs, const fs::FsPath& path, const fs::FsPath& parent_name, FsDirCollections& out, bool inc_size) -> Result {
-		// get a list of all the files / dirs
-		FsDirCollection collection;
-		R_TRY(get_collection(fs, path, parent_name, collection, true, true, inc_size));
-		log_write("got collection: %s parent_name: %s files: %zu dirs: %zu\n", path.s, parent_name.s, collection.files.size(), collection.dirs.size());
-		out.emplace_back(collection);
-
-		// for (size_t i = 0; i < collection.dirs.size(); i++) {
-		for (const auto& p : collection.dirs) {
-			// use heap as to not explode the stack
-			const auto new_path = std::make_unique<fs::FsPath>(FsView::GetNewPath(path, p.name));
-			const auto new_parent_name = std::make_unique<fs::FsPath>(FsView::GetNewPath(parent_name, p.name));
-			log_write("trying to get nested collection: %s parent_name: %s\n", new_path->s, new_parent_name->s);
-			R_TRY(get_collections(fs, *new_path, *new_parent_name, out, inc_size));
+		// get a list of all the files / dirs, the folders are listed in parallel
+		// but returned in the same order as walking them one by one.
+		fs::WalkConfig config{};
+		config.mode = FsDirOpenMode_ReadFiles | FsDirOpenMode_ReadDirs;
+		if (!inc_size) {
+			config.mode |= FsDirOpenMode_NoFileSize;
+		}
+
+		std::vector<fs::WalkEntry> entries;
+		R_TRY(fs::WalkDirs(fs, path, entries, config));
+
+		const auto base = out.size();
+		out.reserve(base + entries.size());
+
+		for (auto& e : entries) {
+			auto& collection = out.emplace_back();
+			collection.path = e.path;
+			if (e.parent < 0) {
+				collection.parent_name = parent_name;
+			} else {
+				collection.parent_name = FsView::GetNewPath(out[base + e.parent].parent_name, e.name);
+			}
+			collection.files = std::move(e.files);
+			collection.dirs = std::move(e.dirs);
+			log_write("got collection: %s parent_name: %s files: %zu dirs: %zu\n", collection.path.s, collection.parent_name.s, collection.files.size(), collection.dirs.size());
 		}
 
 		R_SUCCEED();
@@ -1214,25 +1213,36 @@ namespace npshop::ui::menu::filebrowser {
 		}
 	}
 
-	void FsView::DisplayHash(hash::Type type) {
+	void FsView::DisplayHash(std::span<const hash::Type> types) {
 		// hack because we cannot share output between threaded calls...
-		static std::string hash_out;
+		static std::vector<std::string> hash_out;
 		hash_out.clear();
 
-		App::Push<ProgressBox>(0, "Hashing"_i18n, GetEntry().name, [this, type](auto pbox) -> Result {
+		App::Push<ProgressBox>(0, "Hashing"_i18n, GetEntry().name, [this, types](auto pbox) -> Result {
 			const auto full_path = GetNewPathCurrent();
 			pbox->NewTransfer(full_path);
-			R_TRY(hash::Hash(pbox, type, m_fs.get(), full_path, hash_out));
+
+			// the root is part of the key, as the same path can exist on several filesystems.
+			const auto cache_key = m_fs_entry.root.toString() + full_path.toString();
+			R_TRY(hash::Hash(pbox, types, m_fs.get(), full_path, hash_out, cache_key));
 
 			R_SUCCEED();
-			}, [this, type](Result rc) {
+			}, [this, types](Result rc) {
 				App::PushErrorBox(rc, "Failed to hash file..."_i18n);
 
 				if (R_SUCCEEDED(rc)) {
-					char buf[0x100];
-					// std::snprintf(buf, sizeof(buf), "%s\n%s\n%s", hash::GetTypeStr(type), hash_out.c_str(), GetEntry().GetName());
-					std::snprintf(buf, sizeof(buf), "%s\n%s", hash::GetTypeStr(type), hash_out.c_str());
-					App::Push<OptionBox>(buf, "OK"_i18n);
+					std::string str;
+					if (types.size() == 1) {
+						str = std::string{hash::GetTypeStr(types[0])} + "\n" + hash_out[0];
+					} else {
+						for (u32 i = 0; i < types.size(); i++) {
+							if (i) {
+								str += "\n";
+							}
+							str += std::string{hash::GetTypeStr(types[i])} + ": " + hash_out[i];
+						}
+					}
+					App::Push<OptionBox>(str, "OK"_i18n);
 				}
 				});
 	}
@@ -1515,17 +1525,13 @@ namespace npshop::ui::menu::filebrowser {
 				auto options = std::make_unique<Sidebar>("Hash Options"_i18n, Sidebar::Side::RIGHT);
 				ON_SCOPE_EXIT(App::Push(std::move(options)));
 
-				options->Add<SidebarEntryCallback>("CRC32"_i18n, [this]() {
-					DisplayHash(hash::Type::Crc32);
-					});
-				options->Add<SidebarEntryCallback>("MD5"_i18n, [this]() {
-					DisplayHash(hash::Type::Md5);
-					});
-				options->Add<SidebarEntryCallback>("SHA1"_i18n, [this]() {
-					DisplayHash(hash::Type::Sha1);
-					});
-				options->Add<SidebarEntryCallback>("SHA256"_i18n, [this]() {
-					DisplayHash(hash::Type::Sha256);
+				for (const auto& type : hash::ALL_TYPES) {
+					options->Add<SidebarEntryCallback>(i18n::get(hash::GetTypeStr(type)), [this, &type]() {
+						DisplayHash(std::span{&type, 1});
+						});
+				}
+				options->Add<SidebarEntryCallback>("All"_i18n, [this]() {
+					DisplayHash(hash::ALL_TYPES);
 					});
 				});
 		}
@@ -6,6 +6,7 @@
 #include "i18n.hpp"
 #include "image.hpp"
 #include "swkbd.hpp"
+#include "threaded_file_transfer.hpp"
 
 #include "ui/menus/game_menu.hpp"
 #include "ui/menus/save_menu.hpp"
@@ -113,7 +114,6 @@ private:
 
 struct NspSource final : dump::BaseSource {
     NspSource(const std::vector<NspEntry>& entries) : m_entries{entries} {
-        m_is_file_based_emummc = App::IsFileBaseEmummc();
     }
 
     Result Read(const std::string& path, void* buf, s64 off, s64 size, u64* bytes_read) override {
@@ -122,11 +122,9 @@ struct NspSource final : dump::BaseSource {
         });
         R_UNLESS(it != m_entries.end(), Result_GameBadReadForDump);
 
-        const auto rc = it->Read(buf, off, size, bytes_read);
-        if (m_is_file_based_emummc) {
-            svcSleepThread(2e+6); // 2ms
-        }
-        return rc;
+        return m_throttle.Run(size, [&]() -> Result {
+            return it->Read(buf, off, size, bytes_read);
+        });
     }
 
     auto GetName(const std::string& path) const -> std::string {
@@ -167,7 +165,7 @@ struct NspSource final : dump::BaseSource {
 
 private:
     std::vector<NspEntry> m_entries{};
-    bool m_is_file_based_emummc{};
+    thread::Throttle m_throttle{};
 };
 
 Result Notify(Result rc, const std::string& error_message) {
@@ -185,11 +183,18 @@ Result GetMetaEntries(const Entry& e, title::MetaEntries& out, u32 flags = title
     return title::GetMetaEntries(e.app_id, out, flags);
 }
 
-bool LoadControlImage(Entry& e, title::ThreadResultData* result) {
+// if thumbs is set, the icon is also stored in the thumbnail cache.
+bool LoadControlImage(Entry& e, title::ThreadResultData* result, thumb::Cache* thumbs = nullptr) {
     if (!e.image && result && !result->icon.empty()) {
         TimeStamp ts;
         const auto image = ImageLoadFromMemory(result->icon, ImageFlag_JPEG);
         if (!image.data.empty()) {
+            if (thumbs) {
+                if (!e.thumb_stamp) {
+                    e.thumb_stamp = thumb::GetAppStamp(e.app_id);
+                }
+                thumbs->Set(e.app_id, e.thumb_stamp, image);
+            }
             e.image = nvgCreateImageRGBA(App::GetVg(), image.w, image.h, 0, image.data.data());
             log_write("\t[image load] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
             return true;
@@ -719,9 +724,19 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             LoadResultIntoEntry(e, title::GetAsync(e.app_id));
         }
 
-        // lazy load image
-        if (image_load_count < image_load_max) {
-            if (LoadControlImage(e, title::GetAsync(e.app_id))) {
+        // use the cached thumbnail for the grid layouts, the list layout draws
+        // the icons too large for the thumbnails.
+        // the stamp doesn't need the title info, so cached thumbnails are shown straight away.
+        thumb::Thumb thumb{};
+        const auto use_thumb = !e.image && m_layout.Get() != LayoutType_List;
+        if (use_thumb && !e.thumb_stamp) {
+            e.thumb_stamp = thumb::GetAppStamp(e.app_id);
+        }
+        const auto has_thumb = use_thumb && m_thumbs.Get(e.app_id, e.thumb_stamp, thumb);
+
+        // lazy load image, unless the thumbnail is cached and its page is still being read.
+        if (!has_thumb && !(use_thumb && m_thumbs.Contains(e.app_id, e.thumb_stamp)) && image_load_count < image_load_max) {
+            if (LoadControlImage(e, title::GetAsync(e.app_id), &m_thumbs)) {
                 image_load_count++;
             }
         }
@@ -730,7 +745,11 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         std::snprintf(title_id, sizeof(title_id), "%016lX", e.app_id);
 
         const auto selected = pos == m_index;
-        DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, e.GetName(), e.GetAuthor(), title_id);
+        if (has_thumb) {
+            DrawEntry(vg, theme, m_layout.Get(), v, selected, thumb, e.GetName(), e.GetAuthor(), title_id);
+        } else {
+            DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, e.GetName(), e.GetAuthor(), title_id);
+        }
 
         if (e.selected) {
             gfx::drawRect(vg, v, theme->GetColour(ThemeEntryID_FOCUS), 5);
@@ -801,6 +820,15 @@ void Menu::ScanHomebrew() {
     this->Sort();
     SetIndex(0);
     ClearSelection();
+
+    // queue every entry in sorted order, the visible entries are moved
+    // to the front of the queue once drawn.
+    std::vector<u64> ids;
+    ids.reserve(m_entries.size());
+    for (const auto& e : m_entries) {
+        ids.emplace_back(e.app_id);
+    }
+    title::PushAsync(ids);
 }
 
 void Menu::Sort() {
@@ -258,6 +258,10 @@ struct GcSource final : yati::source::Base {
     GcSource(const ApplicationEntry& entry, fs::FsNativeGameCard* fs);
     Result Read(void* buf, s64 off, s64 size, u64* bytes_read);
 
+    bool SupportsParallelReads() const override {
+        return true;
+    }
+
     yati::container::Collections m_collections{};
     yati::ConfigOverride m_config{};
     fs::FsNativeGameCard* m_fs{};
@@ -8,6 +8,11 @@ void Menu::DrawEntry(NVGcontext* vg, Theme* theme, int layout, const Vec4& v, bo
     DrawEntry(vg, theme, true, layout, v, selected, image, name, author, version);
 }
 
+void Menu::DrawEntry(NVGcontext* vg, Theme* theme, int layout, const Vec4& v, bool selected, const thumb::Thumb& thumb, const char* name, const char* author, const char* version) {
+    const auto image_v = DrawEntry(vg, theme, false, layout, v, selected, 0, name, author, version);
+    gfx::drawImageRegion(vg, image_v, thumb.image, thumb::PAGE_SIZE, thumb::PAGE_SIZE, thumb.src, 5);
+}
+
 Vec4 Menu::DrawEntryNoImage(NVGcontext* vg, Theme* theme, int layout, const Vec4& v, bool selected, const char* name, const char* author, const char* version) {
     return DrawEntry(vg, theme, false, layout, v, selected, 0, name, author, version);
 }
@@ -29,11 +29,6 @@ auto GenerateStarPath(const fs::FsPath& nro_path) -> fs::FsPath {
     return out;
 }
 
-void FreeEntry(NVGcontext* vg, NroEntry& e) {
-    nvgDeleteImage(vg, e.image);
-    e.image = 0;
-}
-
 } // namespace
 
 void SignalChange() {
@@ -92,37 +87,55 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
 void Menu::Draw(NVGcontext* vg, Theme* theme) {
     MenuBase::Draw(vg, theme);
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
+    // use the cached thumbnail for the grid layouts, the list layout draws
+    // the icons too large for the thumbnails.
+    const auto use_thumbs = m_layout.Get() != LayoutType_List;
+    const auto get_thumb = [this, use_thumbs](const NroEntry& e, thumb::Thumb& out) -> bool {
+        return use_thumbs && m_thumbs.Get(thumb::GetKey(e.path.s), e.timestamp.modified, out);
+    };
 
-    m_list->Draw(vg, theme, m_entries_current.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
-        const auto index = m_entries_current[pos];
-        auto& e = m_entries[index];
+    const auto load_icon = [this, use_thumbs](s64 pos) -> int {
+        const auto& e = m_entries[m_entries_current[pos]];
+        if (!e.icon_size || !e.icon_offset) {
+            return 0;
+        }
 
-        // lazy load image
-        if (image_load_count < image_load_max) {
-            if (!e.image && e.icon_size && e.icon_offset) {
+        // drawn from the thumbnail once its page has been read.
+        if (use_thumbs && m_thumbs.Contains(thumb::GetKey(e.path.s), e.timestamp.modified)) {
+            return 0;
+        }
+
+        const auto key = std::hash<std::string_view>{}(e.path.s);
+        return m_image_loader.Get(key, pos, [this, &e]() -> ImageLoader::LoadFunc {
+            return [this, path = e.path, size = e.icon_size, offset = e.icon_offset, stamp = e.timestamp.modified]() -> ImageResult {
                 // NOTE: it seems that images can be any size. SuperTux uses a 1024x1024
                 // ~300Kb image, which takes a few frames to completely load.
                 // really, switch-tools should handle this by resizing the image before
                 // adding it to the nro, as well as validate its a valid jpeg.
-                const auto icon = nro_get_icon(e.path, e.icon_size, e.icon_offset);
-                TimeStamp ts;
-                if (!icon.empty()) {
-                    const auto image = ImageLoadFromMemory(icon, ImageFlag_JPEG);
-                    if (!image.data.empty()) {
-                        e.image = nvgCreateImageRGBA(vg, image.w, image.h, 0, image.data.data());
-                        log_write("\t[image load] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
-                        image_load_count++;
-                    } else {
-                        // prevent loading of this icon again as it's already failed.
-                        e.icon_offset = e.icon_size = 0;
-                    }
+                const auto icon = nro_get_icon(path, size, offset);
+                if (icon.empty()) {
+                    return {};
                 }
-            }
-        }
 
+                auto image = ImageLoadFromMemory(icon, ImageFlag_JPEG);
+                m_thumbs.Set(thumb::GetKey(path.s), stamp, image);
+                return image;
+            };
+        }).image;
+    };
+
+    // request the entries around the visible ones first, so they're ready when scrolled to.
+    m_image_loader.BeginFrame(*m_list, m_entries_current.size());
+    for (auto i = m_image_loader.GetPrefetchStart(); i < m_image_loader.GetPrefetchEnd(); i++) {
+        load_icon(i);
+    }
+
+    m_list->Draw(vg, theme, m_entries_current.size(), [this, &load_icon, &get_thumb](auto* vg, auto* theme, auto v, auto pos) {
+        const auto index = m_entries_current[pos];
+        auto& e = m_entries[index];
+        const auto image = load_icon(pos);
+        thumb::Thumb thumb{};
+        const auto has_thumb = get_thumb(e, thumb);
 
         bool has_star = false;
         if (IsStarEnabled()) {
@@ -140,8 +153,14 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         }
 
         const auto selected = pos == m_index;
-        DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, name.c_str(), e.GetAuthor(), e.GetDisplayVersion());
+        if (has_thumb) {
+            DrawEntry(vg, theme, m_layout.Get(), v, selected, thumb, name.c_str(), e.GetAuthor(), e.GetDisplayVersion());
+        } else {
+            DrawEntry(vg, theme, m_layout.Get(), v, selected, image, name.c_str(), e.GetAuthor(), e.GetDisplayVersion());
+        }
     });
+
+    m_image_loader.EndFrame(vg);
 }
 
 void Menu::OnFocusGained() {
@@ -312,12 +331,7 @@ void Menu::SortAndFindLastFile(bool scan) {
 }
 
 void Menu::FreeEntries() {
-    auto vg = App::GetVg();
-
-    for (auto&p : m_entries) {
-        FreeEntry(vg, p);
-    }
-
+    m_image_loader.Clear();
     m_entries.clear();
     for (auto& e : m_entries_index) {
         e.clear();
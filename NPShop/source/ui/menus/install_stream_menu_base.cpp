@@ -18,19 +18,17 @@ enum class InstallState {
     Finished,
 };
 
+// size of the ring buffer, which is allocated once when the file is opened.
 constexpr u64 MAX_BUFFER_SIZE = 1024ULL*1024ULL*8ULL;
-constexpr u64 MAX_BUFFER_RESERVE_SIZE = 1024ULL*1024ULL*32ULL;
 std::atomic<InstallState> INSTALL_STATE{InstallState::None};
 
-// don't use condivar here as windows mtp is very broken.
-// stalling for too longer (3s+) and having too varied transfer speeds
-// results in windows stalling the transfer for 1m until it kills it via timeout.
-// the workaround is to always accept new data, but stall for 1s.
-// UPDATE: it seems possible to trigger this bug during normal file transfer
-// including using stock haze.
-// it seems random, and ive been unable to trigger it personally.
-// for this reason, use condivar rather than trying to work around the issue.
-#define USE_CONDI_VAR 1
+// note: windows mtp is very broken, stalling for too long (3s+) and having
+// too varied transfer speeds results in windows stalling the transfer for 1m
+// until it kills it via timeout.
+// it was worked around by always accepting new data but stalling for 1s,
+// however it seems possible to trigger this bug during normal file transfer
+// including using stock haze, so the writer now waits on a condivar until
+// there's space in the buffer.
 
 } // namespace
 
@@ -38,7 +36,7 @@ Stream::Stream(const fs::FsPath& path, std::stop_token token) {
     m_path = path;
     m_token = token;
     m_active = true;
-    m_buffer.reserve(MAX_BUFFER_RESERVE_SIZE);
+    m_buffer.resize(MAX_BUFFER_SIZE);
 
     mutexInit(&m_mutex);
     condvarInit(&m_can_read);
@@ -51,33 +49,55 @@ Result Stream::ReadChunk(void* buf, s64 size, u64* bytes_read) {
         log_write("[Stream::ReadChunk] exiting\n");
     );
 
+    return Pop(static_cast<u8*>(buf), size, bytes_read);
+}
+
+// the skipped data is dropped from the buffer without being copied.
+Result Stream::Skip(s64 size, u64* bytes_skipped) {
+    return Pop(nullptr, size, bytes_skipped);
+}
+
+Result Stream::Pop(u8* buf, s64 size, u64* bytes_read) {
     while (!m_token.stop_requested()) {
         SCOPED_MUTEX(&m_mutex);
-        if (m_active && m_buffer.empty()) {
+        if (m_active && !m_size) {
             R_TRY(condvarWait(std::addressof(m_can_read), std::addressof(m_mutex)));
         }
 
-        if ((!m_active && m_buffer.empty()) || m_token.stop_requested()) {
+        if ((!m_active && !m_size) || m_token.stop_requested()) {
             break;
         }
 
-        size = std::min<s64>(size, m_buffer.size());
-        std::memcpy(buf, m_buffer.data(), size);
-        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + size);
+        if (!m_size) {
+            continue;
+        }
+
+        // copy up to the end of the buffer, then wrap around to the start.
+        size = std::min<s64>(size, m_size);
+        if (buf) {
+            const auto first = std::min<s64>(size, m_buffer.size() - m_read_offset);
+            std::memcpy(buf, m_buffer.data() + m_read_offset, first);
+            std::memcpy(buf + first, m_buffer.data(), size - first);
+        }
+
+        m_read_offset = (m_read_offset + size) % m_buffer.size();
+        m_size -= size;
         *bytes_read = size;
         return condvarWakeOne(&m_can_write);
     }
 
-    log_write("[Stream::ReadChunk] failed to read\n");
+    log_write("[Stream::Pop] failed to read\n");
     R_THROW(Result_TransferCancelled);
 }
 
-bool Stream::Push(const void* buf, s64 size) {
+bool Stream::Push(const void* _buf, s64 size) {
     log_write("[Stream::Push] inside\n");
     ON_SCOPE_EXIT(
         log_write("[Stream::Push] exiting\n");
     );
 
+    auto buf = static_cast<const u8*>(_buf);
+
     while (!m_token.stop_requested()) {
         if (INSTALL_STATE == InstallState::Finished) {
             log_write("[Stream::Push] install has finished\n");
@@ -85,31 +105,33 @@ bool Stream::Push(const void* buf, s64 size) {
         }
 
         SCOPED_MUTEX(&m_mutex);
-        #if USE_CONDI_VAR
-        if (m_active && m_buffer.size() >= MAX_BUFFER_SIZE) {
-            R_TRY(condvarWait(std::addressof(m_can_write), std::addressof(m_mutex)));
-        }
-        #else
-        if (m_active && m_buffer.size() >= MAX_BUFFER_SIZE) {
-            // unlock the mutex and wait for 1s to bring transfer speed down to 1MiB/s.
-            log_write("[Stream::Push] buffer is full, delaying\n");
-            mutexUnlock(&m_mutex);
-            ON_SCOPE_EXIT(mutexLock(&m_mutex));
-
-            svcSleepThread(1e+9);
+        if (m_active && m_size == m_buffer.size()) {
+            if (R_FAILED(condvarWait(std::addressof(m_can_write), std::addressof(m_mutex)))) {
+                break;
+            }
+            continue;
         }
-        #endif
 
         if (!m_active) {
             log_write("[Stream::Push] file not active\n");
             break;
         }
 
-        const auto offset = m_buffer.size();
-        m_buffer.resize(offset + size);
-        std::memcpy(m_buffer.data() + offset, buf, size);
+        // copy as much as fits, waiting for the reader to free up space for the rest.
+        const auto write_offset = (m_read_offset + m_size) % m_buffer.size();
+        const auto count = std::min<s64>(size, m_buffer.size() - m_size);
+        const auto first = std::min<s64>(count, m_buffer.size() - write_offset);
+        std::memcpy(m_buffer.data() + write_offset, buf, first);
+        std::memcpy(m_buffer.data(), buf + first, count - first);
+
+        m_size += count;
+        buf += count;
+        size -= count;
         condvarWakeOne(&m_can_read);
-        return true;
+
+        if (!size) {
+            return true;
+        }
     }
 
     log_write("[Stream::Push] failed to push\n");
@@ -217,11 +217,18 @@ void FakeNacpEntryForSystem(Entry& e) {
     std::strcpy(e.lang.author, "Nintendo");
 }
 
-bool LoadControlImage(Entry& e, title::ThreadResultData* result) {
+// if thumbs is set, the icon is also stored in the thumbnail cache.
+bool LoadControlImage(Entry& e, title::ThreadResultData* result, thumb::Cache* thumbs = nullptr) {
     if (!e.image && result && !result->icon.empty()) {
         TimeStamp ts;
         const auto image = ImageLoadFromMemory(result->icon, ImageFlag_JPEG);
         if (!image.data.empty()) {
+            if (thumbs) {
+                if (!e.thumb_stamp) {
+                    e.thumb_stamp = thumb::GetAppStamp(e.application_id);
+                }
+                thumbs->Set(e.application_id, e.thumb_stamp, image);
+            }
             e.image = nvgCreateImageRGBA(App::GetVg(), image.w, image.h, 0, image.data.data());
             log_write("\t[image load] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
             return true;
@@ -508,15 +515,27 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             LoadResultIntoEntry(e, title::GetAsync(e.application_id));
         }
 
-        // lazy load image
-        if (image_load_count < image_load_max) {
-            if (LoadControlImage(e, title::GetAsync(e.application_id))) {
+        // use the cached thumbnail for the grid layouts, the list layout draws
+        // the icons too large for the thumbnails.
+        // the stamp doesn't need the title info, so cached thumbnails are shown straight away.
+        thumb::Thumb thumb{};
+        const auto use_thumb = !e.image && m_layout.Get() != LayoutType_List;
+        if (use_thumb && !e.thumb_stamp) {
+            e.thumb_stamp = thumb::GetAppStamp(e.application_id);
+        }
+        const auto has_thumb = use_thumb && m_thumbs.Get(e.application_id, e.thumb_stamp, thumb);
+
+        // lazy load image, unless the thumbnail is cached and its page is still being read.
+        if (!has_thumb && !(use_thumb && m_thumbs.Contains(e.application_id, e.thumb_stamp)) && image_load_count < image_load_max) {
+            if (LoadControlImage(e, title::GetAsync(e.application_id), &m_thumbs)) {
                 image_load_count++;
             }
         }
 
         const auto selected = pos == m_index;
-        if (m_data_type != FsSaveDataType_System && m_data_type != FsSaveDataType_SystemBcat) {
+        if (has_thumb) {
+            DrawEntry(vg, theme, m_layout.Get(), v, selected, thumb, e.GetName(), e.GetAuthor(), "");
+        } else if (m_data_type != FsSaveDataType_System && m_data_type != FsSaveDataType_SystemBcat) {
             DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, e.GetName(), e.GetAuthor(), "");
         } else {
             const auto image_vec = DrawEntryNoImage(vg, theme, m_layout.Get(), v, selected, e.GetName(), e.GetAuthor(), "");
@@ -613,6 +632,20 @@ void Menu::ScanHomebrew() {
     this->Sort();
     SetIndex(0);
     ClearSelection();
+
+    // system saves don't have control data.
+    if (m_data_type == FsSaveDataType_System || m_data_type == FsSaveDataType_SystemBcat) {
+        return;
+    }
+
+    // queue every entry in sorted order, the visible entries are moved
+    // to the front of the queue once drawn.
+    std::vector<u64> ids;
+    ids.reserve(m_entries.size());
+    for (const auto& e : m_entries) {
+        ids.emplace_back(e.application_id);
+    }
+    title::PushAsync(ids);
 }
 
 void Menu::Sort() {
@@ -1060,13 +1093,13 @@ Result Menu::BackupSaveInternal(ProgressBox* pbox, const dump::DumpLocation& loc
     }
 
     // if we dumped the save to ram, flush the data to file.
-    const auto is_file_based_emummc = App::IsFileBaseEmummc();
     if (!file_download) {
         pbox->NewTransfer("Flushing zip to file");
         R_TRY(fs->CreateFile(temp_path, mz_mem.buf.size(), 0));
 
         fs::File file;
         R_TRY(fs->OpenFile(temp_path, FsOpenMode_Write, &file));
+        thread::Throttle throttle{};
 
         R_TRY(thread::Transfer(pbox, mz_mem.buf.size(),
             [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
@@ -1076,11 +1109,9 @@ Result Menu::BackupSaveInternal(ProgressBox* pbox, const dump::DumpLocation& loc
                 R_SUCCEED();
             },
             [&](const void* data, s64 off, s64 size) -> Result {
-                const auto rc = file.Write(off, data, size, FsWriteOption_None);
-                if (is_file_based_emummc) {
-                    svcSleepThread(2e+6); // 2ms
-                }
-                return rc;
+                return throttle.Run(size, [&]() -> Result {
+                    return file.Write(off, data, size, FsWriteOption_None);
+                });
             }
         ));
     }
@@ -150,33 +150,8 @@ auto apiBuildIconCache(const ThemeEntry& e) -> fs::FsPath {
     return path;
 }
 
-auto loadThemeImage(ThemeEntry& e) -> bool {
-    auto& image = e.preview.lazy_image;
-
-    // already have the image
-    if (e.preview.lazy_image.image) {
-        // log_write("warning, tried to load image: %s when already loaded\n", path.c_str());
-        return true;
-    }
-    auto vg = App::GetVg();
-
-    const auto path = apiBuildIconCache(e);
-    TimeStamp ts;
-    const auto data = ImageLoadFromFile(path, ImageFlag_JPEG);
-    if (!data.data.empty()) {
-        image.w = data.w;
-        image.h = data.h;
-        image.image = nvgCreateImageRGBA(vg, data.w, data.h, 0, data.data.data());
-        log_write("\t[image load] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
-    }
-
-    if (!image.image) {
-        log_write("failed to load image from file: %s\n", path.s);
-        return false;
-    } else {
-        // log_write("loaded image from file: %s\n", path);
-        return true;
-    }
+auto GetThemeImageKey(const ThemeEntry& e) -> u64 {
+    return std::hash<std::string_view>{}(apiBuildIconCache(e).s);
 }
 
 void from_json(yyjson_val* json, Creator& e) {
@@ -382,7 +357,7 @@ Menu::Menu(u32 flags) : MenuBase{"Themezer"_i18n, flags} {
                             const auto& entry = page.m_packList[m_index];
                             const auto url = apiBuildUrlDownloadPack(entry);
 
-                            App::Push<ProgressBox>(entry.themes[0].preview.lazy_image.image, "Downloading "_i18n, entry.details.name, [this, &entry](auto pbox) -> Result {
+                            App::Push<ProgressBox>(m_image_loader.Find(GetThemeImageKey(entry.themes[0])), "Downloading "_i18n, entry.details.name, [this, &entry](auto pbox) -> Result {
                                 return InstallTheme(pbox, entry);
                             }, [this, &entry](Result rc){
                                 App::PushErrorBox(rc, "Failed to download theme"_i18n);
@@ -474,11 +449,58 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             return;
     }
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
+    const auto load_image = [this, &page](s64 pos) -> int {
+        auto& e = page.m_packList[pos];
+        if (e.themes.empty()) {
+            return 0;
+        }
+
+        auto& theme = e.themes[0];
+        auto& image = theme.preview.lazy_image;
+        const auto path = apiBuildIconCache(theme);
+        const auto key = GetThemeImageKey(theme);
+
+        // download the preview, the cached copy is shown whilst checking for an update.
+        if (image.state == ImageDownloadState::None) {
+            log_write("downloading theme!: %s\n", path.s);
+
+            const auto url = theme.preview.thumb;
+            log_write("downloading url: %s\n", url.c_str());
+            image.state = ImageDownloadState::Progress;
+            curl::Api().ToFileAsync(
+                curl::Url{url},
+                curl::Path{path},
+                curl::Flags{curl::Flag_Cache},
+                curl::StopToken{this->GetToken()},
+                curl::OnComplete{[this, &image, key](auto& result) {
+                    if (result.success) {
+                        image.state = ImageDownloadState::Done;
+                        // data has changed, so load it again.
+                        if (result.code != 304) {
+                            m_image_loader.Remove(key);
+                        }
+                    } else {
+                        image.state = ImageDownloadState::Failed;
+                        log_write("failed to download image\n");
+                    }
+                }
+            });
+        }
+
+        return m_image_loader.Get(key, pos, [&path]() -> ImageLoader::LoadFunc {
+            return [path]() {
+                return ImageLoadFromFile(path, ImageFlag_JPEG);
+            };
+        }).image;
+    };
+
+    // request the entries around the visible ones first, so they're ready when scrolled to.
+    m_image_loader.BeginFrame(*m_list, page.m_packList.size());
+    for (auto i = m_image_loader.GetPrefetchStart(); i < m_image_loader.GetPrefetchEnd(); i++) {
+        load_image(i);
+    }
 
-    m_list->Draw(vg, theme, page.m_packList.size(), [this, &page, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    m_list->Draw(vg, theme, page.m_packList.size(), [this, &page, &load_image](auto* vg, auto* theme, auto v, auto pos) {
         const auto& [x, y, w, h] = v;
         auto& e = page.m_packList[pos];
 
@@ -493,65 +515,9 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
 
         const float xoff = (350 - 320) / 2;
 
-        // lazy load image
         if (e.themes.size()) {
-            auto& theme = e.themes[0];
-            auto& image = e.themes[0].preview.lazy_image;
-
-            // try and load cached image.
-            if (image_load_count < image_load_max && !image.image && !image.tried_cache) {
-                image.tried_cache = true;
-                image.cached = loadThemeImage(theme);
-                if (image.cached) {
-                    image_load_count++;
-                }
-            }
-
-            if (!image.image || image.cached) {
-                switch (image.state) {
-                    case ImageDownloadState::None: {
-                        const auto path = apiBuildIconCache(theme);
-                        log_write("downloading theme!: %s\n", path.s);
-
-                        const auto url = theme.preview.thumb;
-                        log_write("downloading url: %s\n", url.c_str());
-                        image.state = ImageDownloadState::Progress;
-                        curl::Api().ToFileAsync(
-                            curl::Url{url},
-                            curl::Path{path},
-                            curl::Flags{curl::Flag_Cache},
-                            curl::StopToken{this->GetToken()},
-                            curl::OnComplete{[this, &image](auto& result) {
-                                if (result.success) {
-                                    image.state = ImageDownloadState::Done;
-                                    // data hasn't changed
-                                    if (result.code == 304) {
-                                        image.cached = false;
-                                    }
-                                } else {
-                                    image.state = ImageDownloadState::Failed;
-                                    log_write("failed to download image\n");
-                                }
-                            }
-                        });
-                    }   break;
-                    case ImageDownloadState::Progress: {
-
-                    }   break;
-                    case ImageDownloadState::Done: {
-                        image.cached = false;
-                        if (!loadThemeImage(theme)) {
-                            image.state = ImageDownloadState::Failed;
-                        } else {
-                            image_load_count++;
-                        }
-                    }   break;
-                    case ImageDownloadState::Failed: {
-                    }   break;
-                }
-            }
-
-            gfx::drawImage(vg, x + xoff, y, 320, 180, image.image ? image.image : App::GetDefaultImage(), 5);
+            const auto image = load_image(pos);
+            gfx::drawImage(vg, x + xoff, y, 320, 180, image ? image : App::GetDefaultImage(), 5);
         }
 
         const auto text_x = x + xoff;
@@ -560,6 +526,8 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         m_scroll_name.Draw(vg, selected, text_x, y + 180 + 20, text_clip_w, font_size, NVG_ALIGN_LEFT, theme->GetColour(text_id), e.details.name.c_str());
         m_scroll_author.Draw(vg, selected, text_x, y + 180 + 55, text_clip_w, font_size, NVG_ALIGN_LEFT, theme->GetColour(text_id), e.creator.display_name.c_str());
     });
+
+    m_image_loader.EndFrame(vg);
 }
 
 void Menu::OnFocusGained() {
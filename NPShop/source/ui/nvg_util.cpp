@@ -219,6 +219,14 @@ void drawImage(NVGcontext* vg, float x, float y, float w, float h, int texture,
     drawImage(vg, Vec4(x, y, w, h), texture, rounded, alpha);
 }
 
+void drawImageRegion(NVGcontext* vg, const Vec4& v, int texture, float texture_w, float texture_h, const Vec4& src, float rounded, float alpha) {
+    // scale the whole texture so that the src region lands on v.
+    const auto sx = v.w / src.w;
+    const auto sy = v.h / src.h;
+    const auto paint = nvgImagePattern(vg, v.x - src.x * sx, v.y - src.y * sy, texture_w * sx, texture_h * sy, 0, texture, alpha);
+    drawRect(vg, v, paint, rounded);
+}
+
 void drawTextBox(NVGcontext* vg, float x, float y, float size, float bound, const NVGcolor& c, const char* str, int align, const char* end) {
     if (ClipText(x, y, align)) {
         return;
@@ -5,6 +5,7 @@
 #include "defines.hpp"
 #include "log.hpp"
 #include "threaded_file_transfer.hpp"
+#include "transfer_stats.hpp"
 #include "i18n.hpp"
 #include <cstring>
 
@@ -101,6 +102,12 @@ auto ProgressBox::Draw(NVGcontext* vg, Theme* theme) -> void {
     const auto last_offset = m_last_offset;
     auto image = m_image;
 
+    // formatted whilst locked, as the stats are only valid until cleared.
+    std::string stats;
+    if (m_stats && App::GetTransferStatsEnable()) {
+        stats = m_stats->Format();
+    }
+
     if (m_is_image_pending) {
         FreeImage();
         image = m_image = m_image_pending;
@@ -190,6 +197,13 @@ auto ProgressBox::Draw(NVGcontext* vg, Theme* theme) -> void {
     }
 
     nvgRestore(vg);
+
+    if (!stats.empty()) {
+        nvgFontSize(vg, 16);
+        nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+        nvgFillColor(vg, theme->GetColour(ThemeEntryID_TEXT_INFO));
+        nvgTextBox(vg, m_pos.x, m_pos.y + m_pos.h + 10, m_pos.w, stats.c_str(), nullptr);
+    }
 }
 
 auto ProgressBox::SetActionName(const std::string& action)  -> ProgressBox& {
@@ -252,6 +266,19 @@ auto ProgressBox::SetImageDataConst(std::span<const u8> data) -> ProgressBox& {
     return *this;
 }
 
+auto ProgressBox::SetStats(const TransferStats* stats) -> ProgressBox& {
+    mutexLock(&m_mutex);
+    m_stats = stats;
+    mutexUnlock(&m_mutex);
+    return *this;
+}
+
+auto ProgressBox::GetStats() -> const TransferStats* {
+    mutexLock(&m_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+    return m_stats;
+}
+
 void ProgressBox::RequestExit() {
     m_stop_source.request_stop();
     ueventSignal(GetCancelEvent());
@@ -269,8 +296,10 @@ auto ProgressBox::ShouldExitResult() -> Result {
 }
 
 auto ProgressBox::CopyFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src_path, const fs::FsPath& dst_path, bool single_threaded) -> Result {
-    const auto is_file_based_emummc = App::IsFileBaseEmummc();
     const auto is_both_native = fs_src->IsNative() && fs_dst->IsNative();
+    // read and write happen on different threads, so each gets a throttle.
+    thread::Throttle read_throttle{is_both_native && App::IsFileBaseEmummc()};
+    thread::Throttle write_throttle{is_both_native && App::IsFileBaseEmummc()};
 
     fs::File src_file;
     R_TRY(fs_src->OpenFile(src_path, FsOpenMode_Read, &src_file));
@@ -289,22 +318,14 @@ auto ProgressBox::CopyFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src
 
     R_TRY(thread::Transfer(this, src_size,
         [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
-            const auto rc = src_file.Read(off, data, size, 0, bytes_read);
-
-            if (is_both_native && is_file_based_emummc) {
-                svcSleepThread(2e+6); // 2ms
-            }
-
-            return rc;
+            return read_throttle.Run(size, [&]() -> Result {
+                return src_file.Read(off, data, size, 0, bytes_read);
+            });
         },
         [&](const void* data, s64 off, s64 size) -> Result {
-            const auto rc = dst_file.Write(off, data, size, 0);
-
-            if (is_both_native && is_file_based_emummc) {
-                svcSleepThread(2e+6); // 2ms
-            }
-
-            return rc;
+            return write_throttle.Run(size, [&]() -> Result {
+                return dst_file.Write(off, data, size, 0);
+            });
         }, single_threaded ? thread::Mode::SingleThreaded : thread::Mode::MultiThreaded
     ));
 
@@ -22,15 +22,23 @@
 #include "log.hpp"
 #include "defines.hpp"
 #include "app.hpp"
+#include "ui/types.hpp"
 #include <ranges>
 #include <cstring>
+#include <algorithm>
 
 namespace npshop::usb {
 namespace {
 
 constexpr u64 TRANSFER_ALIGN = 0x1000;
-constexpr u64 TRANSFER_MAX = 1024*1024*16;
-static_assert(!(TRANSFER_MAX % TRANSFER_ALIGN));
+// transfers larger than this are split and queued, so that the next part
+// is already posted by the time the current part completes.
+constexpr u64 TRANSFER_SLOT_SIZE = 1024*1024*2;
+constexpr u64 TRANSFER_MAX = TRANSFER_SLOT_SIZE * TRANSFER_QUEUE_DEPTH;
+static_assert(!(TRANSFER_SLOT_SIZE % TRANSFER_ALIGN));
+
+constexpr u64 STATS_LOG_NS = 1e+9 * 5;
+constexpr Result Result_TransferPending = MAKERESULT(Module_Libnx, LibnxError_NotFound);
 
 } // namespace
 
@@ -56,11 +64,22 @@ Result Base::TransferPacketImpl(bool read, void *page, u32 remaining, u32 size,
     const auto ep = read ? UsbSessionEndpoint_Out : UsbSessionEndpoint_In;
     R_TRY(TransferAsync(ep, page, remaining, size, std::addressof(xfer_id)));
 
-    /* Try to wait for the event. */
-    R_TRY(WaitTransferCompletion(ep, timeout));
+    /* Wait for the transfer and return what we transferred. */
+    return WaitForTransfer(ep, xfer_id, out_size_transferred, timeout);
+}
+
+// transfers on an endpoint complete in the order they were posted, however
+// several completions can be signalled by a single event, so the result is
+// checked before waiting.
+Result Base::WaitForTransfer(UsbSessionEndpoint ep, u32 xfer_id, u32 *out_size_transferred, u64 timeout) {
+    while (true) {
+        const auto rc = GetTransferResult(ep, xfer_id, nullptr, out_size_transferred);
+        if (rc != Result_TransferPending) {
+            return rc;
+        }
 
-    /* Return what we transferred. */
-    return GetTransferResult(ep, xfer_id, nullptr, out_size_transferred);
+        R_TRY(WaitTransferCompletion(ep, timeout));
+    }
 }
 
 // while it may seem like a bad idea to transfer data to a buffer and copy it
@@ -76,7 +95,10 @@ Result Base::TransferAll(bool read, void *data, u32 size, u64 timeout) {
     auto transfer_buf = *m_aligned;
 
     R_UNLESS(!((u64)transfer_buf & 0xFFF), Result_UsbBadBufferAlign);
-    R_UNLESS(size <= TRANSFER_MAX, Result_UsbBadTransferSize);
+
+    if (size > TRANSFER_SLOT_SIZE) {
+        return TransferQueued(read, buf, size, timeout);
+    }
 
     while (size) {
         if (!read) {
@@ -99,6 +121,78 @@ Result Base::TransferAll(bool read, void *data, u32 size, u64 timeout) {
     R_SUCCEED();
 }
 
+// splits the transfer into slots, keeping up to TRANSFER_QUEUE_DEPTH posted
+// so that the controller isn't left idle whilst the previous slot is copied.
+Result Base::TransferQueued(bool read, u8* buf, u32 size, u64 timeout) {
+    struct Slot {
+        u8* buf;
+        u32 size;
+        u32 xfer_id;
+    };
+
+    TimeStamp ts;
+    R_TRY(IsUsbConnected(timeout));
+    const auto ep = read ? UsbSessionEndpoint_Out : UsbSessionEndpoint_In;
+
+    Slot slots[TRANSFER_QUEUE_DEPTH];
+    u32 head{}; // oldest posted slot.
+    u32 count{}; // number of posted slots.
+    u32 posted{}; // bytes posted.
+    u32 done{}; // bytes transferred.
+
+    while (done < size) {
+        while (count < TRANSFER_QUEUE_DEPTH && posted < size) {
+            const auto index = (head + count) % TRANSFER_QUEUE_DEPTH;
+            const auto remaining = size - posted;
+            auto& slot = slots[index];
+            slot.buf = *m_aligned + index * TRANSFER_SLOT_SIZE;
+            slot.size = std::min<u32>(remaining, TRANSFER_SLOT_SIZE);
+
+            // the zlt is set per endpoint rather than per transfer, so the last
+            // write isn't posted until the writes before it have completed.
+            if (!read && count && slot.size == remaining) {
+                break;
+            }
+
+            if (!read) {
+                std::memcpy(slot.buf, buf + posted, slot.size);
+            }
+
+            R_TRY(TransferAsync(ep, slot.buf, remaining, slot.size, &slot.xfer_id));
+            posted += slot.size;
+            count++;
+        }
+
+        auto& slot = slots[head];
+        u32 out_size_transferred;
+        R_TRY(WaitForTransfer(ep, slot.xfer_id, &out_size_transferred, timeout));
+        R_UNLESS(out_size_transferred > 0, Result_UsbEmptyTransferSize);
+        R_UNLESS(out_size_transferred <= slot.size, Result_UsbOverflowTransferSize);
+
+        if (read) {
+            std::memcpy(buf + done, slot.buf, out_size_transferred);
+        } else {
+            // the writes after it are already posted, so it can't be resent.
+            R_UNLESS(out_size_transferred == slot.size, Result_UsbEmptyTransferSize);
+        }
+
+        // a short read, the rest of the data is in the reads after it.
+        posted -= slot.size - out_size_transferred;
+        done += out_size_transferred;
+        head = (head + 1) % TRANSFER_QUEUE_DEPTH;
+        count--;
+    }
+
+    m_stats_bytes += size;
+    m_stats_ns += ts.GetNs();
+    if (m_stats_ns >= STATS_LOG_NS) {
+        log_write("[USB] queue depth: %u speed: %.2f MiB/s\n", TRANSFER_QUEUE_DEPTH, (double)m_stats_bytes / (1024.0 * 1024.0) / ((double)m_stats_ns / 1e+9));
+        m_stats_bytes = m_stats_ns = 0;
+    }
+
+    R_SUCCEED();
+}
+
 } // namespace npshop::usb
 
 #endif
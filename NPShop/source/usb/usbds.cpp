@@ -5,6 +5,8 @@
 #include "defines.hpp"
 #include <ranges>
 #include <cstring>
+#include <span>
+#include <algorithm>
 
 Result usbDsGetSpeed(UsbDeviceSpeed *out) {
     if (hosversionBefore(8,0,0)) {
@@ -53,6 +55,9 @@ constexpr u16 DEVICE_SPEED[] = {
     [UsbDeviceSpeed_Super] = 0x400,
 };
 
+// urb_status of a transfer in the report, anything lower is still pending.
+constexpr u32 URB_STATUS_COMPLETED = 0x3;
+
 } // namespace
 
 UsbDs::~UsbDs() {
@@ -338,6 +343,17 @@ Result UsbDs::GetTransferResult(UsbSessionEndpoint ep, u32 urb_id, u32 *out_requ
 
     R_TRY(eventClear(GetCompletionEvent(ep)));
     R_TRY(usbDsEndpoint_GetReportData(m_endpoints[ep], std::addressof(report_data)));
+
+    // the report also contains transfers that are still pending.
+    const auto count = std::min<u32>(report_data.report_count, std::size(report_data.report));
+    const auto it = std::ranges::find_if(std::span{report_data.report, count}, [urb_id](const auto& e) {
+        return e.id == urb_id;
+    });
+
+    if (it == report_data.report + count || it->urb_status < URB_STATUS_COMPLETED) {
+        return MAKERESULT(Module_Libnx, LibnxError_NotFound);
+    }
+
     R_TRY(usbDsParseReportData(std::addressof(report_data), urb_id, out_requested_size, out_transferred_size));
 
     R_SUCCEED();
@@ -5,6 +5,7 @@
 #include "defines.hpp"
 #include <ranges>
 #include <cstring>
+#include <algorithm>
 
 namespace npshop::usb {
 namespace {
@@ -133,10 +134,10 @@ Result UsbHs::Connect() {
     }
 
     auto& input_descs = m_s.inf.inf.input_endpoint_descs[0];
-    R_TRY(usbHsIfOpenUsbEp(&m_s, &m_endpoints[UsbSessionEndpoint_Out], 1, input_descs.wMaxPacketSize, &input_descs));
+    R_TRY(usbHsIfOpenUsbEp(&m_s, &m_endpoints[UsbSessionEndpoint_Out], TRANSFER_QUEUE_DEPTH, input_descs.wMaxPacketSize, &input_descs));
 
     auto& output_descs = m_s.inf.inf.output_endpoint_descs[0];
-    R_TRY(usbHsIfOpenUsbEp(&m_s, &m_endpoints[UsbSessionEndpoint_In], 1, output_descs.wMaxPacketSize, &output_descs));
+    R_TRY(usbHsIfOpenUsbEp(&m_s, &m_endpoints[UsbSessionEndpoint_In], TRANSFER_QUEUE_DEPTH, output_descs.wMaxPacketSize, &output_descs));
 
     m_connected = true;
     R_SUCCEED();
@@ -149,6 +150,8 @@ void UsbHs::Close() {
 
     m_endpoints[UsbSessionEndpoint_In] = {};
     m_endpoints[UsbSessionEndpoint_Out] = {};
+    m_reports[UsbSessionEndpoint_In].clear();
+    m_reports[UsbSessionEndpoint_Out].clear();
     m_s = {};
     m_connected = false;
 }
@@ -179,6 +182,7 @@ Result UsbHs::WaitTransferCompletion(UsbSessionEndpoint ep, u64 timeout) {
 
     if (R_FAILED(rc)) {
         log_write("failed to wait for event\n");
+        m_reports[ep].clear();
         eventClear(GetCompletionEvent(ep));
         eventClear(usbHsGetInterfaceStateChangeEvent());
     }
@@ -190,13 +194,35 @@ Result UsbHs::TransferAsync(UsbSessionEndpoint ep, void *buffer, u32 remaining,
     return usbHsEpPostBufferAsync(&m_endpoints[ep], buffer, size, 0, out_xfer_id);
 }
 
+// reports are removed once fetched, so the reports of other transfers that
+// are still queued are kept until they're asked for.
 Result UsbHs::GetTransferResult(UsbSessionEndpoint ep, u32 xfer_id, u32 *out_requested_size, u32 *out_transferred_size) {
-    u32 count;
-    UsbHsXferReport report_data[8];
+    auto& reports = m_reports[ep];
 
-    R_TRY(eventClear(GetCompletionEvent(ep)));
-    R_TRY(usbHsEpGetXferReport(&m_endpoints[ep], report_data, std::size(report_data), std::addressof(count)));
-    R_TRY(usbHsParseReportData(report_data, count, xfer_id, out_requested_size, out_transferred_size));
+    const auto find = [&reports, xfer_id]() {
+        return std::ranges::find_if(reports, [xfer_id](const auto& e) {
+            return e.xferId == xfer_id;
+        });
+    };
+
+    auto it = find();
+    if (it == reports.end()) {
+        u32 count;
+        UsbHsXferReport report_data[8];
+
+        R_TRY(eventClear(GetCompletionEvent(ep)));
+        R_TRY(usbHsEpGetXferReport(&m_endpoints[ep], report_data, std::size(report_data), std::addressof(count)));
+        reports.insert(reports.end(), report_data, report_data + std::min<u32>(count, std::size(report_data)));
+
+        it = find();
+        if (it == reports.end()) {
+            return MAKERESULT(Module_Libnx, LibnxError_NotFound);
+        }
+    }
+
+    auto report = *it;
+    reports.erase(it);
+    R_TRY(usbHsParseReportData(&report, 1, xfer_id, out_requested_size, out_transferred_size));
 
     R_SUCCEED();
 }
@@ -0,0 +1,79 @@
+#include "yati/nx/crypto.hpp"
+#include "log.hpp"
+#include <cstring>
+
+namespace npshop::crypto {
+namespace {
+
+// key and plaintext are from NIST SP 800-38A F.5.1 (CTR-AES128).
+// the counter is changed to fit the nca layout (nonce + big endian block number),
+// the ciphertext was generated with openssl using the counter below.
+constexpr u8 CTR_KEY[0x10]{
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+
+constexpr u8 CTR_NONCE[0x8]{
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+};
+
+// block number 0x0001020304050607.
+constexpr u64 CTR_OFFSET = 0x0001020304050607ULL << 4;
+
+constexpr u8 CTR_PLAIN[0x40]{
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+};
+
+constexpr u8 CTR_CIPHER[0x40]{
+    0x05, 0x7b, 0xa7, 0x1b, 0x75, 0xb6, 0x18, 0x11, 0x4f, 0x9b, 0xe5, 0x4c, 0xe3, 0x7e, 0x9b, 0xa4,
+    0xb5, 0x39, 0xf3, 0x70, 0xe7, 0x78, 0x38, 0x72, 0x85, 0xc5, 0x37, 0x39, 0x1a, 0xbe, 0xc1, 0xb0,
+    0x09, 0x7d, 0xf0, 0x2f, 0x54, 0xe3, 0xbb, 0x69, 0x90, 0x72, 0x96, 0xae, 0xfc, 0xbf, 0x9e, 0x5f,
+    0xf6, 0x5c, 0x0d, 0x73, 0xa2, 0x28, 0xe4, 0xb0, 0xda, 0x08, 0x58, 0x1b, 0xf1, 0x00, 0xde, 0x97,
+};
+
+// runs [start, start + size) of the vector, split into 2 calls at split.
+auto CheckCtrRange(Aes128Ctr& ctr, u64 start, u64 size, u64 split) -> bool {
+    u8 out[sizeof(CTR_PLAIN)]{};
+    ctr.Run(out, CTR_PLAIN + start, split);
+    ctr.Run(out + split, CTR_PLAIN + start + split, size - split);
+
+    if (ctr.GetOffset() != CTR_OFFSET + start + size) {
+        log_write("[crypto] aes-ctr bad offset at: 0x%lX size: 0x%lX\n", start, size);
+        return false;
+    }
+
+    if (std::memcmp(out, CTR_CIPHER + start, size)) {
+        log_write("[crypto] aes-ctr mismatch at: 0x%lX size: 0x%lX\n", start, size);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+auto Aes128CtrSelfTest() -> bool {
+    // whole vector from the start of a block.
+    Aes128Ctr ctr{CTR_KEY, CTR_NONCE, CTR_OFFSET};
+    if (!CheckCtrRange(ctr, 0, sizeof(CTR_PLAIN), sizeof(CTR_PLAIN))) {
+        return false;
+    }
+
+    // seek back to the middle of a block, then read across the next block boundary.
+    ctr.Seek(CTR_OFFSET + 0x13);
+    if (!CheckCtrRange(ctr, 0x13, 0x1A, 0x1A)) {
+        return false;
+    }
+
+    // start mid-block, split the read mid-block.
+    Aes128Ctr ctr2{CTR_KEY, CTR_NONCE, CTR_OFFSET + 0x25};
+    if (!CheckCtrRange(ctr2, 0x25, sizeof(CTR_PLAIN) - 0x25, 0x7)) {
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace npshop::crypto
@@ -0,0 +1,183 @@
+#include "yati/source/http.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <curl/curl.h>
+
+namespace npshop::yati::source {
+namespace {
+
+#define CURL_EASY_SETOPT_LOG(handle, opt, v) \
+    if (auto r = curl_easy_setopt(handle, opt, v); r != CURLE_OK) { \
+        log_write("[HTTP] curl_easy_setopt(%s, %s) msg: %s\n", #opt, #v, curl_easy_strerror(r)); \
+    } \
+
+// size of each request for sequential reads (nca data).
+// yati reads in 4MiB chunks, so this covers 2 reads per request.
+constexpr s64 READ_AHEAD_SIZE = 1024 * 1024 * 8;
+
+// minimum size of each request for non-sequential reads, such as
+// reading the container header, tickets and the nca header.
+constexpr s64 MIN_READ_SIZE = 1024 * 64;
+
+struct WriteData {
+    u8* buf;
+    s64 offset;
+    s64 size;
+};
+
+auto WriteCallback(void* contents, size_t size, size_t num_files, void* userp) -> size_t {
+    auto data = static_cast<WriteData*>(userp);
+    const auto realsize = size * num_files;
+
+    // the server sent more than was requested, this happens if the range was ignored.
+    if (data->offset + realsize > data->size) {
+        log_write("[HTTP] server sent more data than requested: %zd vs %zd\n", data->offset + realsize, data->size);
+        return 0;
+    }
+
+    std::memcpy(data->buf + data->offset, contents, realsize);
+    data->offset += realsize;
+    return realsize;
+}
+
+// parses "Content-Range: bytes 0-0/1234" for the total size of the file.
+auto GetContentRangeSize(const curl::Header& header) -> s64 {
+    s64 size{};
+    if (const auto it = header.Find("content-range"); it != header.m_map.cend()) {
+        const auto slash = it->second.find_last_of('/');
+        if (slash != it->second.npos) {
+            std::sscanf(it->second.c_str() + slash + 1, "%ld", &size);
+        }
+    }
+
+    return size;
+}
+
+} // namespace
+
+Http::Http(const std::string& url) : m_url{url} {
+    m_api = curl::Api{curl::Url{url}, m_stop_source.get_token()};
+    m_curl = curl_easy_init();
+    if (!m_curl) {
+        m_open_result = Result_CurlFailedEasyInit;
+        return;
+    }
+
+    m_open_result = GetContentLength();
+}
+
+Http::~Http() {
+    if (m_curl) {
+        curl_easy_cleanup(m_curl);
+    }
+}
+
+Result Http::GetContentLength() {
+    // request the first byte, this checks that the server supports range
+    // requests as well as returning the total size in the Content-Range.
+    u8 dummy;
+    R_TRY(RangeRequest(&dummy, 0, 1, &m_size));
+    R_UNLESS(m_size > 0, Result_HttpBadContentLength);
+
+    log_write("[HTTP] got content length: %zd url: %s\n", m_size, m_url.c_str());
+    R_SUCCEED();
+}
+
+Result Http::RangeRequest(void* buf, s64 off, s64 size, s64* content_length) {
+    R_UNLESS(!m_stop_source.stop_requested(), Result_TransferCancelled);
+
+    char range[64];
+    std::snprintf(range, sizeof(range), "%ld-%ld", off, off + size - 1);
+
+    WriteData write_data{static_cast<u8*>(buf), 0, size};
+    curl::Header header{};
+
+    // resetting the handle does not close the connection, it will be re-used.
+    curl_easy_reset(m_curl);
+    curl::SetupHandle(m_curl, m_api);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_URL, m_url.c_str());
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_RANGE, range);
+    // the range would be of the compressed data, so don't ask for it.
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_ACCEPT_ENCODING, (const char*)nullptr);
+
+    // abort if the connection stalls, rather than blocking the install forever.
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_CONNECTTIMEOUT, 30L);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_LOW_SPEED_TIME, 30L);
+
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_HEADERFUNCTION, curl::HeaderCallback);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_HEADERDATA, &header);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    CURL_EASY_SETOPT_LOG(m_curl, CURLOPT_WRITEDATA, &write_data);
+
+    const auto res = curl_easy_perform(m_curl);
+
+    long http_code = 0;
+    curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+    if (res != CURLE_OK) {
+        log_write("[HTTP] failed range: %s code: %ld msg: %s\n", range, http_code, curl_easy_strerror(res));
+        R_UNLESS(!m_stop_source.stop_requested(), Result_TransferCancelled);
+        R_THROW(Result_HttpFailedRequest);
+    }
+
+    // 200 means the server ignored the range and sent the entire file.
+    R_UNLESS(http_code == 206, Result_HttpRangeNotSupported);
+    R_UNLESS(write_data.offset == size, Result_HttpBadReadSize);
+
+    if (content_length) {
+        *content_length = GetContentRangeSize(header);
+    }
+
+    R_SUCCEED();
+}
+
+Result Http::Fill(s64 off, s64 size, bool sequential) {
+    const auto request_size = std::min(std::max(size, sequential ? READ_AHEAD_SIZE : MIN_READ_SIZE), m_size - off);
+
+    m_buffer.resize(request_size);
+    m_buffer_off = off;
+
+    const auto rc = RangeRequest(m_buffer.data(), off, request_size);
+    if (R_FAILED(rc)) {
+        // invalidate the window so that a retry doesn't read stale data.
+        m_buffer.clear();
+    }
+
+    return rc;
+}
+
+Result Http::Read(void* _buf, s64 off, s64 size, u64* bytes_read) {
+    R_TRY(GetOpenResult());
+
+    auto buf = static_cast<u8*>(_buf);
+    *bytes_read = 0;
+
+    const auto sequential = off && off == m_last_read_end;
+    size = std::min(size, m_size - off);
+
+    while (size > 0) {
+        // fetch more data if the offset is outside of the window.
+        if (off < m_buffer_off || off >= m_buffer_off + (s64)m_buffer.size()) {
+            R_TRY(Fill(off, size, sequential));
+        }
+
+        const auto buf_off = off - m_buffer_off;
+        const auto copy_size = std::min<s64>(size, m_buffer.size() - buf_off);
+        std::memcpy(buf, m_buffer.data() + buf_off, copy_size);
+
+        *bytes_read += copy_size;
+        buf += copy_size;
+        off += copy_size;
+        size -= copy_size;
+    }
+
+    m_last_read_end = off;
+    R_SUCCEED();
+}
+
+} // namespace npshop::yati::source
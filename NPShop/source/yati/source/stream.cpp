@@ -1,8 +1,15 @@
 #include "yati/source/stream.hpp"
 #include "defines.hpp"
 #include "log.hpp"
+#include <algorithm>
 
 namespace npshop::yati::source {
+namespace {
+
+// skipped data is read in chunks of this size, rather than all at once.
+constexpr u64 SKIP_BUFFER_SIZE = 1024 * 64;
+
+} // namespace
 
 Result Stream::Read(void* _buf, s64 off, s64 size, u64* bytes_read_out) {
     // streams don't allow for random access (seeking backwards).
@@ -15,14 +22,12 @@ Result Stream::Read(void* _buf, s64 off, s64 size, u64* bytes_read_out) {
     while (size) {
         // while it is invalid to seek backwards, it is valid to seek forwards.
         // this can be done to skip padding, skip undeeded files etc.
-        // to handle this, simply read the data into a buffer and discard it.
         if (off > m_offset) {
-            const auto skip_size = off - m_offset;
-            std::vector<u8> temp_buf(skip_size);
-            u64 bytes_read;
-            R_TRY(ReadChunk(temp_buf.data(), temp_buf.size(), &bytes_read));
+            u64 bytes_skipped;
+            R_TRY(Skip(off - m_offset, &bytes_skipped));
+            R_UNLESS(bytes_skipped, Result_StreamBadSeek);
 
-            m_offset += bytes_read;
+            m_offset += bytes_skipped;
         } else {
             u64 bytes_read;
             R_TRY(ReadChunk(buf, size, &bytes_read));
@@ -38,4 +43,12 @@ Result Stream::Read(void* _buf, s64 off, s64 size, u64* bytes_read_out) {
     R_SUCCEED();
 }
 
+Result Stream::Skip(s64 size, u64* bytes_skipped) {
+    if (m_skip_buf.empty()) {
+        m_skip_buf.resize(SKIP_BUFFER_SIZE);
+    }
+
+    return ReadChunk(m_skip_buf.data(), std::min<s64>(size, m_skip_buf.size()), bytes_skipped);
+}
+
 } // namespace npshop::yati::source
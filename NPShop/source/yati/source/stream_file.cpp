@@ -1,10 +1,14 @@
 #include "yati/source/stream_file.hpp"
 #include "log.hpp"
+#include <algorithm>
 
 namespace npshop::yati::source {
 
 StreamFile::StreamFile(fs::Fs* fs, const fs::FsPath& path) : m_fs{fs} {
     m_open_result = m_fs->OpenFile(path, FsOpenMode_Read, std::addressof(m_file));
+    if (R_SUCCEEDED(m_open_result)) {
+        m_open_result = m_file.GetSize(&m_size);
+    }
 }
 
 Result StreamFile::ReadChunk(void* buf, s64 size, u64* bytes_read) {
@@ -14,4 +18,13 @@ Result StreamFile::ReadChunk(void* buf, s64 size, u64* bytes_read) {
     return rc;
 }
 
+// files can be seeked, so the skipped data is never read.
+Result StreamFile::Skip(s64 size, u64* bytes_skipped) {
+    R_TRY(GetOpenResult());
+    size = std::min(size, m_size - m_offset);
+    m_offset += size;
+    *bytes_skipped = size;
+    R_SUCCEED();
+}
+
 } // namespace npshop::yati::source
@@ -4,21 +4,35 @@
 #include "yati/source/usb.hpp"
 #include "usb/tinfoil.hpp"
 #include "log.hpp"
+#include "defines.hpp"
 #include <ranges>
+#include <algorithm>
+#include <cstring>
 
 namespace npshop::yati::source {
 namespace {
 
 namespace tinfoil = usb::tinfoil;
 
+// number of reads requested ahead of the one being read.
+constexpr u32 READ_AHEAD_DEPTH = 2;
+// max requests that haven't been replied to, ncas can be read in parallel.
+constexpr u32 MAX_INFLIGHT = 4;
+// max data kept that was received before it was read, the oldest is dropped
+// if reads don't go as predicted.
+constexpr u32 MAX_CHUNKS = 4;
+
 } // namespace
 
 Usb::Usb(u64 transfer_timeout) {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_send);
     m_usb = std::make_unique<usb::UsbDs>(transfer_timeout);
     m_open_result = m_usb->Init();
 }
 
 Usb::~Usb() {
+    StopSender();
 }
 
 Result Usb::WaitForConnection(u64 timeout, std::vector<std::string>& out_names) {
@@ -45,11 +59,24 @@ Result Usb::WaitForConnection(u64 timeout, std::vector<std::string>& out_names)
 
     R_UNLESS(!out_names.empty(), Result_UsbBadCount);
     log_write("USB SUCCESS\n");
+
+    // random access reads are pipelined, stream mode has to be read in order.
+    if (!IsStream()) {
+        StartSender();
+    }
+
     R_SUCCEED();
 }
 
 void Usb::SetFileNameForTranfser(const std::string& name) {
+    // the host replies to requests for the previous file first.
+    if (const auto rc = Drain(); R_FAILED(rc)) {
+        log_write("[USB] failed to drain requests: 0x%X\n", rc);
+    }
+
+    SCOPED_MUTEX(&m_mutex);
     m_transfer_file_name = name;
+    m_hints.clear();
 }
 
 Result Usb::SendCmdHeader(u32 cmdId, size_t dataSize, u64 timeout) {
@@ -60,27 +87,58 @@ Result Usb::SendCmdHeader(u32 cmdId, size_t dataSize, u64 timeout) {
         .dataSize = dataSize,
     };
 
-    return m_usb->TransferAll(false, &header, sizeof(header), timeout);
+    return SendPacket(&header, sizeof(header), timeout);
 }
 
-Result Usb::SendFileRangeCmd(u64 off, u64 size, u64 timeout) {
+Result Usb::SendFileRangeCmd(const std::string& name, u64 off, u64 size, u64 timeout) {
     tinfoil::FileRangeCmdHeader fRangeHeader;
     fRangeHeader.size = size;
     fRangeHeader.offset = off;
-    fRangeHeader.nspNameLen = m_transfer_file_name.size();
+    fRangeHeader.nspNameLen = name.size();
     fRangeHeader.padding = 0;
 
     R_TRY(SendCmdHeader(tinfoil::USBCmdId::FILE_RANGE, sizeof(fRangeHeader) + fRangeHeader.nspNameLen, timeout));
-    R_TRY(m_usb->TransferAll(false, &fRangeHeader, sizeof(fRangeHeader), timeout));
-    R_TRY(m_usb->TransferAll(false, m_transfer_file_name.data(), fRangeHeader.nspNameLen, timeout));
+    R_TRY(SendPacket(&fRangeHeader, sizeof(fRangeHeader), timeout));
+    R_TRY(SendPacket(name.data(), fRangeHeader.nspNameLen, timeout));
+
+    R_SUCCEED();
+}
+
+Result Usb::SendPacket(const void* data, u32 size, u64 timeout) {
+    R_UNLESS(size <= sizeof(m_page), Result_UsbBadTransferSize);
+
+    auto buf = static_cast<const u8*>(data);
+    while (size) {
+        std::memcpy(m_page, buf, size);
+
+        u32 out_size_transferred;
+        R_TRY(m_usb->TransferPacketImpl(false, m_page, size, size, &out_size_transferred, timeout));
+        R_UNLESS(out_size_transferred > 0, Result_UsbEmptyTransferSize);
+        R_UNLESS(out_size_transferred <= size, Result_UsbOverflowTransferSize);
+
+        buf += out_size_transferred;
+        size -= out_size_transferred;
+    }
+
+    R_SUCCEED();
+}
+
+Result Usb::ReceiveFileRange(void* buf, s64 size, u64 timeout) {
+    R_TRY(m_send_result.load());
 
     tinfoil::USBCmdHeader responseHeader;
     R_TRY(m_usb->TransferAll(true, &responseHeader, sizeof(responseHeader), timeout));
+    R_TRY(m_usb->TransferAll(true, buf, size, timeout));
 
     R_SUCCEED();
 }
 
 Result Usb::Finished(u64 timeout) {
+    if (const auto rc = Drain(); R_FAILED(rc)) {
+        log_write("[USB] failed to drain requests: 0x%X\n", rc);
+    }
+    StopSender();
+
     log_write("[USB] sending finished command\n");
     return SendCmdHeader(tinfoil::USBCmdId::EXIT, 0, timeout);
 }
@@ -91,12 +149,255 @@ bool Usb::IsStream() const {
 
 Result Usb::Read(void* buf, s64 off, s64 size, u64* bytes_read) {
     R_TRY(GetOpenResult());
-    R_TRY(SendFileRangeCmd(off, size, m_usb->GetTransferTimeout()));
-    R_TRY(m_usb->TransferAll(true, buf, size));
+
+    if (m_thread_started) {
+        if (const auto rc = ReadPipelined(static_cast<u8*>(buf), off, size); R_FAILED(rc)) {
+            // replies can no longer be matched to requests.
+            m_inflight.clear();
+            m_chunks.clear();
+            return rc;
+        }
+    } else {
+        R_TRY(SendFileRangeCmd(m_transfer_file_name, off, size, m_usb->GetTransferTimeout()));
+        R_TRY(ReceiveFileRange(buf, size, m_usb->GetTransferTimeout()));
+    }
+
     *bytes_read = size;
     R_SUCCEED();
 }
 
+void Usb::HintSequentialRead(s64 off, s64 size) {
+    SCOPED_MUTEX(&m_mutex);
+    m_hints.emplace_back(off, size);
+}
+
+// a chunk is received before the oldest is dropped, so there can be one more.
+u64 Usb::GetReadAheadMemory(s64 read_size) const {
+    if (IsStream()) {
+        return 0;
+    }
+
+    return (MAX_CHUNKS + 1) * read_size;
+}
+
+// the next requests are queued before waiting for this one, so the host
+// can start sending the next reply as soon as it's finished with this one,
+// rather than waiting for a round trip between each read.
+Result Usb::ReadPipelined(u8* buf, s64 off, s64 size) {
+    QueueReadAhead(off, size);
+
+    while (size) {
+        // data that was received before it was read.
+        if (const auto n = TakeChunk(buf, off, size)) {
+            buf += n;
+            off += n;
+            size -= n;
+            continue;
+        }
+
+        if (!IsQueued(off)) {
+            Queue(off, size);
+        }
+
+        // replies are in the order they were requested, so anything
+        // requested before this range is kept for later.
+        const auto req = m_inflight.front();
+        m_inflight.pop_front();
+
+        if (req.off == off && req.size <= size) {
+            R_TRY(ReceiveFileRange(buf, req.size, m_usb->GetTransferTimeout()));
+            buf += req.size;
+            off += req.size;
+            size -= req.size;
+        } else {
+            Chunk chunk{req.off};
+            chunk.data.resize(req.size);
+            R_TRY(ReceiveFileRange(chunk.data.data(), req.size, m_usb->GetTransferTimeout()));
+            m_chunks.emplace_back(std::move(chunk));
+
+            if (m_chunks.size() > MAX_CHUNKS) {
+                m_chunks.erase(m_chunks.begin());
+            }
+        }
+    }
+
+    R_SUCCEED();
+}
+
+// copies the data at off if it was already received, returns the size copied.
+auto Usb::TakeChunk(u8* buf, s64 off, s64 size) -> s64 {
+    const auto it = std::ranges::find_if(m_chunks, [off](const auto& e) {
+        return off >= e.off && off < e.off + (s64)e.data.size();
+    });
+
+    if (it == m_chunks.end()) {
+        return 0;
+    }
+
+    const auto end = it->off + (s64)it->data.size();
+    const auto n = std::min(size, end - off);
+    std::memcpy(buf, it->data.data() + (off - it->off), n);
+
+    // reads are in order, so the chunk won't be read again once the end is reached.
+    if (off + n == end) {
+        m_chunks.erase(it);
+    }
+
+    return n;
+}
+
+void Usb::Queue(s64 off, s64 size) {
+    m_inflight.emplace_back(off, size);
+
+    SCOPED_MUTEX(&m_mutex);
+    m_send_queue.emplace_back(off, size);
+    condvarWakeOne(&m_can_send);
+}
+
+// queues the read at off, and the READ_AHEAD_DEPTH reads after it,
+// as long as they are within a range that was hinted to be read in order.
+void Usb::QueueReadAhead(s64 off, s64 size) {
+    s64 end;
+    {
+        SCOPED_MUTEX(&m_mutex);
+        const auto it = std::ranges::find_if(m_hints, [off](const auto& e) {
+            return off >= e.off && off < e.off + e.size;
+        });
+
+        if (it == m_hints.end()) {
+            return;
+        }
+
+        end = it->off + it->size;
+    }
+
+    for (u32 i = 0; i <= READ_AHEAD_DEPTH && off < end && m_inflight.size() < MAX_INFLIGHT; i++) {
+        const auto n = std::min(size, end - off);
+        if (!IsQueued(off) && !std::ranges::any_of(m_chunks, [off](const auto& e) { return off >= e.off && off < e.off + (s64)e.data.size(); })) {
+            Queue(off, n);
+        }
+
+        off += n;
+    }
+}
+
+auto Usb::IsQueued(s64 off) const -> bool {
+    return std::ranges::any_of(m_inflight, [off](const auto& e) {
+        return off >= e.off && off < e.off + e.size;
+    });
+}
+
+// reads and discards every reply that hasn't been read yet.
+Result Usb::Drain() {
+    m_chunks.clear();
+
+    std::vector<u8> buf;
+    while (!m_inflight.empty()) {
+        const auto req = m_inflight.front();
+        m_inflight.pop_front();
+
+        buf.resize(req.size);
+        if (const auto rc = ReceiveFileRange(buf.data(), req.size, m_usb->GetTransferTimeout()); R_FAILED(rc)) {
+            m_inflight.clear();
+            return rc;
+        }
+    }
+
+    R_SUCCEED();
+}
+
+void Usb::StartSender() {
+    if (m_thread_started) {
+        return;
+    }
+
+    m_running = true;
+    m_send_result = 0;
+    if (R_FAILED(threadCreate(&m_thread, SenderThreadFunc, this, nullptr, 1024*32, PRIO_PREEMPTIVE, 2))) {
+        log_write("[USB] failed to create sender, reads won't be pipelined\n");
+        return;
+    }
+
+    if (R_FAILED(threadStart(&m_thread))) {
+        log_write("[USB] failed to start sender, reads won't be pipelined\n");
+        threadClose(&m_thread);
+        return;
+    }
+
+    m_thread_started = true;
+}
+
+// the sender and the reader share the cancel event, which is cleared by the
+// first transfer that sees it, so each Cancel() only wakes one of them.
+// this is fine as long as the other is woken by the result:
+// - StopSender() is only called from the reader's thread, so only the sender can be waiting.
+// - if the sender fails, it cancels the reader, as the reply will never arrive.
+// - if a cancel from the ui is taken by the sender, it fails and cancels the reader.
+// - if it's taken by the reader, the sender is cancelled here once the reader stops.
+void Usb::StopSender() {
+    if (!m_thread_started) {
+        return;
+    }
+
+    bool sending;
+    {
+        SCOPED_MUTEX(&m_mutex);
+        m_running = false;
+        sending = m_sending;
+        condvarWakeAll(&m_can_send);
+    }
+
+    // the host won't read the request until the replies before it are read.
+    if (sending) {
+        m_usb->Cancel();
+    }
+
+    threadWaitForExit(&m_thread);
+    threadClose(&m_thread);
+    m_thread_started = false;
+    m_send_queue.clear();
+    m_inflight.clear();
+    m_chunks.clear();
+}
+
+void Usb::SenderThreadFunc(void* p) {
+    static_cast<Usb*>(p)->SenderLoop();
+}
+
+void Usb::SenderLoop() {
+    while (true) {
+        Request req;
+        std::string name;
+        {
+            SCOPED_MUTEX(&m_mutex);
+            m_sending = false;
+            while (m_running && m_send_queue.empty()) {
+                condvarWait(&m_can_send, &m_mutex);
+            }
+
+            if (!m_running) {
+                break;
+            }
+
+            req = m_send_queue.front();
+            m_send_queue.pop_front();
+            name = m_transfer_file_name;
+            m_sending = true;
+        }
+
+        if (const auto rc = SendFileRangeCmd(name, req.off, req.size, m_usb->GetTransferTimeout()); R_FAILED(rc)) {
+            log_write("[USB] failed to send file range: 0x%X\n", rc);
+            m_send_result = rc;
+            // wake up the reader, as the reply will never arrive.
+            m_usb->Cancel();
+
+            SCOPED_MUTEX(&m_mutex);
+            m_sending = false;
+            break;
+        }
+    }
+}
+
 } // namespace npshop::yati::source
 
 #endif
@@ -16,6 +16,10 @@
 #include "app.hpp"
 #include "i18n.hpp"
 #include "log.hpp"
+#include "spsc_ring.hpp"
+#include "buffer_pool.hpp"
+#include "threaded_file_transfer.hpp"
+#include "transfer_stats.hpp"
 
 #include <zstd.h>
 #include <minIni.h>
@@ -44,6 +48,9 @@ struct NcaCollection : container::CollectionEntry {
     bool modified{};
     // set if the nca was not installed.
     bool skipped{};
+    // set if the header needs converting once the ticket has been read.
+    // only happens with stream installs, as the ticket may come after the nca.
+    bool pending_crypto{};
 };
 
 struct CnmtCollection : NcaCollection {
@@ -53,6 +60,10 @@ struct CnmtCollection : NcaCollection {
     // if set, the ticket / cert will be installed once all nca's have installed.
     std::vector<FsRightsId> rights_id{};
 
+    // set once the cnmt has been installed, stream installs use this to skip ncas early.
+    bool skip_install{};
+    u32 latest_version_num{};
+
     NcmContentMetaHeader meta_header{};
     NcmContentMetaKey key{};
     NcmContentInfo content_info{};
@@ -72,75 +83,205 @@ struct TikCollection {
     bool required{};
     // set if ticket has already been patched.
     bool patched{};
+    // set once the ticket data has been read, stream installs read it when it's reached.
+    bool read{};
 };
 
 struct Yati;
 
 const u64 INFLATE_BUFFER_MAX = 1024*1024*4;
 
-struct ThreadBuffer {
-    ThreadBuffer() {
-        buf.reserve(INFLATE_BUFFER_MAX);
+// ncz blocks are independent zstd frames, so they can be decompressed in parallel.
+// blocks are pushed in order by the decompress thread and popped in the same order,
+// so the output can be re-encrypted and written as if it were decompressed in order.
+struct NczBlockPool {
+    // only use the pool for blocks up to this size, as each slot holds
+    // the compressed and decompressed block.
+    static constexpr u8 MAX_BLOCK_SIZE_EXPONENT = 22; // 4MiB
+    static constexpr u32 WORKER_COUNT = 3;
+    // allows for workers to keep going whilst waiting for the oldest block.
+    static constexpr u32 MAX_JOBS = WORKER_COUNT * 2;
+
+    struct Job {
+        std::vector<u8> in{};
+        std::vector<u8> out{};
+        Result result{};
+        bool compressed{};
+        bool done{};
+    };
+
+    struct Worker {
+        NczBlockPool* pool{};
+        Thread thread{};
+        bool created{};
+        bool started{};
+    };
+
+    NczBlockPool(std::atomic<u64>& _zstd_ns) : zstd_ns{_zstd_ns} {
+        mutexInit(std::addressof(mutex));
+        condvarInit(std::addressof(can_work));
+        condvarInit(std::addressof(can_pop));
+        condvarInit(std::addressof(can_push));
     }
 
-    std::vector<u8> buf;
-    s64 off;
-};
+    ~NczBlockPool() {
+        Close();
+    }
 
-template<std::size_t Size>
-struct RingBuf {
-private:
-    ThreadBuffer buf[Size]{};
-    unsigned r_index{};
-    unsigned w_index{};
+    Result Create() {
+        running = true;
 
-    static_assert((sizeof(RingBuf::buf) & (sizeof(RingBuf::buf) - 1)) == 0, "Must be power of 2!");
+        for (u32 i = 0; i < WORKER_COUNT; i++) {
+            auto& worker = workers[i];
+            worker.pool = this;
+            R_TRY(threadCreate(&worker.thread, WorkerFunc, std::addressof(worker), nullptr, 1024*64, PRIO_PREEMPTIVE, i));
+            worker.created = true;
+            R_TRY(threadStart(&worker.thread));
+            worker.started = true;
+        }
 
-public:
-    void ringbuf_reset() {
-        this->r_index = this->w_index;
+        R_SUCCEED();
     }
 
-    unsigned ringbuf_capacity() const {
-        return sizeof(this->buf) / sizeof(this->buf[0]);
+    void Close() {
+        mutexLock(std::addressof(mutex));
+        running = false;
+        condvarWakeAll(std::addressof(can_work));
+        mutexUnlock(std::addressof(mutex));
+
+        for (auto& worker : workers) {
+            if (worker.started) {
+                threadWaitForExit(&worker.thread);
+                worker.started = false;
+            }
+            if (worker.created) {
+                threadClose(&worker.thread);
+                worker.created = false;
+            }
+        }
     }
 
-    unsigned ringbuf_size() const {
-        return (this->w_index - this->r_index) % (ringbuf_capacity() * 2U);
+    auto IsEmpty() -> bool {
+        SCOPED_MUTEX(std::addressof(mutex));
+        return head == tail;
     }
 
-    unsigned ringbuf_free() const {
-        return ringbuf_capacity() - ringbuf_size();
+    auto IsFull() -> bool {
+        SCOPED_MUTEX(std::addressof(mutex));
+        return tail - head == MAX_JOBS;
     }
 
-    void ringbuf_push(std::vector<u8>& buf_in, s64 off_in) {
-        auto& value = this->buf[this->w_index % ringbuf_capacity()];
-        value.off = off_in;
-        std::swap(value.buf, buf_in);
+    // swaps the buffer with the one in the job, so buffers are re-used.
+    void Push(std::vector<u8>& in, s64 decompressed_size, bool compressed) {
+        SCOPED_MUTEX(std::addressof(mutex));
+        while (tail - head == MAX_JOBS) {
+            condvarWait(std::addressof(can_push), std::addressof(mutex));
+        }
+
+        auto& job = jobs[tail % MAX_JOBS];
+        std::swap(job.in, in);
+        job.out.resize(decompressed_size);
+        job.compressed = compressed;
+        job.done = false;
+        job.result = 0;
+        tail++;
 
-        this->w_index = (this->w_index + 1U) % (ringbuf_capacity() * 2U);
+        condvarWakeOne(std::addressof(can_work));
     }
 
-    void ringbuf_pop(std::vector<u8>& buf_out, s64& off_out) {
-        auto& value = this->buf[this->r_index % ringbuf_capacity()];
-        off_out = value.off;
-        std::swap(value.buf, buf_out);
+    // pops the oldest job, if wait is false, this only pops if the job is done.
+    Result Pop(std::vector<u8>& out, bool wait, bool& popped) {
+        SCOPED_MUTEX(std::addressof(mutex));
+        popped = false;
 
-        this->r_index = (this->r_index + 1U) % (ringbuf_capacity() * 2U);
+        if (head == tail) {
+            R_SUCCEED();
+        }
+
+        auto& job = jobs[head % MAX_JOBS];
+        if (!job.done && !wait) {
+            R_SUCCEED();
+        }
+
+        while (!job.done) {
+            condvarWait(std::addressof(can_pop), std::addressof(mutex));
+        }
+
+        R_TRY(job.result);
+        std::swap(job.out, out);
+        head++;
+        popped = true;
+
+        condvarWakeOne(std::addressof(can_push));
+        R_SUCCEED();
     }
-};
 
-struct ThreadData {
-    ThreadData(Yati* _yati, std::span<TikCollection> _tik, NcaCollection* _nca)
-    : yati{_yati}, tik{_tik}, nca{_nca} {
-        mutexInit(std::addressof(read_mutex));
-        mutexInit(std::addressof(write_mutex));
+private:
+    static void WorkerFunc(void* p) {
+        auto worker = static_cast<Worker*>(p);
+        auto pool = worker->pool;
+
+        auto dctx = ZSTD_createDCtx();
+        ON_SCOPE_EXIT(ZSTD_freeDCtx(dctx));
 
-        condvarInit(std::addressof(can_read));
-        condvarInit(std::addressof(can_decompress));
-        condvarInit(std::addressof(can_decompress_write));
-        condvarInit(std::addressof(can_write));
+        for (;;) {
+            mutexLock(std::addressof(pool->mutex));
+            while (pool->running && pool->next_work == pool->tail) {
+                condvarWait(std::addressof(pool->can_work), std::addressof(pool->mutex));
+            }
 
+            if (!pool->running) {
+                mutexUnlock(std::addressof(pool->mutex));
+                break;
+            }
+
+            // the slot isn't touched by anyone else until it's marked as done.
+            auto& job = pool->jobs[pool->next_work % MAX_JOBS];
+            pool->next_work++;
+            mutexUnlock(std::addressof(pool->mutex));
+
+            Result rc{};
+            if (!job.compressed) {
+                std::swap(job.out, job.in);
+            } else {
+                ScopedStatsTimer timer{pool->zstd_ns};
+                const auto res = ZSTD_decompressDCtx(dctx, job.out.data(), job.out.size(), job.in.data(), job.in.size());
+                if (ZSTD_isError(res) || res != job.out.size()) {
+                    log_write("[NCZ] ZSTD_decompressDCtx() size: %zu res: %zd msg: %s\n", job.in.size(), res, ZSTD_isError(res) ? ZSTD_getErrorName(res) : "bad size");
+                    rc = Result_YatiInvalidNczZstdError;
+                }
+            }
+
+            mutexLock(std::addressof(pool->mutex));
+            job.result = rc;
+            job.done = true;
+            condvarWakeOne(std::addressof(pool->can_pop));
+            mutexUnlock(std::addressof(pool->mutex));
+        }
+    }
+
+private:
+    Mutex mutex{};
+    CondVar can_work{};
+    CondVar can_pop{};
+    CondVar can_push{};
+
+    Job jobs[MAX_JOBS]{};
+    Worker workers[WORKER_COUNT]{};
+
+    // indices are ever increasing, the slot is the index modulo MAX_JOBS.
+    u32 head{};
+    u32 tail{};
+    u32 next_work{};
+    bool running{};
+
+    // shared by all workers.
+    std::atomic<u64>& zstd_ns;
+};
+
+struct ThreadData {
+    ThreadData(Yati* _yati, TransferStats& _stats, std::span<TikCollection> _tik, NcaCollection* _nca)
+    : yati{_yati}, stats{_stats}, tik{_tik}, nca{_nca} {
         ueventCreate(&m_uevent_done, false);
         ueventCreate(&m_uevent_progres, true);
 
@@ -156,11 +297,20 @@ struct ThreadData {
         }
 
         max_buffer_size = std::max(read_buffer_size, INFLATE_BUFFER_MAX);
+
+        read_buffers.Reserve(yati->buffer_pool);
+        write_buffers.Reserve(yati->buffer_pool);
     }
 
+    ~ThreadData();
+
     auto GetResults() volatile -> Result;
     void WakeAllThreads();
 
+    // buffers are taken from the install wide pool, see Yati::buffer_pool.
+    void AcquireBuf(std::vector<u8>& buf);
+    void ReleaseBuf(std::vector<u8>& buf);
+
     auto IsAnyRunning() volatile const -> bool {
         return read_running || decompress_result || write_running;
     }
@@ -204,92 +354,58 @@ struct ThreadData {
 
     Result SetDecompressBuf(std::vector<u8>& buf, s64 off, s64 size) {
         buf.resize(size);
+        R_TRY(GetResults());
 
-        mutexLock(std::addressof(read_mutex));
-        if (!read_buffers.ringbuf_free()) {
-            if (!write_running) {
-                R_SUCCEED();
-            }
-            R_TRY(condvarWait(std::addressof(can_read), std::addressof(read_mutex)));
+        // fails if the decompress thread has exited, GetResults() will report why.
+        {
+            ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Read).full_ns};
+            read_buffers.Push(buf, off);
         }
-
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
-        R_TRY(GetResults());
-        read_buffers.ringbuf_push(buf, off);
-        return condvarWakeOne(std::addressof(can_decompress));
+        AcquireBuf(buf);
+        return GetResults();
     }
 
     Result GetDecompressBuf(std::vector<u8>& buf_out, s64& off_out) {
-        mutexLock(std::addressof(read_mutex));
-        if (!read_buffers.ringbuf_size()) {
-            if (!read_running) {
-                buf_out.resize(0);
-                R_SUCCEED();
-            }
-            R_TRY(condvarWait(std::addressof(can_decompress), std::addressof(read_mutex)));
+        ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Decompress).empty_ns};
+        // fails once the read thread has exited and all data has been popped.
+        if (!read_buffers.Pop(buf_out, off_out)) {
+            buf_out.resize(0);
         }
-
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
-        R_TRY(GetResults());
-        read_buffers.ringbuf_pop(buf_out, off_out);
-        return condvarWakeOne(std::addressof(can_read));
+        return GetResults();
     }
 
-    Result SetWriteBuf(std::vector<u8>& buf, s64 size, bool skip_verify) {
+    Result SetWriteBuf(std::vector<u8>& buf, s64 size) {
         buf.resize(size);
-        if (!skip_verify) {
-            sha256ContextUpdate(std::addressof(sha256), buf.data(), buf.size());
-        }
-
-        mutexLock(std::addressof(write_mutex));
-        if (!write_buffers.ringbuf_free()) {
-            if (!decompress_running) {
-                R_SUCCEED();
-            }
-            R_TRY(condvarWait(std::addressof(can_decompress_write), std::addressof(write_mutex)));
-        }
-
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
         R_TRY(GetResults());
-        write_buffers.ringbuf_push(buf, 0);
-        return condvarWakeOne(std::addressof(can_write));
+        stats.GetStage(TransferStats::Stage_Decompress).bytes += size;
+        {
+            ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Decompress).full_ns};
+            write_buffers.Push(buf, 0);
+        }
+        AcquireBuf(buf);
+        return GetResults();
     }
 
     Result GetWriteBuf(std::vector<u8>& buf_out, s64& off_out) {
-        mutexLock(std::addressof(write_mutex));
-        if (!write_buffers.ringbuf_size()) {
-            if (!decompress_running) {
-                buf_out.resize(0);
-                R_SUCCEED();
-            }
-            R_TRY(condvarWait(std::addressof(can_write), std::addressof(write_mutex)));
+        ScopedStatsTimer timer{stats.GetStage(TransferStats::Stage_Write).empty_ns};
+        if (!write_buffers.Pop(buf_out, off_out)) {
+            buf_out.resize(0);
         }
-
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
-        R_TRY(GetResults());
-        write_buffers.ringbuf_pop(buf_out, off_out);
-        return condvarWakeOne(std::addressof(can_decompress_write));
+        return GetResults();
     }
 
     // these need to be copied
     Yati* yati{};
+    TransferStats& stats;
     std::span<TikCollection> tik{};
     NcaCollection* nca{};
 
     // these need to be created
-    Mutex read_mutex{};
-    Mutex write_mutex{};
-
-    CondVar can_read{};
-    CondVar can_decompress{};
-    CondVar can_decompress_write{};
-    CondVar can_write{};
-
     UEvent m_uevent_done{};
     UEvent m_uevent_progres{};
 
-    RingBuf<4> read_buffers{};
-    RingBuf<4> write_buffers{};
+    SpscRing<4> read_buffers{};
+    SpscRing<4> write_buffers{};
 
     ncz::BlockHeader ncz_block_header{};
     std::vector<ncz::Section> ncz_sections{};
@@ -320,9 +436,17 @@ struct Yati {
     ~Yati();
 
     Result Setup(const ConfigOverride& override);
-    Result InstallNca(std::span<TikCollection> tickets, NcaCollection& nca);
-    Result InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection& nca);
+    // if progress is set, the progress box is not updated, the caller should do so with the progress.
+    Result InstallNca(std::span<TikCollection> tickets, NcaCollection& nca, std::atomic<s64>* progress = nullptr);
+    Result InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection& nca, std::atomic<s64>* progress);
+    // installs several ncas at once if the source supports it, otherwise one after another.
+    Result InstallNcas(std::span<TikCollection> tickets, std::span<NcaCollection> ncas);
     Result InstallCnmtNca(std::span<TikCollection> tickets, CnmtCollection& cnmt, const container::Collections& collections);
+    Result ConvertNcaCrypto(nca::Header& header, TikCollection* ticket);
+    // stream installs only, see NcaCollection::pending_crypto.
+    Result ConvertPendingNca(std::span<TikCollection> tickets, NcaCollection& nca);
+    // stream installs only, reads the data of a skipped nca and throws it away.
+    Result DiscardNca(const NcaCollection& nca);
 
     Result readFuncInternal(ThreadData* t);
     Result decompressFuncInternal(ThreadData* t);
@@ -352,10 +476,38 @@ struct Yati {
     std::unique_ptr<container::Base> container{};
     Config config{};
     keys::Keys keys{};
+
+    // shared by every nca, so the buffers allocated for the first nca are re-used.
+    BufferPool buffer_pool{"yati", INFLATE_BUFFER_MAX};
+
+    // used when installing several ncas at once.
+    // the source is only read from one thread at a time.
+    Mutex read_mutex{};
+    // tickets are shared between ncas.
+    Mutex ticket_mutex{};
+    // set if any nca fails, so that the others stop.
+    std::atomic<Result> abort_result{};
+
+    // totals for every nca in the install, shown in the progress box.
+    TransferStats stats{"install"};
 };
 
+ThreadData::~ThreadData() {
+    read_buffers.Release(yati->buffer_pool);
+    write_buffers.Release(yati->buffer_pool);
+}
+
+void ThreadData::AcquireBuf(std::vector<u8>& buf) {
+    yati->buffer_pool.AcquireIfEmpty(buf);
+}
+
+void ThreadData::ReleaseBuf(std::vector<u8>& buf) {
+    yati->buffer_pool.Release(buf);
+}
+
 auto ThreadData::GetResults() volatile -> Result {
     R_TRY(yati->pbox->ShouldExitResult());
+    R_TRY(yati->abort_result.load());
     R_TRY(read_result.load());
     R_TRY(decompress_result.load());
     R_TRY(write_result.load());
@@ -363,22 +515,19 @@ auto ThreadData::GetResults() volatile -> Result {
 }
 
 void ThreadData::WakeAllThreads() {
-    condvarWakeAll(std::addressof(can_read));
-    condvarWakeAll(std::addressof(can_decompress));
-    condvarWakeAll(std::addressof(can_decompress_write));
-    condvarWakeAll(std::addressof(can_write));
-
-    mutexUnlock(std::addressof(read_mutex));
-    mutexUnlock(std::addressof(write_mutex));
+    read_buffers.Close();
+    write_buffers.Close();
 }
 
 Result ThreadData::Read(void* buf, s64 size, u64* bytes_read) {
     size = std::min<s64>(size, nca->size - read_offset);
+    SCOPED_MUTEX(std::addressof(yati->read_mutex));
     const auto rc = yati->source->Read(buf, nca->offset + read_offset, size, bytes_read);
     R_TRY(rc);
 
     R_UNLESS(size == *bytes_read, Result_YatiInvalidNcaReadSize);
     read_offset += *bytes_read;
+    stats.GetStage(TransferStats::Stage_Read).bytes += *bytes_read;
     return rc;
 }
 
@@ -434,18 +583,24 @@ Result HasRequiredTicket(const nca::Header& header, std::span<TikCollection> tik
 // read thread reads all data from the source, it also handles
 // parsing ncz headers, sections and reading ncz blocks
 Result Yati::readFuncInternal(ThreadData* t) {
-    ON_SCOPE_EXIT( t->read_running = false; );
+    ON_SCOPE_EXIT( t->read_running = false; t->read_buffers.Close(); );
+
+    // the nca is read in order from start to finish.
+    source->HintSequentialRead(t->nca->offset + t->read_offset, t->nca->size - t->read_offset);
 
     // the main buffer which data is read into.
     std::vector<u8> buf;
+    t->AcquireBuf(buf);
+    ON_SCOPE_EXIT(t->ReleaseBuf(buf));
+
     // workaround ncz block reading ahead. if block isn't found, we usually
     // would seek back to the offset, however this is not possible in stream
     // mode, so we instead store the data to the temp buffer and pre-pend it.
-    std::vector<u8> temp_buf;
-    buf.reserve(t->max_buffer_size);
-    temp_buf.reserve(t->max_buffer_size);
+    u8 temp_buf[sizeof(ncz::BlockHeader)];
+    s64 temp_buf_size{};
 
     while (t->read_offset < t->nca->size && R_SUCCEEDED(t->GetResults())) {
+        ScopedStatsTimer timer{t->stats.GetStage(TransferStats::Stage_Read).running_ns};
         const auto buffer_offset = t->read_offset.load();
 
         // read more data
@@ -454,16 +609,16 @@ Result Yati::readFuncInternal(ThreadData* t) {
             read_size = NCZ_SECTION_OFFSET;
         }
 
-        s64 buf_offset = 0;
-        if (!temp_buf.empty()) {
-            buf = temp_buf;
-            read_size -= temp_buf.size();
-            buf_offset = temp_buf.size();
-            temp_buf.clear();
+        const s64 buf_offset = temp_buf_size;
+        read_size -= temp_buf_size;
+        buf.resize(buf_offset + read_size);
+
+        if (temp_buf_size) {
+            std::memcpy(buf.data(), temp_buf, temp_buf_size);
+            temp_buf_size = 0;
         }
 
         u64 bytes_read{};
-        buf.resize(buf_offset + read_size);
         R_TRY(t->Read(buf.data() + buf_offset, read_size, std::addressof(bytes_read)));
         auto buf_size = buf_offset + bytes_read;
         if (!bytes_read) {
@@ -488,9 +643,9 @@ Result Yati::readFuncInternal(ThreadData* t) {
                 R_TRY(t->Read(std::addressof(t->ncz_block_header), sizeof(t->ncz_block_header), std::addressof(bytes_read)));
                 if (t->ncz_block_header.magic != NCZ_BLOCK_MAGIC) {
                     // didn't find block, keep the data we just read in the temp buffer.
-                    temp_buf.resize(sizeof(t->ncz_block_header));
-                    std::memcpy(temp_buf.data(), std::addressof(t->ncz_block_header), temp_buf.size());
-                    log_write("storing temp data of size: %zu\n", temp_buf.size());
+                    temp_buf_size = sizeof(t->ncz_block_header);
+                    std::memcpy(temp_buf, std::addressof(t->ncz_block_header), temp_buf_size);
+                    log_write("storing temp data of size: %zd\n", temp_buf_size);
                 } else {
                     // validate block header.
                     R_UNLESS(t->ncz_block_header.version == 0x2, Result_YatiInvalidNczBlockVersion);
@@ -519,10 +674,9 @@ Result Yati::readFuncInternal(ThreadData* t) {
     R_SUCCEED();
 }
 
-// decompress thread handles decrypting / modifying the nca header, decompressing ncz
-// and calculating the running sha256.
+// decompress thread handles decrypting / modifying the nca header and decompressing ncz.
 Result Yati::decompressFuncInternal(ThreadData* t) {
-    ON_SCOPE_EXIT( t->decompress_running = false; );
+    ON_SCOPE_EXIT( t->decompress_running = false; t->read_buffers.Close(); t->write_buffers.Close(); );
 
     // only used for ncz files.
     auto dctx = ZSTD_createDCtx();
@@ -532,32 +686,32 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
     const ncz::BlockInfo* ncz_block{};
     bool is_ncz{};
 
+    // only used for ncz files with blocks, decompresses the blocks in parallel.
+    std::unique_ptr<NczBlockPool> block_pool{};
+    std::vector<u8> block_in{};
+    std::vector<u8> block_out{};
+
+    // the inflate buffer never grows past INFLATE_BUFFER_MAX, it is flushed
+    // as soon as it's full, so the whole buffer can be swapped to the write thread.
     s64 inflate_offset{};
-    Aes128CtrContext ctx{};
+    crypto::Aes128Ctr ctr{};
     std::vector<u8> inflate_buf{};
-    inflate_buf.reserve(t->max_buffer_size);
+    t->AcquireBuf(inflate_buf);
+    ON_SCOPE_EXIT(t->ReleaseBuf(inflate_buf));
 
     s64 written{};
     s64 block_offset{};
     std::vector<u8> buf{};
-    buf.reserve(t->max_buffer_size);
+    t->AcquireBuf(buf);
+    ON_SCOPE_EXIT(t->ReleaseBuf(buf));
 
     // encrypts the nca and passes the buffer to the write thread.
-    const auto ncz_flush = [&](s64 size) -> Result {
+    const auto ncz_flush = [&]() -> Result {
         if (!inflate_offset) {
             R_SUCCEED();
         }
 
-        // if we are not moving the whole vector, then we need to keep
-        // the remaining data.
-        // rather that copying the entire vector to the write thread,
-        // only copy (store) the remaining amount.
-        std::vector<u8> temp_vector{};
-        if (size < inflate_offset) {
-            temp_vector.resize(inflate_offset - size);
-            std::memcpy(temp_vector.data(), inflate_buf.data() + size, temp_vector.size());
-        }
-
+        const auto size = inflate_offset;
         for (s64 off = 0; off < size;) {
             if (!ncz_section || !ncz_section->InRange(written)) {
                 log_write("[NCZ] looking for new section: %zu\n", written);
@@ -570,11 +724,7 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 log_write("[NCZ] found new section: %zu\n", written);
 
                 if (ncz_section->crypto_type >= nca::EncryptionType_AesCtr) {
-                    const auto swp = std::byteswap(u64(written) >> 4);
-                    u8 counter[0x16];
-                    std::memcpy(counter + 0x0, ncz_section->counter, 0x8);
-                    std::memcpy(counter + 0x8, &swp, 0x8);
-                    aes128CtrContextCreate(&ctx, ncz_section->key, counter);
+                    ctr = crypto::Aes128Ctr{ncz_section->key, ncz_section->counter, u64(written)};
                 }
             }
 
@@ -582,26 +732,57 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
             const auto chunk_size = std::min<u64>(total_size - written, size - off);
 
             if (ncz_section->crypto_type >= nca::EncryptionType_AesCtr) {
-                aes128CtrCrypt(&ctx, inflate_buf.data() + off, inflate_buf.data() + off, chunk_size);
+                ScopedStatsTimer timer{t->stats.aes_ns};
+                ctr.Run(inflate_buf.data() + off, inflate_buf.data() + off, chunk_size);
             }
 
             written += chunk_size;
             off += chunk_size;
         }
 
-        R_TRY(t->SetWriteBuf(inflate_buf, size, config.skip_nca_hash_verify));
-        inflate_offset -= size;
+        R_TRY(t->SetWriteBuf(inflate_buf, size));
+        inflate_offset = 0;
+
+        R_SUCCEED();
+    };
+
+    // copies decompressed data into the inflate buffer, flushing whenever it fills up.
+    const auto ncz_copy = [&](const u8* data, s64 size) -> Result {
+        while (size > 0) {
+            const auto copy_size = std::min<s64>(size, INFLATE_BUFFER_MAX - inflate_offset);
+            inflate_buf.resize(inflate_offset + copy_size);
+            std::memcpy(inflate_buf.data() + inflate_offset, data, copy_size);
+
+            t->decompress_offset += copy_size;
+            inflate_offset += copy_size;
+            data += copy_size;
+            size -= copy_size;
+
+            if (inflate_offset >= INFLATE_BUFFER_MAX) {
+                R_TRY(ncz_flush());
+            }
+        }
+
+        R_SUCCEED();
+    };
+
+    // moves decompressed blocks from the pool to the inflate buffer, in order.
+    // if wait is set, this blocks until the oldest block is done.
+    const auto ncz_collect = [&](bool wait) -> Result {
+        for (bool popped = true; popped; wait = false) {
+            R_TRY(block_pool->Pop(block_out, wait, popped));
+            if (!popped) {
+                break;
+            }
 
-        // restore remaining data to the swapped buffer.
-        if (!temp_vector.empty()) {
-            log_write("[NCZ] storing data size: %zu\n", temp_vector.size());
-            inflate_buf = temp_vector;
+            R_TRY(ncz_copy(block_out.data(), block_out.size()));
         }
 
         R_SUCCEED();
     };
 
     while (t->decompress_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
+        ScopedStatsTimer timer{t->stats.GetStage(TransferStats::Stage_Decompress).running_ns};
         s64 decompress_buf_off{};
         R_TRY(t->GetDecompressBuf(buf, decompress_buf_off));
         if (buf.empty()) {
@@ -612,6 +793,17 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
         if (!is_ncz && !t->ncz_sections.empty()) {
             log_write("YES IT FOUND NCZ\n");
             is_ncz = true;
+
+            if (!t->ncz_blocks.empty() && t->ncz_block_header.block_size_exponent <= NczBlockPool::MAX_BLOCK_SIZE_EXPONENT) {
+                block_pool = std::make_unique<NczBlockPool>(t->stats.zstd_ns);
+                if (R_FAILED(block_pool->Create())) {
+                    log_write("[NCZ] failed to create block pool, using single thread\n");
+                    block_pool.reset();
+                } else {
+                    log_write("[NCZ] using block pool, blocks: %zu\n", t->ncz_blocks.size());
+                    block_in.reserve(1 << t->ncz_block_header.block_size_exponent);
+                }
+            }
         }
 
         // if we don't have a ncz or it's before the ncz header, pass buffer directly to write
@@ -647,54 +839,72 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 }
 
                 // try and get the ticket, if the nca requires it.
+                SCOPED_MUTEX(std::addressof(ticket_mutex));
                 auto ticket = GetTicketCollection(header, t->tik);
                 R_TRY(HasRequiredTicket(header, ticket));
 
                 if ((config.convert_to_standard_crypto && ticket) || config.lower_master_key) {
-                    t->nca->modified = true;
-                    u8 keak_generation;
+                    if (ticket && !ticket->read) {
+                        // stream install reached the nca before the ticket, patch the header later.
+                        log_write("ticket not read yet, converting once it has been\n");
+                        t->nca->pending_crypto = true;
+                    } else {
+                        t->nca->modified = true;
+                        R_TRY(ConvertNcaCrypto(header, ticket));
+                    }
+                }
 
-                    if (ticket) {
-                        const auto key_gen = header.key_gen;
-                        log_write("converting to standard crypto: 0x%X 0x%X\n", key_gen, header.key_gen);
+                if (t->nca->modified) {
+                    crypto::cryptoAes128Xts(std::addressof(header), buf.data(), keys.header_key, 0, 0x200, sizeof(header), true);
+                }
+            }
 
-                        // fetch ticket data block.
-                        es::TicketData ticket_data;
-                        R_TRY(es::GetTicketData(ticket->ticket, std::addressof(ticket_data)));
+            written += buf.size();
+            t->decompress_offset += buf.size();
+            R_TRY(t->SetWriteBuf(buf, buf.size()));
+        } else if (block_pool) {
+            // gather the compressed data of each block, then pass the whole block to the pool.
+            u64 buf_off{};
+            while (buf_off < buf.size()) {
+                if (!ncz_block || !ncz_block->InRange(decompress_buf_off)) {
+                    block_offset = 0;
+                    auto it = std::ranges::find_if(t->ncz_blocks, [decompress_buf_off](auto& e){
+                        return e.InRange(decompress_buf_off);
+                    });
+
+                    R_UNLESS(it != t->ncz_blocks.cend(), Result_YatiNczBlockNotFound);
+                    ncz_block = &(*it);
+                }
 
-                        // validate that this indeed the correct ticket.
-                        R_UNLESS(!std::memcmp(std::addressof(header.rights_id), std::addressof(ticket_data.rights_id), sizeof(header.rights_id)), Result_YatiInvalidTicketBadRightsId);
+                const auto size = std::min<u64>(buf.size() - buf_off, ncz_block->size - block_offset);
+                block_in.insert(block_in.end(), buf.data() + buf_off, buf.data() + buf_off + size);
 
-                        // decrypt title key.
-                        keys::KeyEntry title_key;
-                        R_TRY(es::GetTitleKey(title_key, ticket_data, keys));
-                        R_TRY(es::DecryptTitleKey(title_key, key_gen, keys));
+                buf_off += size;
+                decompress_buf_off += size;
+                block_offset += size;
 
-                        std::memset(header.key_area, 0, sizeof(header.key_area));
-                        std::memcpy(&header.key_area[0x2], &title_key, sizeof(title_key));
+                if (block_offset == ncz_block->size) {
+                    const s64 block_size = s64(1) << t->ncz_block_header.block_size_exponent;
+                    s64 decompressed_size = block_size;
 
-                        keak_generation = key_gen;
-                        ticket->required = false;
-                    } else if (config.lower_master_key) {
-                        R_TRY(nca::DecryptKeak(keys, header));
+                    // https://github.com/nicoboss/nsz/issues/79
+                    if (ncz_block == &t->ncz_blocks.back()) {
+                        if (const auto remainder = t->ncz_block_header.decompressed_size % block_size) {
+                            decompressed_size = remainder;
+                        }
                     }
 
-                    if (config.lower_master_key) {
-                        keak_generation = 0;
+                    // make space in the pool by collecting the oldest block.
+                    if (block_pool->IsFull()) {
+                        R_TRY(ncz_collect(true));
                     }
 
-                    R_TRY(nca::EncryptKeak(keys, header, keak_generation));
-                    std::memset(&header.rights_id, 0, sizeof(header.rights_id));
-                }
+                    block_pool->Push(block_in, decompressed_size, (s64)ncz_block->size < decompressed_size);
+                    block_in.clear();
 
-                if (t->nca->modified) {
-                    crypto::cryptoAes128Xts(std::addressof(header), buf.data(), keys.header_key, 0, 0x200, sizeof(header), true);
+                    R_TRY(ncz_collect(false));
                 }
             }
-
-            written += buf.size();
-            t->decompress_offset += buf.size();
-            R_TRY(t->SetWriteBuf(buf, buf.size(), config.skip_nca_hash_verify));
         } else if (is_ncz) {
             u64 buf_off{};
             while (buf_off < buf.size()) {
@@ -734,34 +944,34 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 if (compressed) {
                     log_write("[NCZ] COMPRESSED block\n");
                     ZSTD_inBuffer input = { buffer.data(), buffer.size(), 0 };
-                    while (input.pos < input.size) {
+                    // output is clipped to the space left in the inflate buffer, if the output
+                    // was filled then zstd may still have data buffered, so keep going.
+                    for (bool output_full = false; input.pos < input.size || output_full;) {
                         R_TRY(t->GetResults());
 
-                        inflate_buf.resize(inflate_offset + chunk_size);
-                        ZSTD_outBuffer output = { inflate_buf.data() + inflate_offset, chunk_size, 0 };
-                        const auto res = ZSTD_decompressStream(dctx, std::addressof(output), std::addressof(input));
+                        const auto output_size = std::min<s64>(chunk_size, INFLATE_BUFFER_MAX - inflate_offset);
+                        inflate_buf.resize(inflate_offset + output_size);
+                        ZSTD_outBuffer output = { inflate_buf.data() + inflate_offset, (size_t)output_size, 0 };
+                        size_t res;
+                        {
+                            ScopedStatsTimer timer{t->stats.zstd_ns};
+                            res = ZSTD_decompressStream(dctx, std::addressof(output), std::addressof(input));
+                        }
                         if (ZSTD_isError(res)) {
                             log_write("[NCZ] ZSTD_decompressStream() pos: %zu size: %zu res: %zd msg: %s\n", input.pos, input.size, res, ZSTD_getErrorName(res));
                         }
                         R_UNLESS(!ZSTD_isError(res), Result_YatiInvalidNczZstdError);
 
+                        output_full = output.pos == output.size;
                         t->decompress_offset += output.pos;
                         inflate_offset += output.pos;
+                        inflate_buf.resize(inflate_offset);
                         if (inflate_offset >= INFLATE_BUFFER_MAX) {
-                            log_write("[NCZ] flushing compressed data: %zd vs %zd diff: %zd\n", inflate_offset, INFLATE_BUFFER_MAX, inflate_offset - INFLATE_BUFFER_MAX);
-                            R_TRY(ncz_flush(INFLATE_BUFFER_MAX));
+                            R_TRY(ncz_flush());
                         }
                     }
                 } else {
-                    inflate_buf.resize(inflate_offset + buffer.size());
-                    std::memcpy(inflate_buf.data() + inflate_offset, buffer.data(), buffer.size());
-
-                    t->decompress_offset += buffer.size();
-                    inflate_offset += buffer.size();
-                    if (inflate_offset >= INFLATE_BUFFER_MAX) {
-                        log_write("[NCZ] flushing copy data\n");
-                        R_TRY(ncz_flush(INFLATE_BUFFER_MAX));
-                    }
+                    R_TRY(ncz_copy(buffer.data(), buffer.size()));
                 }
 
                 buf_off += buffer.size();
@@ -771,53 +981,65 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
         }
     }
 
+    // wait for the remaining blocks.
+    if (block_pool) {
+        while (!block_pool->IsEmpty()) {
+            R_TRY(t->GetResults());
+            R_TRY(ncz_collect(true));
+        }
+    }
+
     // flush remaining data.
     if (is_ncz && inflate_offset) {
         log_write("flushing remaining\n");
-        R_TRY(ncz_flush(inflate_offset));
+        R_TRY(ncz_flush());
     }
 
     log_write("decompress thread done!\n");
-
-    // get final hash output.
-    sha256ContextGetHash(std::addressof(t->sha256), t->nca->hash);
-
     R_SUCCEED();
 }
 
-// write thread writes data to the nca placeholder.
+// write thread writes data to the nca placeholder and calculates the running sha256.
+// hashing here rather than in the decompress thread leaves that core free for zstd / aes.
 Result Yati::writeFuncInternal(ThreadData* t) {
-    ON_SCOPE_EXIT( t->write_running = false; );
+    ON_SCOPE_EXIT( t->write_running = false; t->write_buffers.Close(); );
 
     std::vector<u8> buf;
-    buf.reserve(t->max_buffer_size);
-    const auto is_file_based_emummc = App::IsFileBaseEmummc();
+    t->AcquireBuf(buf);
+    ON_SCOPE_EXIT(t->ReleaseBuf(buf));
+    thread::Throttle throttle{};
 
     while (t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
+        ScopedStatsTimer timer{t->stats.GetStage(TransferStats::Stage_Write).running_ns};
         s64 dummy_off;
         R_TRY(t->GetWriteBuf(buf, dummy_off));
         if (buf.empty()) {
             break;
         }
 
+        // modified is set before the header is passed on, and the hash isn't checked if it's set.
+        if (!config.skip_nca_hash_verify && !t->nca->modified) {
+            ScopedStatsTimer timer{t->stats.sha_ns};
+            sha256ContextUpdate(std::addressof(t->sha256), buf.data(), buf.size());
+        }
+
         s64 off{};
         while (off < buf.size() && t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
             const auto wsize = std::min<s64>(t->read_buffer_size, buf.size() - off);
-            R_TRY(ncmContentStorageWritePlaceHolder(std::addressof(cs), std::addressof(t->nca->placeholder_id), t->write_offset, buf.data() + off, wsize));
+            R_TRY(throttle.Run(wsize, [&]() -> Result {
+                return ncmContentStorageWritePlaceHolder(std::addressof(cs), std::addressof(t->nca->placeholder_id), t->write_offset, buf.data() + off, wsize);
+            }));
 
             off += wsize;
             t->write_offset += wsize;
+            t->stats.GetStage(TransferStats::Stage_Write).bytes += wsize;
             ueventSignal(t->GetProgressEvent());
-
-            // todo: check how much time elapsed and sleep the diff
-            // rather than always sleeping a fixed amount.
-            // ie, writing a small buffer (nca header) should not sleep the full 2 ms.
-            if (is_file_based_emummc) {
-                svcSleepThread(2e+6); // 2ms
-            }
         }
     }
 
+    // get final hash output.
+    sha256ContextGetHash(std::addressof(t->sha256), t->nca->hash);
+
     log_write("finished write thread!\n");
     R_SUCCEED();
 }
@@ -874,10 +1096,18 @@ struct BufHelper {
 };
 
 Yati::Yati(ui::ProgressBox* _pbox, source::Base* _source) : pbox{_pbox}, source{_source} {
+    mutexInit(std::addressof(read_mutex));
+    mutexInit(std::addressof(ticket_mutex));
     App::SetAutoSleepDisabled(true);
+    pbox->SetStats(std::addressof(stats));
 }
 
 Yati::~Yati() {
+    pbox->SetStats(nullptr);
+    if (App::GetTransferStatsEnable()) {
+        stats.Save();
+    }
+
     splCryptoExit();
     serviceClose(std::addressof(ns_app));
     nsExit();
@@ -909,6 +1139,8 @@ Result Yati::Setup(const ConfigOverride& override) {
     config.convert_to_standard_crypto = override.convert_to_standard_crypto.value_or(App::GetApp()->m_convert_to_standard_crypto.Get());
     config.lower_master_key = override.lower_master_key.value_or(App::GetApp()->m_lower_master_key.Get());
     config.lower_system_version = override.lower_system_version.value_or(App::GetApp()->m_lower_system_version.Get());
+    config.max_parallel_ncas = std::clamp(App::GetApp()->m_install_parallel_ncas.Get(), 1L, 3L);
+    config.parallel_memory_budget = std::max(App::GetApp()->m_install_memory_budget.Get(), 0L) * 1024 * 1024;
     storage_id = config.sd_card_install ? NcmStorageId_SdCard : NcmStorageId_BuiltInUser;
 
     R_TRY(source->GetOpenResult());
@@ -929,7 +1161,7 @@ Result Yati::Setup(const ConfigOverride& override) {
     R_SUCCEED();
 }
 
-Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection& nca) {
+Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection& nca, std::atomic<s64>* progress) {
     if (config.skip_if_already_installed || config.ticket_only) {
         R_TRY(ncmContentStorageHas(std::addressof(cs), std::addressof(nca.skipped), std::addressof(nca.content_id)));
         if (nca.skipped) {
@@ -937,6 +1169,7 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
             R_TRY(ncmContentStorageReadContentIdFile(std::addressof(cs), std::addressof(nca.header), sizeof(nca.header), std::addressof(nca.content_id), 0));
             crypto::cryptoAes128Xts(std::addressof(nca.header), std::addressof(nca.header), keys.header_key, 0, 0x200, sizeof(nca.header), false);
 
+            SCOPED_MUTEX(std::addressof(ticket_mutex));
             R_TRY(HasRequiredTicket(nca.header, tickets));
             R_SUCCEED();
         }
@@ -948,7 +1181,7 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
     R_TRY(ncmContentStorageCreatePlaceHolder(std::addressof(cs), std::addressof(nca.content_id), std::addressof(nca.placeholder_id), nca.size));
 
     log_write("opening thread\n");
-    ThreadData t_data{this, tickets, std::addressof(nca)};
+    ThreadData t_data{this, stats, tickets, std::addressof(nca)};
 
     #define READ_THREAD_CORE 1
     #define DECOMPRESS_THREAD_CORE 2
@@ -990,7 +1223,11 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
         }
 
         if (!idx) {
-            pbox->UpdateTransfer(t_data.GetWriteOffset(), t_data.GetWriteSize());
+            if (progress) {
+                *progress = t_data.GetWriteOffset();
+            } else {
+                pbox->UpdateTransfer(t_data.GetWriteOffset(), t_data.GetWriteSize());
+            }
         } else {
             break;
         }
@@ -1039,12 +1276,24 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
     R_SUCCEED();
 }
 
-Result Yati::InstallNca(std::span<TikCollection> tickets, NcaCollection& nca) {
+Result Yati::InstallNca(std::span<TikCollection> tickets, NcaCollection& nca, std::atomic<s64>* progress) {
     log_write("in install nca\n");
-    pbox->NewTransfer(nca.name);
+    if (!progress) {
+        pbox->NewTransfer(nca.name);
+    }
     keys::parse_hex_key(std::addressof(nca.content_id), nca.name.c_str());
 
-    R_TRY(InstallNcaInternal(tickets, nca));
+    TimeStamp ts;
+    R_TRY(InstallNcaInternal(tickets, nca, progress));
+    const auto install_time = ts.GetSecondsD();
+
+    ts.Update();
+    ON_SCOPE_EXIT(
+        log_write("[NCA] %s type: %u size: %.2f MiB install: %.2fs (%.2f MiB/s) flush: %.2fs%s\n",
+            nca.name.c_str(), nca.type, (double)nca.size / 1024.0 / 1024.0,
+            install_time, (double)nca.size / 1024.0 / 1024.0 / std::max(install_time, 0.001),
+            ts.GetSecondsD(), nca.skipped ? " (skipped)" : "");
+    );
 
     fs::FsPath path;
     if (nca.skipped) {
@@ -1068,6 +1317,164 @@ Result Yati::InstallNca(std::span<TikCollection> tickets, NcaCollection& nca) {
     R_SUCCEED();
 }
 
+// rough estimate of the buffers used to install an nca.
+// each of the 3 threads holds a buffer, plus the buffers queued between them.
+auto EstimateNcaMemory(const NcaCollection& nca) -> u64 {
+    const auto queued = std::min<u64>((nca.size + INFLATE_BUFFER_MAX - 1) / INFLATE_BUFFER_MAX, 8);
+    u64 memory = (3 + queued) * INFLATE_BUFFER_MAX;
+
+    // the block size isn't known until the ncz header is read, so assume the
+    // largest block that the block pool is used for.
+    // each slot holds the compressed and decompressed block.
+    if (nca.name.ends_with(".ncz")) {
+        memory += NczBlockPool::MAX_JOBS * 2 * (1ULL << NczBlockPool::MAX_BLOCK_SIZE_EXPONENT);
+    }
+
+    return memory;
+}
+
+struct NcaJob {
+    Yati* yati{};
+    std::span<TikCollection> tickets{};
+    NcaCollection* nca{};
+    Thread thread{};
+    Result result{};
+    u64 memory{};
+    std::atomic<s64> progress{};
+    std::atomic_bool done{};
+    bool started{};
+    bool finished{};
+};
+
+void ncaJobFunc(void* d) {
+    auto job = static_cast<NcaJob*>(d);
+    job->result = job->yati->InstallNca(job->tickets, *job->nca, std::addressof(job->progress));
+    if (R_FAILED(job->result)) {
+        // stop the other ncas.
+        Result expected{};
+        job->yati->abort_result.compare_exchange_strong(expected, job->result);
+    }
+    job->done = true;
+}
+
+Result Yati::InstallNcas(std::span<TikCollection> tickets, std::span<NcaCollection> ncas) {
+    if (config.max_parallel_ncas <= 1 || ncas.size() <= 1 || !source->SupportsParallelReads()) {
+        for (auto& nca : ncas) {
+            R_TRY(InstallNca(tickets, nca));
+        }
+        R_SUCCEED();
+    }
+
+    // start the largest first, so that the small ncas are installed alongside it.
+    std::vector<NcaJob> jobs(ncas.size());
+    std::vector<u32> order(ncas.size());
+    s64 total_size{};
+    for (u32 i = 0; i < ncas.size(); i++) {
+        jobs[i].yati = this;
+        jobs[i].tickets = tickets;
+        jobs[i].nca = std::addressof(ncas[i]);
+        jobs[i].memory = EstimateNcaMemory(ncas[i]);
+        order[i] = i;
+        total_size += ncas[i].size;
+    }
+
+    std::ranges::stable_sort(order, [&ncas](u32 lhs, u32 rhs) {
+        return ncas[lhs].size > ncas[rhs].size;
+    });
+
+    // make sure that every started thread has exited, even on error.
+    ON_SCOPE_EXIT(
+        for (auto& job : jobs) {
+            if (job.started) {
+                threadWaitForExit(std::addressof(job.thread));
+                threadClose(std::addressof(job.thread));
+            }
+        }
+    );
+
+    pbox->NewTransfer("Installing NCAs"_i18n);
+    log_write("[NCA] installing %zu ncas, max parallel: %u budget: %zu MiB\n", ncas.size(), config.max_parallel_ncas, config.parallel_memory_budget / 1024 / 1024);
+
+    const auto waiter_cancel = waiterForUEvent(pbox->GetCancelEvent());
+    const TimeStamp ts;
+    u32 next{};
+    u32 running{};
+    // data that the source reads ahead is shared by all ncas.
+    u64 memory = source->GetReadAheadMemory(INFLATE_BUFFER_MAX);
+    s64 done_size{};
+    Result rc{};
+
+    for (;;) {
+        // start as many ncas as fit, at least one is always running.
+        while (R_SUCCEEDED(rc) && !pbox->ShouldExit() && next < order.size() && running < config.max_parallel_ncas) {
+            auto& job = jobs[order[next]];
+            if (running && memory + job.memory > config.parallel_memory_budget) {
+                break;
+            }
+
+            log_write("[NCA] starting %s queued: %.2fs running: %u memory: %zu MiB\n", job.nca->name.c_str(), ts.GetSecondsD(), running, (memory + job.memory) / 1024 / 1024);
+            if (R_FAILED(rc = threadCreate(std::addressof(job.thread), ncaJobFunc, std::addressof(job), nullptr, 1024*128, PRIO_PREEMPTIVE, pbox->GetCpuId()))) {
+                abort_result = rc;
+                break;
+            }
+
+            if (R_FAILED(rc = threadStart(std::addressof(job.thread)))) {
+                threadClose(std::addressof(job.thread));
+                abort_result = rc;
+                break;
+            }
+
+            job.started = true;
+
+            memory += job.memory;
+            running++;
+            next++;
+        }
+
+        if (!running) {
+            break;
+        }
+
+        // the cancel event stays signalled, so don't spin on it.
+        if (pbox->ShouldExit()) {
+            svcSleepThread(1e+7);
+        } else {
+            s32 idx;
+            waitMulti(std::addressof(idx), 1e+8, waiter_cancel);
+        }
+
+        s64 offset = done_size;
+        for (auto& job : jobs) {
+            if (!job.started || job.finished) {
+                continue;
+            }
+
+            if (job.done) {
+                threadWaitForExit(std::addressof(job.thread));
+                job.finished = true;
+                memory -= job.memory;
+                running--;
+                done_size += job.nca->size;
+                offset += job.nca->size;
+
+                if (R_FAILED(job.result) && R_SUCCEEDED(rc)) {
+                    log_write("[NCA] failed %s 0x%X\n", job.nca->name.c_str(), job.result);
+                    rc = job.result;
+                }
+            } else {
+                offset += job.progress;
+            }
+        }
+
+        pbox->UpdateTransfer(offset, total_size);
+    }
+
+    log_write("[NCA] installed %zu ncas in %.2fs\n", ncas.size(), ts.GetSecondsD());
+    R_TRY(rc);
+    R_TRY(pbox->ShouldExitResult());
+    R_SUCCEED();
+}
+
 Result Yati::InstallCnmtNca(std::span<TikCollection> tickets, CnmtCollection& cnmt, const container::Collections& collections) {
     R_TRY(InstallNca(tickets, cnmt));
 
@@ -1140,6 +1547,93 @@ Result Yati::InstallCnmtNca(std::span<TikCollection> tickets, CnmtCollection& cn
     R_SUCCEED();
 }
 
+// converts the nca to standard crypto and / or lowers the master key.
+// if the nca uses title key crypto, the ticket data must have been read.
+Result Yati::ConvertNcaCrypto(nca::Header& header, TikCollection* ticket) {
+    u8 keak_generation;
+
+    if (ticket) {
+        const auto key_gen = header.key_gen;
+        log_write("converting to standard crypto: 0x%X 0x%X\n", key_gen, header.key_gen);
+
+        // fetch ticket data block.
+        es::TicketData ticket_data;
+        R_TRY(es::GetTicketData(ticket->ticket, std::addressof(ticket_data)));
+
+        // validate that this indeed the correct ticket.
+        R_UNLESS(!std::memcmp(std::addressof(header.rights_id), std::addressof(ticket_data.rights_id), sizeof(header.rights_id)), Result_YatiInvalidTicketBadRightsId);
+
+        // decrypt title key.
+        keys::KeyEntry title_key;
+        R_TRY(es::GetTitleKey(title_key, ticket_data, keys));
+        R_TRY(es::DecryptTitleKey(title_key, key_gen, keys));
+
+        std::memset(header.key_area, 0, sizeof(header.key_area));
+        std::memcpy(&header.key_area[0x2], &title_key, sizeof(title_key));
+
+        keak_generation = key_gen;
+        ticket->required = false;
+    } else if (config.lower_master_key) {
+        R_TRY(nca::DecryptKeak(keys, header));
+    }
+
+    if (config.lower_master_key) {
+        keak_generation = 0;
+    }
+
+    R_TRY(nca::EncryptKeak(keys, header, keak_generation));
+    std::memset(&header.rights_id, 0, sizeof(header.rights_id));
+
+    R_SUCCEED();
+}
+
+Result Yati::ConvertPendingNca(std::span<TikCollection> tickets, NcaCollection& nca) {
+    log_write("converting pending nca: %s\n", nca.name.c_str());
+
+    // start from the unmodified header, same as the install did.
+    auto header = nca.header;
+    if (!config.ignore_distribution_bit && header.distribution_type == nca::DistributionType_GameCard) {
+        header.distribution_type = nca::DistributionType_System;
+    }
+
+    auto ticket = GetTicketCollection(header, tickets);
+    R_UNLESS(ticket && ticket->read, Result_YatiTicketNotFound);
+    R_TRY(ConvertNcaCrypto(header, ticket));
+
+    // only the header changes, so patch it in place.
+    crypto::cryptoAes128Xts(std::addressof(header), std::addressof(header), keys.header_key, 0, 0x200, sizeof(header), true);
+    R_TRY(ncmContentStorageWritePlaceHolder(std::addressof(cs), std::addressof(nca.placeholder_id), 0, std::addressof(header), sizeof(header)));
+    R_TRY(ncmContentStorageFlushPlaceHolder(std::addressof(cs)));
+
+    nca.pending_crypto = false;
+    nca.modified = true;
+    R_SUCCEED();
+}
+
+Result Yati::DiscardNca(const NcaCollection& nca) {
+    log_write("discarding nca: %s size: %zd\n", nca.name.c_str(), nca.size);
+    pbox->NewTransfer(nca.name);
+
+    std::vector<u8> buf;
+    buffer_pool.Acquire(buf);
+    ON_SCOPE_EXIT(buffer_pool.Release(buf));
+    buf.resize(buffer_pool.GetBufferSize());
+
+    for (s64 off = 0; off < nca.size;) {
+        R_TRY(pbox->ShouldExitResult());
+
+        const auto size = std::min<s64>(buf.size(), nca.size - off);
+        u64 bytes_read;
+        R_TRY(source->Read(buf.data(), nca.offset + off, size, &bytes_read));
+        R_UNLESS(bytes_read, Result_StreamBadSeek);
+
+        off += bytes_read;
+        pbox->UpdateTransfer(off, nca.size);
+    }
+
+    R_SUCCEED();
+}
+
 Result Yati::ParseTicketsIntoCollection(std::vector<TikCollection>& tickets, const container::Collections& collections, bool read_data) {
     for (const auto& collection : collections) {
         if (collection.name.ends_with(".tik")) {
@@ -1160,6 +1654,7 @@ Result Yati::ParseTicketsIntoCollection(std::vector<TikCollection>& tickets, con
                 u64 bytes_read;
                 R_TRY(source->Read(entry.ticket.data(), collection.offset, entry.ticket.size(), &bytes_read));
                 R_TRY(source->Read(entry.cert.data(), cert->offset, entry.cert.size(), &bytes_read));
+                entry.read = true;
             }
 
             tickets.emplace_back(entry);
@@ -1422,9 +1917,7 @@ Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const contai
         }
 
         log_write("installing nca's\n");
-        for (auto& nca : cnmt.ncas) {
-            R_TRY(yati->InstallNca(tickets, nca));
-        }
+        R_TRY(yati->InstallNcas(tickets, cnmt.ncas));
 
         R_TRY(yati->ImportTickets(tickets));
         R_TRY(yati->RemoveInstalledNcas(cnmt));
@@ -1439,11 +1932,6 @@ Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, contai
     auto yati = std::make_unique<Yati>(pbox, source);
     R_TRY(yati->Setup(override));
 
-    // not supported with stream installs (yet).
-    yati->config.skip_if_already_installed = false;
-    yati->config.convert_to_standard_crypto = false;
-    yati->config.lower_master_key = false;
-
     std::vector<NcaCollection> ncas{};
     std::vector<CnmtCollection> cnmts{};
     std::vector<TikCollection> tickets{};
@@ -1475,8 +1963,37 @@ Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, contai
                 auto& cnmt = cnmts.emplace_back(nca);
                 cnmt.type = NcmContentType_Meta;
                 R_TRY(yati->InstallCnmtNca(tickets, cnmt, collections));
+                if (cnmt.skipped) {
+                    R_TRY(yati->DiscardNca(cnmt));
+                }
+
+                // decide now, so that the ncas that come after the cnmt can be skipped.
+                R_TRY(yati->GetLatestVersion(cnmt, cnmt.latest_version_num, cnmt.skip_install));
+                R_TRY(yati->ShouldSkip(cnmt, cnmt.skip_install));
             } else {
-                R_TRY(yati->InstallNca(tickets, nca));
+                // only skip if every cnmt that uses the nca is skipped.
+                bool used{}, skip{true};
+                for (const auto& cnmt : cnmts) {
+                    const auto it = std::ranges::find_if(cnmt.ncas, [&collection](auto& e){
+                        return e.name == collection.name;
+                    });
+
+                    if (it != cnmt.ncas.cend()) {
+                        used = true;
+                        skip &= cnmt.skip_install;
+                    }
+                }
+
+                if (used && skip) {
+                    log_write("skipping nca as the cnmt is skipped: %s\n", nca.name.c_str());
+                    nca.skipped = true;
+                } else {
+                    R_TRY(yati->InstallNca(tickets, nca));
+                }
+
+                if (nca.skipped) {
+                    R_TRY(yati->DiscardNca(nca));
+                }
             }
         } else if (collection.name.ends_with(".tik") || collection.name.ends_with(".cert")) {
             FsRightsId rights_id{};
@@ -1493,12 +2010,20 @@ Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, contai
             u64 bytes_read;
             if (collection.name.ends_with(".tik")) {
                 R_TRY(source->Read(entry->ticket.data(), collection.offset, entry->ticket.size(), &bytes_read));
+                entry->read = true;
             } else {
                 R_TRY(source->Read(entry->cert.data(), collection.offset, entry->cert.size(), &bytes_read));
             }
         }
     }
 
+    // tickets that came after the ncas in the stream have now been read.
+    for (auto& nca : ncas) {
+        if (nca.pending_crypto) {
+            R_TRY(yati->ConvertPendingNca(tickets, nca));
+        }
+    }
+
     for (auto& cnmt : cnmts) {
         // copy nca structs into cnmt.
         for (auto& cnmt_nca : cnmt.ncas) {
@@ -1512,19 +2037,14 @@ Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, contai
             cnmt_nca.type = type;
         }
 
-        u32 latest_version_num;
-        bool skip = false;
-        R_TRY(yati->GetLatestVersion(cnmt, latest_version_num, skip));
-        R_TRY(yati->ShouldSkip(cnmt, skip));
-
-        if (skip) {
+        if (cnmt.skip_install) {
             log_write("skipping install!\n");
             continue;
         }
 
         R_TRY(yati->ImportTickets(tickets));
         R_TRY(yati->RemoveInstalledNcas(cnmt));
-        R_TRY(yati->RegisterNcasAndPushRecord(cnmt, latest_version_num));
+        R_TRY(yati->RegisterNcasAndPushRecord(cnmt, cnmt.latest_version_num));
     }
 
     log_write("success!\n");